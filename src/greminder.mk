@@ -23,6 +23,8 @@ bin_greminder_SOURCES =                                   \
 	src/greminder/greminder-macros.h                  \
 	src/greminder/greminder-actions.h                 \
 	src/greminder/greminder-db.h                      \
+	src/greminder/greminder-db-cursor.h               \
+	src/greminder/greminder-db-explain.h              \
 	src/greminder/greminder-item.h                    \
 	src/greminder/greminder-keyword-widget.h          \
 	src/greminder/greminder-keywords-widget.h         \
@@ -31,6 +33,24 @@ bin_greminder_SOURCES =                                   \
 	src/greminder/greminder-window.h                  \
 	src/greminder/greminder-actions-private.h         \
 	src/greminder/greminder-db-private.h              \
+	src/greminder/greminder-db-cursor-private.h       \
+	src/greminder/greminder-db-explain-private.h      \
+	src/greminder/greminder-db-bitmap-cache.h         \
+	src/greminder/greminder-db-bitmap.h               \
+	src/greminder/greminder-db-block.h                \
+	src/greminder/greminder-db-config.h               \
+	src/greminder/greminder-db-fuzzy.h                \
+	src/greminder/greminder-db-intersect.h            \
+	src/greminder/greminder-db-item-cache.h           \
+	src/greminder/greminder-db-keys.h                 \
+	src/greminder/greminder-db-legacy.h               \
+	src/greminder/greminder-db-posting.h              \
+	src/greminder/greminder-db-query-cache.h          \
+	src/greminder/greminder-db-query.h                \
+	src/greminder/greminder-db-rank.h                 \
+	src/greminder/greminder-db-record.h               \
+	src/greminder/greminder-db-snapshot.h             \
+	src/greminder/greminder-db-text.h                 \
 	src/greminder/greminder-item-private.h            \
 	src/greminder/greminder-keyword-widget-private.h  \
 	src/greminder/greminder-keywords-widget-private.h \
@@ -39,6 +59,24 @@ bin_greminder_SOURCES =                                   \
 	src/greminder/greminder-window-private.h          \
 	src/greminder/greminder-actions.c                 \
 	src/greminder/greminder-db.c                      \
+	src/greminder/greminder-db-bitmap-cache.c         \
+	src/greminder/greminder-db-bitmap.c               \
+	src/greminder/greminder-db-block.c                \
+	src/greminder/greminder-db-config.c               \
+	src/greminder/greminder-db-cursor.c               \
+	src/greminder/greminder-db-explain.c              \
+	src/greminder/greminder-db-fuzzy.c                \
+	src/greminder/greminder-db-intersect.c            \
+	src/greminder/greminder-db-item-cache.c           \
+	src/greminder/greminder-db-keys.c                 \
+	src/greminder/greminder-db-legacy.c               \
+	src/greminder/greminder-db-posting.c              \
+	src/greminder/greminder-db-query-cache.c          \
+	src/greminder/greminder-db-query.c                \
+	src/greminder/greminder-db-rank.c                 \
+	src/greminder/greminder-db-record.c               \
+	src/greminder/greminder-db-snapshot.c             \
+	src/greminder/greminder-db-text.c                 \
 	src/greminder/greminder-item.c                    \
 	src/greminder/greminder-keyword-widget.c          \
 	src/greminder/greminder-keywords-widget.c         \
@@ -0,0 +1,225 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-bitmap-cache.h"
+
+#include "greminder-db-block.h"
+
+#include <string.h>
+
+typedef struct
+{
+    gchar             *keyword;
+    GReminderDbBitmap *bitmap;
+    guint64            version;
+    gsize              size;
+    GList             *link;
+} GReminderDbBitmapCacheEntry;
+
+struct _GReminderDbBitmapCache
+{
+    GMutex      lock;
+
+    gsize       budget;
+    gsize       size;
+    /* Writes started and applied, they only differ while one is in progress */
+    guint64     begun;
+    guint64     done;
+    /* Keyword to entry, and the entries from most to least recently used */
+    GHashTable *entries;
+    GQueue      lru;
+};
+
+static void
+g_reminder_db_bitmap_cache_entry_free (gpointer data)
+{
+    GReminderDbBitmapCacheEntry *entry = data;
+
+    g_free (entry->keyword);
+    g_reminder_db_bitmap_unref (entry->bitmap);
+    g_free (entry);
+}
+
+static void
+g_reminder_db_bitmap_cache_remove (GReminderDbBitmapCache      *self,
+                                   GReminderDbBitmapCacheEntry *entry)
+{
+    self->size -= entry->size;
+    g_queue_delete_link (&self->lru, entry->link);
+    g_hash_table_remove (self->entries, entry->keyword);
+}
+
+static void
+g_reminder_db_bitmap_cache_evict (GReminderDbBitmapCache *self)
+{
+    while (self->size > self->budget)
+        g_reminder_db_bitmap_cache_remove (self, g_queue_peek_tail (&self->lru));
+}
+
+GReminderDbBitmapCache *
+g_reminder_db_bitmap_cache_new (gsize budget)
+{
+    GReminderDbBitmapCache *self = g_new0 (GReminderDbBitmapCache, 1);
+
+    g_mutex_init (&self->lock);
+    self->budget = budget;
+    self->begun = 1;
+    self->done = 1;
+    self->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_reminder_db_bitmap_cache_entry_free);
+    g_queue_init (&self->lru);
+
+    return self;
+}
+
+void
+g_reminder_db_bitmap_cache_free (GReminderDbBitmapCache *self)
+{
+    g_queue_clear (&self->lru);
+    g_hash_table_unref (self->entries);
+    g_mutex_clear (&self->lock);
+    g_free (self);
+}
+
+guint64
+g_reminder_db_bitmap_cache_begin_read (GReminderDbBitmapCache *self)
+{
+    g_mutex_lock (&self->lock);
+    guint64 version = self->done;
+    g_mutex_unlock (&self->lock);
+
+    return version;
+}
+
+guint64
+g_reminder_db_bitmap_cache_end_read (GReminderDbBitmapCache *self,
+                                     guint64                 version)
+{
+    g_mutex_lock (&self->lock);
+    gboolean written = (self->begun != version);
+    g_mutex_unlock (&self->lock);
+
+    return (written) ? 0 : version;
+}
+
+void
+g_reminder_db_bitmap_cache_begin_write (GReminderDbBitmapCache *self)
+{
+    g_mutex_lock (&self->lock);
+    ++self->begun;
+    g_mutex_unlock (&self->lock);
+}
+
+void
+g_reminder_db_bitmap_cache_end_write (GReminderDbBitmapCache *self)
+{
+    g_mutex_lock (&self->lock);
+    self->done = self->begun;
+    g_mutex_unlock (&self->lock);
+}
+
+GReminderDbBitmap *
+g_reminder_db_bitmap_cache_lookup (GReminderDbBitmapCache *self,
+                                   const gchar            *keyword,
+                                   guint64                 version)
+{
+    GReminderDbBitmap *bitmap = NULL;
+
+    g_mutex_lock (&self->lock);
+
+    GReminderDbBitmapCacheEntry *entry = g_hash_table_lookup (self->entries, keyword);
+    if (entry && entry->version <= version)
+    {
+        g_queue_unlink (&self->lru, entry->link);
+        g_queue_push_head_link (&self->lru, entry->link);
+        bitmap = g_reminder_db_bitmap_ref (entry->bitmap);
+    }
+
+    g_mutex_unlock (&self->lock);
+
+    return bitmap;
+}
+
+void
+g_reminder_db_bitmap_cache_insert (GReminderDbBitmapCache *self,
+                                   const gchar            *keyword,
+                                   GReminderDbBitmap      *bitmap,
+                                   guint64                 version)
+{
+    gsize size = g_reminder_db_bitmap_get_size (bitmap) + strlen (keyword);
+
+    g_mutex_lock (&self->lock);
+
+    /* A write started since, which may have missed the bitmap when updating */
+    if (version != self->begun)
+    {
+        g_mutex_unlock (&self->lock);
+        g_reminder_db_bitmap_unref (bitmap);
+        return;
+    }
+
+    GReminderDbBitmapCacheEntry *entry = g_hash_table_lookup (self->entries, keyword);
+    if (entry)
+        g_reminder_db_bitmap_cache_remove (self, entry);
+
+    if (size > self->budget)
+    {
+        g_mutex_unlock (&self->lock);
+        g_reminder_db_bitmap_unref (bitmap);
+        return;
+    }
+
+    entry = g_new (GReminderDbBitmapCacheEntry, 1);
+    entry->keyword = g_strdup (keyword);
+    entry->bitmap = bitmap;
+    entry->version = version;
+    entry->size = size;
+    g_queue_push_head (&self->lru, entry);
+    entry->link = g_queue_peek_head_link (&self->lru);
+    g_hash_table_insert (self->entries, entry->keyword, entry);
+    self->size += size;
+
+    g_reminder_db_bitmap_cache_evict (self);
+
+    g_mutex_unlock (&self->lock);
+}
+
+void
+g_reminder_db_bitmap_cache_update (GReminderDbBitmapCache *self,
+                                   const gchar            *keyword,
+                                   const GArray           *ops)
+{
+    /* Writers are serialized by the db, begun is the write being applied */
+    G_REMINDER_CLEANUP_BITMAP_UNREF GReminderDbBitmap *bitmap = g_reminder_db_bitmap_cache_lookup (self, keyword, self->begun);
+
+    if (!bitmap)
+        return;
+
+    /* Copied outside of the lock, writers are serialized by the db anyway */
+    GReminderDbBitmap *copy = g_reminder_db_bitmap_copy (bitmap);
+    for (guint i = 0; i < ops->len; ++i)
+    {
+        const GReminderDbBlockOp *op = &G_REMINDER_DB_BLOCK_OP (ops, i);
+        if (op->add)
+            g_reminder_db_bitmap_add (copy, op->id);
+        else
+            g_reminder_db_bitmap_remove (copy, op->id);
+    }
+
+    g_reminder_db_bitmap_cache_insert (self, keyword, copy, self->begun);
+}
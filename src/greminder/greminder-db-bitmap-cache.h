@@ -0,0 +1,71 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_BITMAP_CACHE_H__
+#define __G_REMINDER_DB_BITMAP_CACHE_H__
+
+#include "greminder-db-bitmap.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Bitmaps of the ids tagged with frequent keywords, within a memory budget.
+ * The least recently used keywords get evicted first.
+ *
+ * Unlike the query cache, entries are never invalidated: they are only
+ * inserted if no write started since the bitmap was read, and updated by
+ * every write, so that they always reflect the latest one. Updates replace
+ * the bitmap with a changed copy, readers keep using the one they got.
+ *
+ * Versions count the writes: entries are tagged with the one they reflect
+ * and only serve snapshots that include it. Snapshots take their version
+ * with begin_read and end_read around their creation, 0 if a write got in
+ * between, which never hits.
+ */
+typedef struct _GReminderDbBitmapCache GReminderDbBitmapCache;
+
+GReminderDbBitmapCache *g_reminder_db_bitmap_cache_new  (gsize                   budget);
+void                    g_reminder_db_bitmap_cache_free (GReminderDbBitmapCache *self);
+
+guint64 g_reminder_db_bitmap_cache_begin_read (GReminderDbBitmapCache *self);
+guint64 g_reminder_db_bitmap_cache_end_read   (GReminderDbBitmapCache *self,
+                                               guint64                 version);
+
+/* Around the application of every write, updates happen in between */
+void g_reminder_db_bitmap_cache_begin_write (GReminderDbBitmapCache *self);
+void g_reminder_db_bitmap_cache_end_write   (GReminderDbBitmapCache *self);
+
+/* Returns a reference to the bitmap, or NULL on a miss */
+GReminderDbBitmap *g_reminder_db_bitmap_cache_lookup (GReminderDbBitmapCache *self,
+                                                      const gchar            *keyword,
+                                                      guint64                 version);
+/* Takes ownership of the bitmap, dropped if it was built before the latest write */
+void               g_reminder_db_bitmap_cache_insert (GReminderDbBitmapCache *self,
+                                                      const gchar            *keyword,
+                                                      GReminderDbBitmap      *bitmap,
+                                                      guint64                 version);
+
+/* Apply the posting changes of a write, see greminder-db-block.h, if keyword is cached */
+void g_reminder_db_bitmap_cache_update (GReminderDbBitmapCache *self,
+                                        const gchar            *keyword,
+                                        const GArray           *ops);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_BITMAP_CACHE_H__*/
@@ -0,0 +1,573 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-bitmap.h"
+
+#include "greminder-db-intersect.h"
+
+#include <string.h>
+
+/* Containers switch to a bitset past this many values, where it gets smaller */
+#define G_REMINDER_DB_BITMAP_ARRAY_MAX 4096
+#define G_REMINDER_DB_BITMAP_WORDS     (65536 / 64)
+
+typedef struct
+{
+    /* High bits shared by the ids of the container */
+    guint64  key;
+    guint    cardinality;
+    /* Allocated values of an array, 0 for a bitset */
+    guint    capacity;
+    /* guint16 values, or G_REMINDER_DB_BITMAP_WORDS guint64 words for a bitset */
+    gpointer data;
+} GReminderDbBitmapContainer;
+
+#define G_REMINDER_DB_BITMAP_IS_BITSET(c) ((c)->cardinality > G_REMINDER_DB_BITMAP_ARRAY_MAX)
+#define G_REMINDER_DB_BITMAP_CONTAINER(self, i) (&g_array_index ((self)->containers, GReminderDbBitmapContainer, i))
+
+struct _GReminderDbBitmap
+{
+    gint    ref;
+
+    /* Sorted by key, empty containers are dropped */
+    GArray *containers;
+    guint64 cardinality;
+};
+
+typedef enum
+{
+    G_REMINDER_DB_BITMAP_AND,
+    G_REMINDER_DB_BITMAP_OR,
+    G_REMINDER_DB_BITMAP_ANDNOT
+} GReminderDbBitmapOp;
+
+static void
+g_reminder_db_bitmap_container_clear (gpointer data)
+{
+    GReminderDbBitmapContainer *c = data;
+    g_free (c->data);
+}
+
+static GReminderDbBitmap *
+g_reminder_db_bitmap_alloc (guint containers)
+{
+    GReminderDbBitmap *self = g_new (GReminderDbBitmap, 1);
+
+    self->ref = 1;
+    self->containers = g_array_sized_new (FALSE, FALSE, sizeof (GReminderDbBitmapContainer), containers);
+    self->cardinality = 0;
+    g_array_set_clear_func (self->containers, g_reminder_db_bitmap_container_clear);
+
+    return self;
+}
+
+GReminderDbBitmap *
+g_reminder_db_bitmap_new (void)
+{
+    return g_reminder_db_bitmap_alloc (0);
+}
+
+static GReminderDbBitmapContainer
+g_reminder_db_bitmap_container_copy (const GReminderDbBitmapContainer *c)
+{
+    GReminderDbBitmapContainer copy = *c;
+    gsize size = (G_REMINDER_DB_BITMAP_IS_BITSET (c)) ? G_REMINDER_DB_BITMAP_WORDS * sizeof (guint64) : c->cardinality * sizeof (guint16);
+
+    copy.capacity = (G_REMINDER_DB_BITMAP_IS_BITSET (c)) ? 0 : c->cardinality;
+    copy.data = g_malloc (size);
+    memcpy (copy.data, c->data, size);
+
+    return copy;
+}
+
+GReminderDbBitmap *
+g_reminder_db_bitmap_copy (const GReminderDbBitmap *self)
+{
+    GReminderDbBitmap *copy = g_reminder_db_bitmap_alloc (self->containers->len);
+
+    for (guint i = 0; i < self->containers->len; ++i)
+    {
+        GReminderDbBitmapContainer c = g_reminder_db_bitmap_container_copy (G_REMINDER_DB_BITMAP_CONTAINER (self, i));
+        g_array_append_val (copy->containers, c);
+    }
+    copy->cardinality = self->cardinality;
+
+    return copy;
+}
+
+GReminderDbBitmap *
+g_reminder_db_bitmap_ref (GReminderDbBitmap *self)
+{
+    g_atomic_int_inc (&self->ref);
+    return self;
+}
+
+void
+g_reminder_db_bitmap_unref (GReminderDbBitmap *self)
+{
+    if (!g_atomic_int_dec_and_test (&self->ref))
+        return;
+
+    g_array_unref (self->containers);
+    g_free (self);
+}
+
+guint64
+g_reminder_db_bitmap_get_cardinality (const GReminderDbBitmap *self)
+{
+    return self->cardinality;
+}
+
+gsize
+g_reminder_db_bitmap_get_size (const GReminderDbBitmap *self)
+{
+    gsize size = sizeof (GReminderDbBitmap) + self->containers->len * sizeof (GReminderDbBitmapContainer);
+
+    for (guint i = 0; i < self->containers->len; ++i)
+    {
+        const GReminderDbBitmapContainer *c = G_REMINDER_DB_BITMAP_CONTAINER (self, i);
+        size += (G_REMINDER_DB_BITMAP_IS_BITSET (c)) ? G_REMINDER_DB_BITMAP_WORDS * sizeof (guint64) : c->capacity * sizeof (guint16);
+    }
+
+    return size;
+}
+
+/* Index of the first container with a key greater than or equal to key */
+static guint
+g_reminder_db_bitmap_search (const GReminderDbBitmap *self,
+                             guint                    from,
+                             guint64                  key)
+{
+    guint lo = from, hi = self->containers->len;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+        if (G_REMINDER_DB_BITMAP_CONTAINER (self, mid)->key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* Index of the first value greater than or equal to low in an array */
+static guint
+g_reminder_db_bitmap_array_search (const guint16 *values,
+                                   guint          n,
+                                   guint          low)
+{
+    guint lo = 0, hi = n;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+        if (values[mid] < low)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static gboolean
+g_reminder_db_bitmap_container_contains (const GReminderDbBitmapContainer *c,
+                                         guint16                           low)
+{
+    if (G_REMINDER_DB_BITMAP_IS_BITSET (c))
+        return (((const guint64 *) c->data)[low >> 6] >> (low & 63)) & 1;
+
+    guint i = g_reminder_db_bitmap_array_search (c->data, c->cardinality, low);
+    return i < c->cardinality && ((const guint16 *) c->data)[i] == low;
+}
+
+/* Fill words, which must be zeroed, with the values of a container */
+static void
+g_reminder_db_bitmap_container_to_words (const GReminderDbBitmapContainer *c,
+                                         guint64                          *words)
+{
+    const guint16 *values = c->data;
+
+    if (G_REMINDER_DB_BITMAP_IS_BITSET (c))
+    {
+        memcpy (words, c->data, G_REMINDER_DB_BITMAP_WORDS * sizeof (guint64));
+        return;
+    }
+
+    for (guint i = 0; i < c->cardinality; ++i)
+        words[values[i] >> 6] |= G_GUINT64_CONSTANT (1) << (values[i] & 63);
+}
+
+/* Build a container of the right kind out of a bitset, taking ownership of words */
+static GReminderDbBitmapContainer
+g_reminder_db_bitmap_container_from_words (guint64  key,
+                                           guint64 *words,
+                                           guint    cardinality)
+{
+    GReminderDbBitmapContainer c = { key, cardinality, 0, words };
+
+    if (G_REMINDER_DB_BITMAP_IS_BITSET (&c))
+        return c;
+
+    guint16 *values = g_new (guint16, MAX (cardinality, 1));
+    guint n = 0;
+
+    for (guint w = 0; w < G_REMINDER_DB_BITMAP_WORDS; ++w)
+    {
+        for (guint64 word = words[w]; word; word &= word - 1)
+            values[n++] = (w << 6) | __builtin_ctzll (word);
+    }
+    g_free (words);
+
+    c.capacity = MAX (cardinality, 1);
+    c.data = values;
+    return c;
+}
+
+static void
+g_reminder_db_bitmap_container_add (GReminderDbBitmapContainer *c,
+                                    guint16                     low)
+{
+    if (G_REMINDER_DB_BITMAP_IS_BITSET (c))
+    {
+        ((guint64 *) c->data)[low >> 6] |= G_GUINT64_CONSTANT (1) << (low & 63);
+        ++c->cardinality;
+        return;
+    }
+
+    if (c->cardinality == G_REMINDER_DB_BITMAP_ARRAY_MAX)
+    {
+        guint64 *words = g_new0 (guint64, G_REMINDER_DB_BITMAP_WORDS);
+        g_reminder_db_bitmap_container_to_words (c, words);
+        words[low >> 6] |= G_GUINT64_CONSTANT (1) << (low & 63);
+        g_free (c->data);
+        c->data = words;
+        c->capacity = 0;
+        ++c->cardinality;
+        return;
+    }
+
+    if (c->cardinality == c->capacity)
+    {
+        c->capacity = MIN (MAX (c->capacity * 2, 4), G_REMINDER_DB_BITMAP_ARRAY_MAX);
+        c->data = g_renew (guint16, c->data, c->capacity);
+    }
+
+    guint16 *values = c->data;
+    guint i = g_reminder_db_bitmap_array_search (values, c->cardinality, low);
+    memmove (values + i + 1, values + i, (c->cardinality - i) * sizeof (guint16));
+    values[i] = low;
+    ++c->cardinality;
+}
+
+static void
+g_reminder_db_bitmap_container_remove (GReminderDbBitmapContainer *c,
+                                       guint16                     low)
+{
+    if (!G_REMINDER_DB_BITMAP_IS_BITSET (c))
+    {
+        guint16 *values = c->data;
+        guint i = g_reminder_db_bitmap_array_search (values, c->cardinality, low);
+        memmove (values + i, values + i + 1, (c->cardinality - i - 1) * sizeof (guint16));
+        --c->cardinality;
+        return;
+    }
+
+    guint64 *words = c->data;
+    words[low >> 6] &= ~(G_GUINT64_CONSTANT (1) << (low & 63));
+    if (--c->cardinality == G_REMINDER_DB_BITMAP_ARRAY_MAX)
+        *c = g_reminder_db_bitmap_container_from_words (c->key, words, c->cardinality);
+}
+
+void
+g_reminder_db_bitmap_add (GReminderDbBitmap *self,
+                          guint64            id)
+{
+    guint64 key = id >> 16;
+    guint i = g_reminder_db_bitmap_search (self, 0, key);
+
+    if (i == self->containers->len || G_REMINDER_DB_BITMAP_CONTAINER (self, i)->key != key)
+    {
+        GReminderDbBitmapContainer c = { key, 0, 4, g_new (guint16, 4) };
+        g_array_insert_val (self->containers, i, c);
+    }
+
+    GReminderDbBitmapContainer *c = G_REMINDER_DB_BITMAP_CONTAINER (self, i);
+    if (g_reminder_db_bitmap_container_contains (c, id & 0xFFFF))
+        return;
+
+    g_reminder_db_bitmap_container_add (c, id & 0xFFFF);
+    ++self->cardinality;
+}
+
+void
+g_reminder_db_bitmap_remove (GReminderDbBitmap *self,
+                             guint64            id)
+{
+    guint64 key = id >> 16;
+    guint i = g_reminder_db_bitmap_search (self, 0, key);
+
+    if (i == self->containers->len)
+        return;
+
+    GReminderDbBitmapContainer *c = G_REMINDER_DB_BITMAP_CONTAINER (self, i);
+    if (c->key != key || !g_reminder_db_bitmap_container_contains (c, id & 0xFFFF))
+        return;
+
+    g_reminder_db_bitmap_container_remove (c, id & 0xFFFF);
+    --self->cardinality;
+    if (!c->cardinality)
+        g_array_remove_index (self->containers, i);
+}
+
+/* Sparse operands are merged directly, anything involving a bitset goes through words */
+static GReminderDbBitmapContainer
+g_reminder_db_bitmap_container_combine (const GReminderDbBitmapContainer *a,
+                                        const GReminderDbBitmapContainer *b,
+                                        GReminderDbBitmapOp               op)
+{
+    const guint16 *va = a->data, *vb = b->data;
+
+    if (!G_REMINDER_DB_BITMAP_IS_BITSET (a) && (!G_REMINDER_DB_BITMAP_IS_BITSET (b) || op != G_REMINDER_DB_BITMAP_OR))
+    {
+        guint16 *out = g_new (guint16, MAX (a->cardinality + b->cardinality, 1));
+        guint i = 0, j = 0, n = 0;
+
+        if (G_REMINDER_DB_BITMAP_IS_BITSET (b))
+        {
+            /* Probing the bitset is cheaper than walking it */
+            for (; i < a->cardinality; ++i)
+            {
+                if (g_reminder_db_bitmap_container_contains (b, va[i]) == (op == G_REMINDER_DB_BITMAP_AND))
+                    out[n++] = va[i];
+            }
+        }
+        else if (op == G_REMINDER_DB_BITMAP_AND)
+            n = g_reminder_db_intersect_u16 (va, a->cardinality, vb, b->cardinality, out);
+        else
+        {
+            while (i < a->cardinality && j < b->cardinality)
+            {
+                if (va[i] < vb[j])
+                {
+                    if (op != G_REMINDER_DB_BITMAP_AND)
+                        out[n++] = va[i];
+                    ++i;
+                }
+                else if (va[i] > vb[j])
+                {
+                    if (op == G_REMINDER_DB_BITMAP_OR)
+                        out[n++] = vb[j];
+                    ++j;
+                }
+                else
+                {
+                    if (op != G_REMINDER_DB_BITMAP_ANDNOT)
+                        out[n++] = va[i];
+                    ++i;
+                    ++j;
+                }
+            }
+            for (; op != G_REMINDER_DB_BITMAP_AND && i < a->cardinality; ++i)
+                out[n++] = va[i];
+            for (; op == G_REMINDER_DB_BITMAP_OR && j < b->cardinality; ++j)
+                out[n++] = vb[j];
+        }
+
+        GReminderDbBitmapContainer c = { a->key, n, MAX (a->cardinality + b->cardinality, 1), out };
+        if (n <= G_REMINDER_DB_BITMAP_ARRAY_MAX)
+            return c;
+
+        /* Only a union can outgrow an array */
+        guint64 *words = g_new0 (guint64, G_REMINDER_DB_BITMAP_WORDS);
+        c.cardinality = 0;
+        for (guint k = 0; k < n; ++k)
+            words[out[k] >> 6] |= G_GUINT64_CONSTANT (1) << (out[k] & 63);
+        g_free (out);
+        return g_reminder_db_bitmap_container_from_words (a->key, words, n);
+    }
+
+    guint64 *words = g_new0 (guint64, G_REMINDER_DB_BITMAP_WORDS);
+    guint64 other[G_REMINDER_DB_BITMAP_WORDS];
+    guint cardinality = 0;
+
+    memset (other, 0, sizeof (other));
+    g_reminder_db_bitmap_container_to_words (a, words);
+    g_reminder_db_bitmap_container_to_words (b, other);
+
+    for (guint w = 0; w < G_REMINDER_DB_BITMAP_WORDS; ++w)
+    {
+        switch (op)
+        {
+        case G_REMINDER_DB_BITMAP_AND:
+            words[w] &= other[w];
+            break;
+        case G_REMINDER_DB_BITMAP_OR:
+            words[w] |= other[w];
+            break;
+        case G_REMINDER_DB_BITMAP_ANDNOT:
+            words[w] &= ~other[w];
+            break;
+        }
+        cardinality += __builtin_popcountll (words[w]);
+    }
+
+    return g_reminder_db_bitmap_container_from_words (a->key, words, cardinality);
+}
+
+static void
+g_reminder_db_bitmap_append (GReminderDbBitmap          *self,
+                             GReminderDbBitmapContainer  c)
+{
+    if (!c.cardinality)
+    {
+        g_free (c.data);
+        return;
+    }
+
+    g_array_append_val (self->containers, c);
+    self->cardinality += c.cardinality;
+}
+
+static GReminderDbBitmap *
+g_reminder_db_bitmap_combine (const GReminderDbBitmap *a,
+                              const GReminderDbBitmap *b,
+                              GReminderDbBitmapOp      op)
+{
+    GReminderDbBitmap *self = g_reminder_db_bitmap_alloc ((op == G_REMINDER_DB_BITMAP_AND) ? MIN (a->containers->len, b->containers->len) : a->containers->len);
+    guint i = 0, j = 0;
+
+    while (i < a->containers->len && j < b->containers->len)
+    {
+        const GReminderDbBitmapContainer *ca = G_REMINDER_DB_BITMAP_CONTAINER (a, i);
+        const GReminderDbBitmapContainer *cb = G_REMINDER_DB_BITMAP_CONTAINER (b, j);
+
+        if (ca->key < cb->key)
+        {
+            if (op != G_REMINDER_DB_BITMAP_AND)
+                g_reminder_db_bitmap_append (self, g_reminder_db_bitmap_container_copy (ca));
+            ++i;
+        }
+        else if (ca->key > cb->key)
+        {
+            if (op == G_REMINDER_DB_BITMAP_OR)
+                g_reminder_db_bitmap_append (self, g_reminder_db_bitmap_container_copy (cb));
+            ++j;
+        }
+        else
+        {
+            /* Intersections are symmetric, let the sparse side probe the dense one */
+            if (op == G_REMINDER_DB_BITMAP_AND && G_REMINDER_DB_BITMAP_IS_BITSET (ca) && !G_REMINDER_DB_BITMAP_IS_BITSET (cb))
+                g_reminder_db_bitmap_append (self, g_reminder_db_bitmap_container_combine (cb, ca, op));
+            else
+                g_reminder_db_bitmap_append (self, g_reminder_db_bitmap_container_combine (ca, cb, op));
+            ++i;
+            ++j;
+        }
+    }
+
+    for (; op != G_REMINDER_DB_BITMAP_AND && i < a->containers->len; ++i)
+        g_reminder_db_bitmap_append (self, g_reminder_db_bitmap_container_copy (G_REMINDER_DB_BITMAP_CONTAINER (a, i)));
+    for (; op == G_REMINDER_DB_BITMAP_OR && j < b->containers->len; ++j)
+        g_reminder_db_bitmap_append (self, g_reminder_db_bitmap_container_copy (G_REMINDER_DB_BITMAP_CONTAINER (b, j)));
+
+    return self;
+}
+
+GReminderDbBitmap *
+g_reminder_db_bitmap_and (const GReminderDbBitmap *a,
+                          const GReminderDbBitmap *b)
+{
+    return g_reminder_db_bitmap_combine (a, b, G_REMINDER_DB_BITMAP_AND);
+}
+
+GReminderDbBitmap *
+g_reminder_db_bitmap_or (const GReminderDbBitmap *a,
+                         const GReminderDbBitmap *b)
+{
+    return g_reminder_db_bitmap_combine (a, b, G_REMINDER_DB_BITMAP_OR);
+}
+
+GReminderDbBitmap *
+g_reminder_db_bitmap_andnot (const GReminderDbBitmap *a,
+                             const GReminderDbBitmap *b)
+{
+    return g_reminder_db_bitmap_combine (a, b, G_REMINDER_DB_BITMAP_ANDNOT);
+}
+
+/* First value greater than or equal to low in a container */
+static gboolean
+g_reminder_db_bitmap_container_next (const GReminderDbBitmapContainer *c,
+                                     guint                             low,
+                                     guint16                          *value)
+{
+    if (!G_REMINDER_DB_BITMAP_IS_BITSET (c))
+    {
+        const guint16 *values = c->data;
+        guint i = g_reminder_db_bitmap_array_search (values, c->cardinality, low);
+
+        if (i == c->cardinality)
+            return FALSE;
+        *value = values[i];
+        return TRUE;
+    }
+
+    const guint64 *words = c->data;
+    guint w = low >> 6;
+    guint64 word = words[w] & (G_MAXUINT64 << (low & 63));
+
+    for (;;)
+    {
+        if (word)
+        {
+            *value = (w << 6) | __builtin_ctzll (word);
+            return TRUE;
+        }
+        if (++w == G_REMINDER_DB_BITMAP_WORDS)
+            return FALSE;
+        word = words[w];
+    }
+}
+
+gboolean
+g_reminder_db_bitmap_next (const GReminderDbBitmap *self,
+                           guint64                  target,
+                           guint                   *hint,
+                           guint64                 *id)
+{
+    guint64 key = target >> 16;
+
+    for (guint i = g_reminder_db_bitmap_search (self, *hint, key); i < self->containers->len; ++i)
+    {
+        const GReminderDbBitmapContainer *c = G_REMINDER_DB_BITMAP_CONTAINER (self, i);
+        guint16 value;
+
+        if (g_reminder_db_bitmap_container_next (c, (c->key == key) ? (target & 0xFFFF) : 0, &value))
+        {
+            *hint = i;
+            *id = (c->key << 16) | value;
+            return TRUE;
+        }
+    }
+
+    *hint = self->containers->len;
+    return FALSE;
+}
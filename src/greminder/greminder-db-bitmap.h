@@ -0,0 +1,81 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_BITMAP_H__
+#define __G_REMINDER_DB_BITMAP_H__
+
+#include "greminder-macros.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Compressed set of ids, in the way of roaring bitmaps: ids are split into
+ * containers by their high bits, and each container holds the low 16 bits
+ * either as a sorted array while sparse or as a bitset once dense. Set
+ * operations work container by container, with word-wide logic on dense
+ * ones.
+ *
+ * Bitmaps are refcounted and only ever modified before being shared, a
+ * changed copy is made to update one that may be in use.
+ */
+typedef struct _GReminderDbBitmap GReminderDbBitmap;
+
+#define G_REMINDER_CLEANUP_BITMAP_UNREF G_REMINDER_CLEANUP (g_reminder_db_bitmap_unref_ptr)
+
+GReminderDbBitmap *g_reminder_db_bitmap_new   (void);
+GReminderDbBitmap *g_reminder_db_bitmap_copy  (const GReminderDbBitmap *self);
+GReminderDbBitmap *g_reminder_db_bitmap_ref   (GReminderDbBitmap       *self);
+void               g_reminder_db_bitmap_unref (GReminderDbBitmap       *self);
+
+static inline void
+g_reminder_db_bitmap_unref_ptr (GReminderDbBitmap **self)
+{
+    if (*self)
+        g_reminder_db_bitmap_unref (*self);
+}
+
+void g_reminder_db_bitmap_add    (GReminderDbBitmap *self,
+                                  guint64            id);
+void g_reminder_db_bitmap_remove (GReminderDbBitmap *self,
+                                  guint64            id);
+
+guint64 g_reminder_db_bitmap_get_cardinality (const GReminderDbBitmap *self);
+/* Memory used, in bytes */
+gsize   g_reminder_db_bitmap_get_size        (const GReminderDbBitmap *self);
+
+GReminderDbBitmap *g_reminder_db_bitmap_and    (const GReminderDbBitmap *a,
+                                                const GReminderDbBitmap *b);
+GReminderDbBitmap *g_reminder_db_bitmap_or     (const GReminderDbBitmap *a,
+                                                const GReminderDbBitmap *b);
+GReminderDbBitmap *g_reminder_db_bitmap_andnot (const GReminderDbBitmap *a,
+                                                const GReminderDbBitmap *b);
+
+/*
+ * Find the first id greater than or equal to target. hint is the index of
+ * a container to start looking from, 0 at first: it gets updated so that
+ * walking the bitmap in order never searches the same containers twice.
+ */
+gboolean g_reminder_db_bitmap_next (const GReminderDbBitmap *self,
+                                    guint64                  target,
+                                    guint                   *hint,
+                                    guint64                 *id);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_BITMAP_H__*/
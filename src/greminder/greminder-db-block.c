@@ -0,0 +1,231 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-block.h"
+
+#include "greminder-db-record.h"
+
+GString *
+g_reminder_db_block_encode (const guint64 *ids,
+                            guint          n)
+{
+    GString *value = g_string_sized_new (2 * n);
+    guint64 prev = 0;
+
+    for (guint i = 0; i < n; ++i)
+    {
+        g_reminder_db_varint_append (value, ids[i] - prev);
+        prev = ids[i];
+    }
+
+    return value;
+}
+
+gboolean
+g_reminder_db_block_decode (const gchar *data,
+                            size_t       len,
+                            GArray      *ids)
+{
+    const gchar *end = data + len;
+    guint64 id = 0;
+
+    while (data < end)
+    {
+        guint64 gap;
+        if (!g_reminder_db_varint_read (&data, end, &gap))
+            return FALSE;
+        id += gap;
+        g_array_append_val (ids, id);
+    }
+
+    return TRUE;
+}
+
+GArray *
+g_reminder_db_block_ops_new (void)
+{
+    return g_array_new (FALSE, FALSE, sizeof (GReminderDbBlockOp));
+}
+
+void
+g_reminder_db_block_ops_add (GArray   *ops,
+                             guint64   id,
+                             gboolean  add)
+{
+    GReminderDbBlockOp op = { id, ops->len, add };
+    g_array_append_val (ops, op);
+}
+
+/* By id, then in the order the changes were made */
+static gint
+g_reminder_db_block_op_cmp (gconstpointer a,
+                            gconstpointer b)
+{
+    const GReminderDbBlockOp *oa = a;
+    const GReminderDbBlockOp *ob = b;
+
+    if (oa->id != ob->id)
+        return (oa->id > ob->id) ? 1 : -1;
+    return (oa->seq > ob->seq) - (oa->seq < ob->seq);
+}
+
+/* Position it on the first block ending at or after id, or on the last one */
+static gboolean
+g_reminder_db_block_locate (leveldb_iterator_t *it,
+                            GString            *prefix,
+                            guint64             id)
+{
+    gsize len = prefix->len;
+
+    g_reminder_db_key_append_id (prefix, id);
+    leveldb_iter_seek (it, prefix->str, prefix->len);
+    g_string_truncate (prefix, len);
+
+    if (g_reminder_db_iter_has_prefix (it, prefix))
+        return TRUE;
+
+    if (leveldb_iter_valid (it))
+        leveldb_iter_prev (it);
+    else
+        leveldb_iter_seek_to_last (it);
+    return g_reminder_db_iter_has_prefix (it, prefix);
+}
+
+/* The last block fills up as ids get appended, others are split evenly */
+static void
+g_reminder_db_block_write (leveldb_writebatch_t *batch,
+                           GString              *prefix,
+                           const GArray         *ids,
+                           gboolean              last)
+{
+    guint blocks = (ids->len + G_REMINDER_DB_BLOCK_MAX - 1) / G_REMINDER_DB_BLOCK_MAX;
+    gsize len = prefix->len;
+
+    for (guint start = 0, b = 0; start < ids->len; ++b)
+    {
+        guint left = ids->len - start;
+        guint n = (last) ? MIN (left, G_REMINDER_DB_BLOCK_MAX) : (left + blocks - b - 1) / (blocks - b);
+        const guint64 *block = &g_array_index (ids, guint64, start);
+        G_REMINDER_CLEANUP_STRING_FREE GString *value = g_reminder_db_block_encode (block, n);
+
+        g_reminder_db_key_append_id (prefix, block[n - 1]);
+        leveldb_writebatch_put (batch, prefix->str, prefix->len, value->str, value->len);
+        g_string_truncate (prefix, len);
+        start += n;
+    }
+}
+
+/* Delete the schema 2 posting of id, if there is one */
+static gboolean
+g_reminder_db_block_delete_forward (leveldb_t                   *db,
+                                    const leveldb_readoptions_t *roptions,
+                                    leveldb_writebatch_t        *batch,
+                                    const gchar                 *keyword,
+                                    guint64                      id)
+{
+    G_REMINDER_CLEANUP_STRING_FREE GString *key = g_reminder_db_key_forward (keyword, id);
+    G_REMINDER_CLEANUP_FREE gchar *err = NULL;
+    size_t len;
+    gchar *value = leveldb_get (db, roptions, key->str, key->len, &len, &err);
+
+    if (!value)
+        return FALSE;
+
+    leveldb_free (value);
+    leveldb_writebatch_delete (batch, key->str, key->len);
+    return TRUE;
+}
+
+gint64
+g_reminder_db_block_update (leveldb_t                   *db,
+                            const leveldb_readoptions_t *roptions,
+                            leveldb_writebatch_t        *batch,
+                            const gchar                 *keyword,
+                            GArray                      *ops,
+                            gboolean                     forward)
+{
+    G_REMINDER_CLEANUP_STRING_FREE GString *prefix = g_reminder_db_key_postings_prefix (keyword);
+    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = leveldb_create_iterator (db, roptions);
+    G_REMINDER_CLEANUP_ARRAY_UNREF GArray *ids = g_array_new (FALSE, FALSE, sizeof (guint64));
+    G_REMINDER_CLEANUP_ARRAY_UNREF GArray *merged = g_array_new (FALSE, FALSE, sizeof (guint64));
+    gint64 delta = 0;
+
+    g_array_sort (ops, g_reminder_db_block_op_cmp);
+
+    /* Each round rewrites the block the next id belongs to, with every change falling into it */
+    for (guint i = 0; i < ops->len;)
+    {
+        guint64 end = G_MAXUINT64;
+
+        g_array_set_size (ids, 0);
+        g_array_set_size (merged, 0);
+
+        if (g_reminder_db_block_locate (it, prefix, G_REMINDER_DB_BLOCK_OP (ops, i).id))
+        {
+            size_t klen, vlen;
+            const gchar *key = leveldb_iter_key (it, &klen);
+            const gchar *value = leveldb_iter_value (it, &vlen);
+
+            if (!g_reminder_db_block_decode (value, vlen, ids))
+            {
+                g_warning ("Dropping a corrupted posting block of %s", keyword);
+                g_array_set_size (ids, 0);
+            }
+            end = g_reminder_db_key_get_id (key + prefix->len);
+            leveldb_writebatch_delete (batch, key, klen);
+
+            /* The last block takes everything past its end */
+            leveldb_iter_next (it);
+            if (!g_reminder_db_iter_has_prefix (it, prefix))
+                end = G_MAXUINT64;
+        }
+
+        guint j = 0;
+        while (i < ops->len && G_REMINDER_DB_BLOCK_OP (ops, i).id <= end)
+        {
+            guint64 id = G_REMINDER_DB_BLOCK_OP (ops, i).id;
+            gboolean add = G_REMINDER_DB_BLOCK_OP (ops, i).add;
+
+            /* The last change made to an id wins */
+            while (++i < ops->len && G_REMINDER_DB_BLOCK_OP (ops, i).id == id)
+                add = G_REMINDER_DB_BLOCK_OP (ops, i).add;
+
+            for (; j < ids->len && g_array_index (ids, guint64, j) < id; ++j)
+                g_array_append_val (merged, g_array_index (ids, guint64, j));
+
+            gboolean present = (j < ids->len && g_array_index (ids, guint64, j) == id);
+            if (present)
+                ++j;
+
+            if (add)
+            {
+                g_array_append_val (merged, id);
+                delta += !present;
+            }
+            else if (present || (forward && g_reminder_db_block_delete_forward (db, roptions, batch, keyword, id)))
+                --delta;
+        }
+        if (j < ids->len)
+            g_array_append_vals (merged, &g_array_index (ids, guint64, j), ids->len - j);
+
+        g_reminder_db_block_write (batch, prefix, merged, end == G_MAXUINT64);
+    }
+
+    return delta;
+}
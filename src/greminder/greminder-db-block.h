@@ -0,0 +1,74 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_BLOCK_H__
+#define __G_REMINDER_DB_BLOCK_H__
+
+#include "greminder-db-keys.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Value stored under \0P<keyword>\0<id>: up to G_REMINDER_DB_BLOCK_MAX ids
+ * tagged with keyword, in increasing order and ending with id. The first id
+ * then the gaps between consecutive ones are stored as varints, which takes
+ * a byte or two per id for dense ids. Keying blocks by their last id makes
+ * a seek to some id land right on the block holding it, or the next one.
+ */
+#define G_REMINDER_DB_BLOCK_MAX 128
+
+GString *g_reminder_db_block_encode (const guint64 *ids,
+                                     guint          n);
+/* Appends the ids to the array */
+gboolean g_reminder_db_block_decode (const gchar *data,
+                                     size_t       len,
+                                     GArray      *ids);
+
+/* Pending changes to the postings of a keyword, in the order they were made */
+typedef struct
+{
+    guint64  id;
+    guint    seq;
+    gboolean add;
+} GReminderDbBlockOp;
+
+#define G_REMINDER_DB_BLOCK_OP(ops, i) g_array_index (ops, GReminderDbBlockOp, i)
+
+GArray *g_reminder_db_block_ops_new (void);
+void    g_reminder_db_block_ops_add (GArray   *ops,
+                                     guint64   id,
+                                     gboolean  add);
+
+/*
+ * Rewrite the blocks of keyword affected by ops into batch, splitting the
+ * ones that overflow and dropping the ones left empty. New ids are greater
+ * than all others, adding them only touches the last block. With forward set, removed ids
+ * missing from the blocks are looked for in the schema 2 layout too.
+ * Returns how many ids the keyword gained. The ops get sorted by id.
+ */
+gint64 g_reminder_db_block_update (leveldb_t                   *db,
+                                   const leveldb_readoptions_t *roptions,
+                                   leveldb_writebatch_t        *batch,
+                                   const gchar                 *keyword,
+                                   GArray                      *ops,
+                                   gboolean                     forward);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_BLOCK_H__*/
@@ -0,0 +1,164 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-config.h"
+
+#include <stddef.h>
+
+typedef enum
+{
+    G_REMINDER_DB_CONFIG_SIZE,
+    G_REMINDER_DB_CONFIG_INT,
+    G_REMINDER_DB_CONFIG_BOOLEAN,
+    G_REMINDER_DB_CONFIG_DURABILITY
+} GReminderDbConfigType;
+
+static const gchar *durabilities[] = {
+    [G_REMINDER_DB_DURABILITY_SYNC]    = "sync",
+    [G_REMINDER_DB_DURABILITY_GROUP]   = "group",
+    [G_REMINDER_DB_DURABILITY_RELAXED] = "relaxed",
+};
+
+static const struct
+{
+    const gchar           *key;
+    const gchar           *env;
+    GReminderDbConfigType  type;
+    size_t                 offset;
+} options[] = {
+    { "CacheSize",         "GREMINDER_DB_CACHE_SIZE",          G_REMINDER_DB_CONFIG_SIZE,       offsetof (GReminderDbConfig, cache_size)          },
+    { "BloomBitsPerKey",   "GREMINDER_DB_BLOOM_BITS_PER_KEY",  G_REMINDER_DB_CONFIG_INT,        offsetof (GReminderDbConfig, bloom_bits_per_key)  },
+    { "WriteBufferSize",   "GREMINDER_DB_WRITE_BUFFER_SIZE",   G_REMINDER_DB_CONFIG_SIZE,       offsetof (GReminderDbConfig, write_buffer_size)   },
+    { "BlockSize",         "GREMINDER_DB_BLOCK_SIZE",          G_REMINDER_DB_CONFIG_SIZE,       offsetof (GReminderDbConfig, block_size)          },
+    { "MaxOpenFiles",      "GREMINDER_DB_MAX_OPEN_FILES",      G_REMINDER_DB_CONFIG_INT,        offsetof (GReminderDbConfig, max_open_files)      },
+    { "Compression",       "GREMINDER_DB_COMPRESSION",         G_REMINDER_DB_CONFIG_BOOLEAN,    offsetof (GReminderDbConfig, compression)         },
+    { "Durability",        "GREMINDER_DB_DURABILITY",          G_REMINDER_DB_CONFIG_DURABILITY, offsetof (GReminderDbConfig, durability)          },
+    { "GroupCommitWindow", "GREMINDER_DB_GROUP_COMMIT_WINDOW", G_REMINDER_DB_CONFIG_INT,        offsetof (GReminderDbConfig, group_commit_window) },
+    { "ScanThreads",       "GREMINDER_DB_SCAN_THREADS",        G_REMINDER_DB_CONFIG_INT,        offsetof (GReminderDbConfig, scan_threads)        },
+    { "QueryCacheSize",    "GREMINDER_DB_QUERY_CACHE_SIZE",    G_REMINDER_DB_CONFIG_SIZE,       offsetof (GReminderDbConfig, query_cache_size)    },
+    { "ItemCacheItems",    "GREMINDER_DB_ITEM_CACHE_ITEMS",    G_REMINDER_DB_CONFIG_INT,        offsetof (GReminderDbConfig, item_cache_items)    },
+    { "BitmapCacheSize",   "GREMINDER_DB_BITMAP_CACHE_SIZE",   G_REMINDER_DB_CONFIG_SIZE,       offsetof (GReminderDbConfig, bitmap_cache_size)   },
+    { "SearchResults",     "GREMINDER_DB_SEARCH_RESULTS",      G_REMINDER_DB_CONFIG_INT,        offsetof (GReminderDbConfig, search_results)      },
+};
+
+static gboolean
+g_reminder_db_config_parse (const gchar           *value,
+                            GReminderDbConfigType  type,
+                            gpointer               out)
+{
+    gchar *end = NULL;
+    guint64 v;
+
+    if (type == G_REMINDER_DB_CONFIG_BOOLEAN)
+    {
+        if (!g_ascii_strcasecmp (value, "true") || !g_strcmp0 (value, "1"))
+            *(gboolean *) out = TRUE;
+        else if (!g_ascii_strcasecmp (value, "false") || !g_strcmp0 (value, "0"))
+            *(gboolean *) out = FALSE;
+        else
+            return FALSE;
+        return TRUE;
+    }
+
+    if (type == G_REMINDER_DB_CONFIG_DURABILITY)
+    {
+        for (guint i = 0; i < G_N_ELEMENTS (durabilities); ++i)
+        {
+            if (!g_ascii_strcasecmp (value, durabilities[i]))
+            {
+                *(GReminderDbDurability *) out = i;
+                return TRUE;
+            }
+        }
+        return FALSE;
+    }
+
+    v = g_ascii_strtoull (value, &end, 10);
+    if (end == value)
+        return FALSE;
+
+    if (type == G_REMINDER_DB_CONFIG_SIZE)
+    {
+        switch (*end)
+        {
+        case 'G': case 'g': v <<= 10; /* fallthrough */
+        case 'M': case 'm': v <<= 10; /* fallthrough */
+        case 'K': case 'k': v <<= 10; ++end; break;
+        default: break;
+        }
+    }
+
+    if (*end)
+        return FALSE;
+
+    if (type == G_REMINDER_DB_CONFIG_SIZE)
+        *(gsize *) out = v;
+    else
+        *(gint *) out = (gint) MIN (v, G_MAXINT);
+    return TRUE;
+}
+
+static void
+g_reminder_db_config_set (GReminderDbConfig *config,
+                          guint              option,
+                          const gchar       *value,
+                          const gchar       *source)
+{
+    if (!g_reminder_db_config_parse (value, options[option].type, (guchar *) config + options[option].offset))
+        g_warning ("Ignoring invalid value '%s' for %s in %s", value, options[option].key, source);
+}
+
+void
+g_reminder_db_config_load (GReminderDbConfig *config)
+{
+    /* Defaults suited to stores of a few GB */
+    config->cache_size = 64 << 20;
+    config->bloom_bits_per_key = 10;
+    config->write_buffer_size = 16 << 20;
+    config->block_size = 16 << 10;
+    config->max_open_files = 1000;
+    config->compression = TRUE;
+    config->durability = G_REMINDER_DB_DURABILITY_SYNC;
+    config->group_commit_window = 2;
+    config->scan_threads = g_get_num_processors ();
+    config->query_cache_size = 8 << 20;
+    config->item_cache_items = 1024;
+    config->bitmap_cache_size = 32 << 20;
+    config->search_results = 100;
+
+    G_REMINDER_CLEANUP_FREE gchar *path = g_build_filename (g_get_user_config_dir (), "greminder", "greminder.conf", NULL);
+    GKeyFile *file = g_key_file_new ();
+    gboolean loaded = g_key_file_load_from_file (file, path, G_KEY_FILE_NONE, NULL);
+
+    for (guint i = 0; i < G_N_ELEMENTS (options); ++i)
+    {
+        const gchar *env = g_getenv (options[i].env);
+
+        if (env)
+            g_reminder_db_config_set (config, i, env, options[i].env);
+        else if (loaded)
+        {
+            G_REMINDER_CLEANUP_FREE gchar *value = g_key_file_get_string (file, "Database", options[i].key, NULL);
+            if (value)
+                g_reminder_db_config_set (config, i, g_strstrip (value), path);
+        }
+    }
+
+    g_key_file_free (file);
+}
@@ -0,0 +1,60 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_CONFIG_H__
+#define __G_REMINDER_DB_CONFIG_H__
+
+#include "greminder-macros.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+    G_REMINDER_DB_DURABILITY_SYNC,    /* every write is synced to disk before returning */
+    G_REMINDER_DB_DURABILITY_GROUP,   /* concurrent writers wait for a shared sync */
+    G_REMINDER_DB_DURABILITY_RELAXED  /* writes are synced once they pause, on flush and on close */
+} GReminderDbDurability;
+
+/*
+ * Tunables of the db, read from the [Database] group of
+ * $XDG_CONFIG_HOME/greminder/greminder.conf. Each of them can be overridden
+ * by a GREMINDER_DB_* environment variable. Sizes accept a K, M or G suffix.
+ */
+typedef struct
+{
+    gsize                 cache_size;
+    gint                  bloom_bits_per_key;
+    gsize                 write_buffer_size;
+    gsize                 block_size;
+    gint                  max_open_files;
+    gboolean              compression;
+    GReminderDbDurability durability;
+    gint                  group_commit_window;
+    gint                  scan_threads;
+    gsize                 query_cache_size;
+    gint                  item_cache_items;
+    gsize                 bitmap_cache_size;
+    gint                  search_results;
+} GReminderDbConfig;
+
+void g_reminder_db_config_load (GReminderDbConfig *config);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_CONFIG_H__*/
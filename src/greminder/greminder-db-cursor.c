@@ -0,0 +1,175 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-cursor-private.h"
+
+#include "greminder-db-legacy.h"
+
+struct _GReminderDbCursorPrivate
+{
+    GObject             *db;
+    GReminderDbSnapshot *snapshot;
+    GReminderDbPosting  *posting;
+
+    gchar              **legacy_keywords;
+    gboolean             legacy_loaded;
+    GSList              *legacy;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (GReminderDbCursor, g_reminder_db_cursor, G_TYPE_OBJECT)
+
+static gboolean
+g_reminder_db_cursor_private_has_ids (GReminderDbCursorPrivate *priv)
+{
+    return priv->posting && !priv->posting->done;
+}
+
+/* Legacy items are not indexed by id, they are all loaded at once when reached */
+static GSList *
+g_reminder_db_cursor_private_get_legacy (GReminderDbCursorPrivate *priv)
+{
+    if (!priv->legacy_loaded && priv->legacy_keywords)
+        priv->legacy = g_reminder_db_legacy_find (priv->snapshot->db, priv->snapshot->scan_roptions, priv->legacy_keywords);
+    priv->legacy_loaded = TRUE;
+    return priv->legacy;
+}
+
+G_REMINDER_VISIBLE guint64
+g_reminder_db_cursor_get_estimate (const GReminderDbCursor *self)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB_CURSOR (self), 0);
+
+    GReminderDbCursorPrivate *priv = g_reminder_db_cursor_get_instance_private ((GReminderDbCursor *) self);
+
+    return ((priv->posting) ? priv->posting->estimate : 0) + g_slist_length (priv->legacy);
+}
+
+G_REMINDER_VISIBLE gboolean
+g_reminder_db_cursor_is_done (const GReminderDbCursor *self)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB_CURSOR (self), TRUE);
+
+    GReminderDbCursorPrivate *priv = g_reminder_db_cursor_get_instance_private ((GReminderDbCursor *) self);
+
+    return !g_reminder_db_cursor_private_has_ids (priv) && !g_reminder_db_cursor_private_get_legacy (priv);
+}
+
+G_REMINDER_VISIBLE guint
+g_reminder_db_cursor_skip (GReminderDbCursor *self,
+                           guint              count)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB_CURSOR (self), 0);
+
+    GReminderDbCursorPrivate *priv = g_reminder_db_cursor_get_instance_private (self);
+    guint skipped = 0;
+
+    for (; skipped < count && g_reminder_db_cursor_private_has_ids (priv); ++skipped)
+        g_reminder_db_posting_next (priv->posting);
+
+    for (; skipped < count && g_reminder_db_cursor_private_get_legacy (priv); ++skipped)
+    {
+        g_object_unref (priv->legacy->data);
+        priv->legacy = g_slist_delete_link (priv->legacy, priv->legacy);
+    }
+
+    return skipped;
+}
+
+G_REMINDER_VISIBLE void
+g_reminder_db_cursor_seek_after (GReminderDbCursor *self,
+                                 guint64            id)
+{
+    g_return_if_fail (G_REMINDER_IS_DB_CURSOR (self));
+
+    GReminderDbCursorPrivate *priv = g_reminder_db_cursor_get_instance_private (self);
+
+    if (priv->posting && id < G_MAXUINT64)
+        g_reminder_db_posting_seek (priv->posting, id + 1);
+}
+
+G_REMINDER_VISIBLE GSList *
+g_reminder_db_cursor_next_page (GReminderDbCursor *self,
+                                guint              limit)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB_CURSOR (self), NULL);
+
+    GReminderDbCursorPrivate *priv = g_reminder_db_cursor_get_instance_private (self);
+    GArray *ids = g_array_sized_new (FALSE, FALSE, sizeof (guint64), MIN (limit, 1024));
+    GSList *items = NULL;
+
+    for (; ids->len < limit && g_reminder_db_cursor_private_has_ids (priv); g_reminder_db_posting_next (priv->posting))
+        g_array_append_val (ids, priv->posting->id);
+
+    if (ids->len)
+        items = g_slist_reverse (g_reminder_db_snapshot_get_items (priv->snapshot, ids, NULL));
+    g_array_unref (ids);
+
+    for (guint n = g_slist_length (items); n < limit && g_reminder_db_cursor_private_get_legacy (priv); ++n)
+    {
+        items = g_slist_prepend (items, priv->legacy->data);
+        priv->legacy = g_slist_delete_link (priv->legacy, priv->legacy);
+    }
+
+    return g_slist_reverse (items);
+}
+
+static void
+g_reminder_db_cursor_finalize (GObject *object)
+{
+    GReminderDbCursorPrivate *priv = g_reminder_db_cursor_get_instance_private (G_REMINDER_DB_CURSOR (object));
+
+    if (priv->posting)
+        g_reminder_db_posting_free (priv->posting);
+    g_slist_free_full (priv->legacy, g_object_unref);
+    g_strfreev (priv->legacy_keywords);
+    g_reminder_db_snapshot_unref (priv->snapshot);
+    g_object_unref (priv->db);
+
+    G_OBJECT_CLASS (g_reminder_db_cursor_parent_class)->finalize (object);
+}
+
+static void
+g_reminder_db_cursor_class_init (GReminderDbCursorClass *klass)
+{
+    G_OBJECT_CLASS (klass)->finalize = g_reminder_db_cursor_finalize;
+}
+
+static void
+g_reminder_db_cursor_init (GReminderDbCursor *self G_GNUC_UNUSED)
+{
+}
+
+GReminderDbCursor *
+g_reminder_db_cursor_new (GObject             *db,
+                          GReminderDbSnapshot *snapshot,
+                          GReminderDbPosting  *posting,
+                          gchar              **legacy_keywords)
+{
+    GReminderDbCursor *self = G_REMINDER_DB_CURSOR (g_object_new (G_REMINDER_TYPE_DB_CURSOR, NULL));
+    GReminderDbCursorPrivate *priv = g_reminder_db_cursor_get_instance_private (self);
+
+    priv->db = g_object_ref (db);
+    priv->snapshot = g_reminder_db_snapshot_ref (snapshot);
+    priv->posting = posting;
+    priv->legacy_keywords = g_strdupv (legacy_keywords);
+    priv->legacy_loaded = FALSE;
+    priv->legacy = NULL;
+
+    return self;
+}
@@ -0,0 +1,64 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_CURSOR_H__
+#define __G_REMINDER_DB_CURSOR_H__
+
+#include "greminder-item.h"
+
+G_BEGIN_DECLS
+
+#define G_REMINDER_TYPE_DB_CURSOR            (g_reminder_db_cursor_get_type ())
+#define G_REMINDER_DB_CURSOR(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), G_REMINDER_TYPE_DB_CURSOR, GReminderDbCursor))
+#define G_REMINDER_IS_DB_CURSOR(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), G_REMINDER_TYPE_DB_CURSOR))
+#define G_REMINDER_DB_CURSOR_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), G_REMINDER_TYPE_DB_CURSOR, GReminderDbCursorClass))
+#define G_REMINDER_IS_DB_CURSOR_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), G_REMINDER_TYPE_DB_CURSOR))
+#define G_REMINDER_DB_CURSOR_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), G_REMINDER_TYPE_DB_CURSOR, GReminderDbCursorClass))
+
+typedef struct _GReminderDbCursor GReminderDbCursor;
+typedef struct _GReminderDbCursorClass GReminderDbCursorClass;
+
+/*
+ * Results of a search, produced on demand in ascending id order. Only the
+ * ids are walked until items are asked for, so the memory used depends on
+ * the page size rather than on the number of matches. Items the schema
+ * migration did not move yet come last.
+ */
+
+G_REMINDER_VISIBLE
+GType g_reminder_db_cursor_get_type (void);
+
+/* Upper bound of the number of matches, known without walking them */
+guint64  g_reminder_db_cursor_get_estimate (const GReminderDbCursor *self);
+gboolean g_reminder_db_cursor_is_done      (const GReminderDbCursor *self);
+
+/* Skip results without loading them, for offset based pagination */
+guint g_reminder_db_cursor_skip (GReminderDbCursor *self,
+                                 guint              count);
+
+/* Resume after the last item of a previous page, for key based pagination */
+void g_reminder_db_cursor_seek_after (GReminderDbCursor *self,
+                                      guint64            id);
+
+GSList *g_reminder_db_cursor_next_page (GReminderDbCursor *self,
+                                        guint              limit);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_CURSOR_H__*/
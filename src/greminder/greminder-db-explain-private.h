@@ -0,0 +1,59 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_EXPLAIN_PRIVATE_H__
+#define __G_REMINDER_DB_EXPLAIN_PRIVATE_H__
+
+#include "greminder-db-explain.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GReminderDbExplainPrivate GReminderDbExplainPrivate;
+
+struct _GReminderDbExplain
+{
+    GObject parent_instance;
+};
+
+struct _GReminderDbExplainClass
+{
+    GObjectClass parent_class;
+};
+
+GReminderDbExplain *g_reminder_db_explain_new (const gchar *query,
+                                               gboolean     analyzed);
+
+void g_reminder_db_explain_add_term (GReminderDbExplain *self,
+                                     const gchar        *keyword,
+                                     guint64             count,
+                                     const gchar        *access);
+/* Takes ownership of the plan */
+void g_reminder_db_explain_set_plan (GReminderDbExplain *self,
+                                     gchar              *plan);
+
+void g_reminder_db_explain_set_counter (GReminderDbExplain        *self,
+                                        GReminderDbExplainCounter  counter,
+                                        guint64                    value);
+void g_reminder_db_explain_add_time    (GReminderDbExplain        *self,
+                                        GReminderDbExplainStage    stage,
+                                        gint64                     usec);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_EXPLAIN_PRIVATE_H__*/
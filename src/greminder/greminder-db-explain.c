@@ -0,0 +1,262 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-explain-private.h"
+
+typedef struct
+{
+    gchar       *keyword;
+    guint64      count;
+    const gchar *access;
+} GReminderDbExplainTerm;
+
+struct _GReminderDbExplainPrivate
+{
+    gchar    *query;
+    gboolean  analyzed;
+
+    GArray   *terms;
+    gchar    *plan;
+
+    guint64   counters[G_REMINDER_DB_EXPLAIN_N_COUNTERS];
+    gint64    times[G_REMINDER_DB_EXPLAIN_N_STAGES];
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (GReminderDbExplain, g_reminder_db_explain, G_TYPE_OBJECT)
+
+static const gchar *g_reminder_db_explain_stages[G_REMINDER_DB_EXPLAIN_N_STAGES] = {
+    "parse", "plan", "join", "load"
+};
+
+static const gchar *g_reminder_db_explain_counters[G_REMINDER_DB_EXPLAIN_N_COUNTERS] = {
+    "matches", "keys", "blocks", "seeks", "items", "item cache hits", "query cache hit"
+};
+
+G_REMINDER_VISIBLE const gchar *
+g_reminder_db_explain_get_query (const GReminderDbExplain *self)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB_EXPLAIN (self), NULL);
+
+    GReminderDbExplainPrivate *priv = g_reminder_db_explain_get_instance_private ((GReminderDbExplain *) self);
+
+    return priv->query;
+}
+
+G_REMINDER_VISIBLE gboolean
+g_reminder_db_explain_is_analyzed (const GReminderDbExplain *self)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB_EXPLAIN (self), FALSE);
+
+    GReminderDbExplainPrivate *priv = g_reminder_db_explain_get_instance_private ((GReminderDbExplain *) self);
+
+    return priv->analyzed;
+}
+
+G_REMINDER_VISIBLE guint
+g_reminder_db_explain_get_n_terms (const GReminderDbExplain *self)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB_EXPLAIN (self), 0);
+
+    GReminderDbExplainPrivate *priv = g_reminder_db_explain_get_instance_private ((GReminderDbExplain *) self);
+
+    return priv->terms->len;
+}
+
+G_REMINDER_VISIBLE const gchar *
+g_reminder_db_explain_get_term (const GReminderDbExplain *self,
+                                guint                     index,
+                                guint64                  *count,
+                                const gchar             **access)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB_EXPLAIN (self), NULL);
+
+    GReminderDbExplainPrivate *priv = g_reminder_db_explain_get_instance_private ((GReminderDbExplain *) self);
+
+    g_return_val_if_fail (index < priv->terms->len, NULL);
+
+    const GReminderDbExplainTerm *term = &g_array_index (priv->terms, GReminderDbExplainTerm, index);
+
+    if (count)
+        *count = term->count;
+    if (access)
+        *access = term->access;
+
+    return term->keyword;
+}
+
+G_REMINDER_VISIBLE const gchar *
+g_reminder_db_explain_get_plan (const GReminderDbExplain *self)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB_EXPLAIN (self), NULL);
+
+    GReminderDbExplainPrivate *priv = g_reminder_db_explain_get_instance_private ((GReminderDbExplain *) self);
+
+    return priv->plan;
+}
+
+G_REMINDER_VISIBLE guint64
+g_reminder_db_explain_get_counter (const GReminderDbExplain *self,
+                                   GReminderDbExplainCounter counter)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB_EXPLAIN (self), 0);
+    g_return_val_if_fail (counter < G_REMINDER_DB_EXPLAIN_N_COUNTERS, 0);
+
+    GReminderDbExplainPrivate *priv = g_reminder_db_explain_get_instance_private ((GReminderDbExplain *) self);
+
+    return priv->counters[counter];
+}
+
+G_REMINDER_VISIBLE gint64
+g_reminder_db_explain_get_time (const GReminderDbExplain *self,
+                                GReminderDbExplainStage   stage)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB_EXPLAIN (self), 0);
+    g_return_val_if_fail (stage < G_REMINDER_DB_EXPLAIN_N_STAGES, 0);
+
+    GReminderDbExplainPrivate *priv = g_reminder_db_explain_get_instance_private ((GReminderDbExplain *) self);
+
+    return priv->times[stage];
+}
+
+G_REMINDER_VISIBLE gchar *
+g_reminder_db_explain_to_string (const GReminderDbExplain *self)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB_EXPLAIN (self), NULL);
+
+    GReminderDbExplainPrivate *priv = g_reminder_db_explain_get_instance_private ((GReminderDbExplain *) self);
+    GString *out = g_string_new (NULL);
+
+    g_string_append_printf (out, "Query: %s\n", priv->query);
+
+    g_string_append (out, "Terms:\n");
+    for (guint i = 0; i < priv->terms->len; ++i)
+    {
+        const GReminderDbExplainTerm *term = &g_array_index (priv->terms, GReminderDbExplainTerm, i);
+        g_string_append_printf (out, "  \"%s\": %" G_GUINT64_FORMAT " items, %s\n", term->keyword, term->count, term->access);
+    }
+
+    g_string_append (out, "Plan:\n");
+    if (priv->plan)
+        g_string_append (out, priv->plan);
+    else
+        g_string_append (out, "  nothing matches\n");
+
+    if (!priv->analyzed)
+        return g_string_free (out, FALSE);
+
+    g_string_append (out, "Counters:\n");
+    for (guint i = 0; i < G_REMINDER_DB_EXPLAIN_N_COUNTERS; ++i)
+        g_string_append_printf (out, "  %s: %" G_GUINT64_FORMAT "\n", g_reminder_db_explain_counters[i], priv->counters[i]);
+
+    g_string_append (out, "Time:\n");
+    for (guint i = 0; i < G_REMINDER_DB_EXPLAIN_N_STAGES; ++i)
+        g_string_append_printf (out, "  %s: %.3f ms\n", g_reminder_db_explain_stages[i], priv->times[i] / 1000.);
+
+    return g_string_free (out, FALSE);
+}
+
+void
+g_reminder_db_explain_add_term (GReminderDbExplain *self,
+                                const gchar        *keyword,
+                                guint64             count,
+                                const gchar        *access)
+{
+    GReminderDbExplainPrivate *priv = g_reminder_db_explain_get_instance_private (self);
+    GReminderDbExplainTerm term = { g_strdup (keyword), count, access };
+
+    g_array_append_val (priv->terms, term);
+}
+
+void
+g_reminder_db_explain_set_plan (GReminderDbExplain *self,
+                                gchar              *plan)
+{
+    GReminderDbExplainPrivate *priv = g_reminder_db_explain_get_instance_private (self);
+
+    g_free (priv->plan);
+    priv->plan = plan;
+}
+
+void
+g_reminder_db_explain_set_counter (GReminderDbExplain        *self,
+                                   GReminderDbExplainCounter  counter,
+                                   guint64                    value)
+{
+    GReminderDbExplainPrivate *priv = g_reminder_db_explain_get_instance_private (self);
+
+    priv->counters[counter] = value;
+}
+
+void
+g_reminder_db_explain_add_time (GReminderDbExplain      *self,
+                                GReminderDbExplainStage  stage,
+                                gint64                   usec)
+{
+    GReminderDbExplainPrivate *priv = g_reminder_db_explain_get_instance_private (self);
+
+    priv->times[stage] += usec;
+}
+
+static void
+g_reminder_db_explain_term_clear (gpointer data)
+{
+    GReminderDbExplainTerm *term = data;
+
+    g_free (term->keyword);
+}
+
+static void
+g_reminder_db_explain_finalize (GObject *object)
+{
+    GReminderDbExplainPrivate *priv = g_reminder_db_explain_get_instance_private (G_REMINDER_DB_EXPLAIN (object));
+
+    g_free (priv->query);
+    g_array_unref (priv->terms);
+    g_free (priv->plan);
+
+    G_OBJECT_CLASS (g_reminder_db_explain_parent_class)->finalize (object);
+}
+
+static void
+g_reminder_db_explain_class_init (GReminderDbExplainClass *klass)
+{
+    G_OBJECT_CLASS (klass)->finalize = g_reminder_db_explain_finalize;
+}
+
+static void
+g_reminder_db_explain_init (GReminderDbExplain *self)
+{
+    GReminderDbExplainPrivate *priv = g_reminder_db_explain_get_instance_private (self);
+
+    priv->terms = g_array_new (FALSE, FALSE, sizeof (GReminderDbExplainTerm));
+    g_array_set_clear_func (priv->terms, g_reminder_db_explain_term_clear);
+}
+
+GReminderDbExplain *
+g_reminder_db_explain_new (const gchar *query,
+                           gboolean     analyzed)
+{
+    GReminderDbExplain *self = G_REMINDER_DB_EXPLAIN (g_object_new (G_REMINDER_TYPE_DB_EXPLAIN, NULL));
+    GReminderDbExplainPrivate *priv = g_reminder_db_explain_get_instance_private (self);
+
+    priv->query = g_strdup (query);
+    priv->analyzed = analyzed;
+
+    return self;
+}
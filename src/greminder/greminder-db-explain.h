@@ -0,0 +1,103 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_EXPLAIN_H__
+#define __G_REMINDER_DB_EXPLAIN_H__
+
+#include "greminder-macros.h"
+
+G_BEGIN_DECLS
+
+#define G_REMINDER_TYPE_DB_EXPLAIN            (g_reminder_db_explain_get_type ())
+#define G_REMINDER_DB_EXPLAIN(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), G_REMINDER_TYPE_DB_EXPLAIN, GReminderDbExplain))
+#define G_REMINDER_IS_DB_EXPLAIN(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), G_REMINDER_TYPE_DB_EXPLAIN))
+#define G_REMINDER_DB_EXPLAIN_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), G_REMINDER_TYPE_DB_EXPLAIN, GReminderDbExplainClass))
+#define G_REMINDER_IS_DB_EXPLAIN_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), G_REMINDER_TYPE_DB_EXPLAIN))
+#define G_REMINDER_DB_EXPLAIN_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), G_REMINDER_TYPE_DB_EXPLAIN, GReminderDbExplainClass))
+
+typedef struct _GReminderDbExplain GReminderDbExplain;
+typedef struct _GReminderDbExplainClass GReminderDbExplainClass;
+
+/*
+ * How a search gets answered: the query as parsed, the keywords it looked
+ * up, and the postings it joins, in evaluation order. Analyzed searches are
+ * run to completion, loading their items, and also report what that cost.
+ */
+
+typedef enum
+{
+    G_REMINDER_DB_EXPLAIN_PARSE,
+    G_REMINDER_DB_EXPLAIN_PLAN,
+    /* Walking the postings for the matching ids */
+    G_REMINDER_DB_EXPLAIN_JOIN,
+    G_REMINDER_DB_EXPLAIN_LOAD,
+    G_REMINDER_DB_EXPLAIN_N_STAGES
+} GReminderDbExplainStage;
+
+typedef enum
+{
+    G_REMINDER_DB_EXPLAIN_MATCHES,
+    /* Posting keys read, the blocks decoded from them, and seeks into postings and records */
+    G_REMINDER_DB_EXPLAIN_KEYS,
+    G_REMINDER_DB_EXPLAIN_BLOCKS,
+    G_REMINDER_DB_EXPLAIN_SEEKS,
+    /* Records read, and items the item cache had already */
+    G_REMINDER_DB_EXPLAIN_ITEMS,
+    G_REMINDER_DB_EXPLAIN_ITEM_CACHE_HITS,
+    /* 1 when the query cache holds the ids of the search, they were computed anyway */
+    G_REMINDER_DB_EXPLAIN_QUERY_CACHE_HIT,
+    G_REMINDER_DB_EXPLAIN_N_COUNTERS
+} GReminderDbExplainCounter;
+
+G_REMINDER_VISIBLE
+GType g_reminder_db_explain_get_type (void);
+
+/* The canonical form of the query, as used by the query cache */
+const gchar *g_reminder_db_explain_get_query   (const GReminderDbExplain *self);
+gboolean     g_reminder_db_explain_is_analyzed (const GReminderDbExplain *self);
+
+/*
+ * Keywords looked up in the dictionary, prefixes included, with the number
+ * of items they tag and how they are read: "bitmap", "blocks" or "none".
+ * Those it does not know are "fuzzy", the closest keyword replacing them
+ * comes next. Prefixes expanding to many keywords come as a single prefix*
+ * term instead, "range", the count adding up those of its keywords.
+ * Prefixes matching more than 4096 keywords are cut to the first ones, and
+ * first come as a prefix* term, "truncated", counting the ones searched.
+ */
+guint        g_reminder_db_explain_get_n_terms (const GReminderDbExplain *self);
+const gchar *g_reminder_db_explain_get_term    (const GReminderDbExplain *self,
+                                                guint                     index,
+                                                guint64                  *count,
+                                                const gchar             **access);
+
+/* One indented line per posting, NULL when the query matches nothing */
+const gchar *g_reminder_db_explain_get_plan (const GReminderDbExplain *self);
+
+/* Only counted and timed for analyzed searches, times are in microseconds */
+guint64 g_reminder_db_explain_get_counter (const GReminderDbExplain *self,
+                                           GReminderDbExplainCounter counter);
+gint64  g_reminder_db_explain_get_time    (const GReminderDbExplain *self,
+                                           GReminderDbExplainStage   stage);
+
+gchar *g_reminder_db_explain_to_string (const GReminderDbExplain *self);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_EXPLAIN_H__*/
@@ -0,0 +1,313 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-fuzzy.h"
+
+#include "greminder-db-record.h"
+#include "greminder-db-text.h"
+
+#include <string.h>
+
+/*
+ * The word being looked up, and the path from the root of the dictionary
+ * to the key being read: one character, byte offset and row of distances
+ * to every prefix of the word per level.
+ */
+typedef struct
+{
+    gunichar *word;
+    glong     len;
+    GArray   *rows;
+    GArray   *chars;
+    GArray   *ends;
+    GString  *path;
+} GReminderDbFuzzyWalk;
+
+#define G_REMINDER_DB_FUZZY_ROW(walk, depth) (&g_array_index ((walk)->rows, guint, (depth) * ((walk)->len + 1)))
+
+static guint
+g_reminder_db_fuzzy_walk_depth (const GReminderDbFuzzyWalk *walk)
+{
+    return walk->ends->len - 1;
+}
+
+/* Back to the deepest level the key shares with the path */
+static void
+g_reminder_db_fuzzy_walk_unwind (GReminderDbFuzzyWalk *walk,
+                                 const gchar          *name,
+                                 gsize                 len)
+{
+    gsize common = 0;
+    guint depth = g_reminder_db_fuzzy_walk_depth (walk);
+
+    while (common < walk->path->len && common < len && walk->path->str[common] == name[common])
+        ++common;
+    while (g_array_index (walk->ends, gsize, depth) > common)
+        --depth;
+
+    g_array_set_size (walk->rows, (depth + 1) * (walk->len + 1));
+    g_array_set_size (walk->chars, depth);
+    g_array_set_size (walk->ends, depth + 1);
+    g_string_truncate (walk->path, g_array_index (walk->ends, gsize, depth));
+}
+
+/* Go one character deeper, returns the smallest distance of the new level */
+static guint
+g_reminder_db_fuzzy_walk_push (GReminderDbFuzzyWalk *walk,
+                               gunichar              c,
+                               const gchar          *bytes,
+                               gsize                 n)
+{
+    guint depth = g_reminder_db_fuzzy_walk_depth (walk);
+    gsize end = g_array_index (walk->ends, gsize, depth) + n;
+
+    g_array_set_size (walk->rows, (depth + 2) * (walk->len + 1));
+
+    const guint *prev = G_REMINDER_DB_FUZZY_ROW (walk, depth);
+    const guint *before = (depth) ? G_REMINDER_DB_FUZZY_ROW (walk, depth - 1) : NULL;
+    gunichar last = (depth) ? g_array_index (walk->chars, gunichar, depth - 1) : 0;
+    guint *row = G_REMINDER_DB_FUZZY_ROW (walk, depth + 1);
+    guint best = row[0] = prev[0] + 1;
+
+    for (glong j = 1; j <= walk->len; ++j)
+    {
+        guint d = MIN (prev[j], row[j - 1]) + 1;
+
+        d = MIN (d, prev[j - 1] + (walk->word[j - 1] != c));
+        /* Swapped characters */
+        if (before && j > 1 && c == walk->word[j - 2] && last == walk->word[j - 1])
+            d = MIN (d, before[j - 2] + 1);
+        row[j] = d;
+        best = MIN (best, d);
+    }
+
+    g_array_append_val (walk->chars, c);
+    g_array_append_val (walk->ends, end);
+    g_string_append_len (walk->path, bytes, n);
+
+    return best;
+}
+
+static gint
+g_reminder_db_fuzzy_match_cmp (gconstpointer a,
+                               gconstpointer b)
+{
+    const GReminderDbFuzzyMatch *x = a;
+    const GReminderDbFuzzyMatch *y = b;
+
+    if (x->distance != y->distance)
+        return (x->distance > y->distance) - (x->distance < y->distance);
+    if (x->count != y->count)
+        return (x->count < y->count) - (x->count > y->count);
+    return strcmp (x->keyword, y->keyword);
+}
+
+static void
+g_reminder_db_fuzzy_match_clear (gpointer data)
+{
+    GReminderDbFuzzyMatch *match = data;
+    g_free (match->keyword);
+}
+
+guint
+g_reminder_db_fuzzy_get_max_edits (const gchar *keyword)
+{
+    glong len = g_utf8_strlen (keyword + g_reminder_db_text_is_term (keyword), -1);
+
+    return (len < 4) ? 0 : (len < 8) ? 1 : 2;
+}
+
+/*
+ * Smallest character after c that the path can go on with without getting
+ * too far from the word. Past max, only characters of the word keep the
+ * distance, when every prefix of the word is that far already.
+ */
+static gboolean
+g_reminder_db_fuzzy_walk_next_char (const GReminderDbFuzzyWalk *walk,
+                                    guint                       max,
+                                    gunichar                    c,
+                                    gunichar                   *next)
+{
+    guint depth = g_reminder_db_fuzzy_walk_depth (walk);
+    const guint *row = G_REMINDER_DB_FUZZY_ROW (walk, depth);
+    const guint *before = (depth) ? G_REMINDER_DB_FUZZY_ROW (walk, depth - 1) : NULL;
+    gunichar last = (depth) ? g_array_index (walk->chars, gunichar, depth - 1) : 0;
+    gboolean found = FALSE;
+
+    for (glong j = 0; j <= walk->len; ++j)
+    {
+        if (row[j] < max)
+        {
+            *next = c + 1;
+            return TRUE;
+        }
+    }
+
+    for (glong j = 1; j <= walk->len; ++j)
+    {
+        gunichar candidate = walk->word[j - 1];
+
+        if (candidate > c && (!found || candidate < *next) && row[j - 1] == max)
+            found = TRUE, *next = candidate;
+        /* Swapped characters */
+        candidate = (j > 1) ? walk->word[j - 2] : 0;
+        if (before && j > 1 && candidate > c && (!found || candidate < *next) && last == walk->word[j - 1] && before[j - 2] + 1 <= max)
+            found = TRUE, *next = candidate;
+    }
+
+    return found;
+}
+
+/*
+ * The last character of the path got it too far from the word: move on to
+ * the first key that goes on with a character that may not, under the same
+ * prefix or under the one before. Returns FALSE once there is none left.
+ */
+static gboolean
+g_reminder_db_fuzzy_skip (GReminderDbFuzzyWalk *walk,
+                          leveldb_iterator_t   *it,
+                          const GString        *prefix,
+                          guint                 max,
+                          GReminderDbSnapshot  *snapshot)
+{
+    G_REMINDER_CLEANUP_STRING_FREE GString *target = g_string_new_len (prefix->str, prefix->len);
+    gchar bytes[6];
+    gunichar next;
+
+    for (;;)
+    {
+        guint depth = g_reminder_db_fuzzy_walk_depth (walk);
+
+        /* Any character goes on from the root */
+        if (!depth)
+            return FALSE;
+
+        gunichar c = g_array_index (walk->chars, gunichar, depth - 1);
+        g_array_set_size (walk->rows, depth * (walk->len + 1));
+        g_array_set_size (walk->chars, depth - 1);
+        g_array_set_size (walk->ends, depth);
+        g_string_truncate (walk->path, g_array_index (walk->ends, gsize, depth - 1));
+
+        if (g_reminder_db_fuzzy_walk_next_char (walk, max, c, &next))
+            break;
+    }
+
+    g_string_append_len (target, walk->path->str, walk->path->len);
+    g_string_append_len (target, bytes, g_unichar_to_utf8 (next, bytes));
+
+    /* Invalid bytes standing for themselves may sort after the target, just step then */
+    size_t klen;
+    const gchar *key = leveldb_iter_key (it, &klen);
+    if (g_reminder_db_key_cmp (key, klen, target) >= 0)
+        leveldb_iter_next (it);
+    else
+    {
+        leveldb_iter_seek (it, target->str, target->len);
+        G_REMINDER_DB_SNAPSHOT_COUNT (snapshot, seeks, 1);
+    }
+
+    return TRUE;
+}
+
+GArray *
+g_reminder_db_fuzzy_lookup (GReminderDbSnapshot *snapshot,
+                            const gchar         *keyword,
+                            guint                max_edits)
+{
+    gboolean term = g_reminder_db_text_is_term (keyword);
+    const gchar mark[] = { G_REMINDER_DB_TEXT_MARK, '\0' };
+    G_REMINDER_CLEANUP_STRING_FREE GString *prefix = g_reminder_db_key_keyword ((term) ? mark : "");
+    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = leveldb_create_iterator (snapshot->db, snapshot->roptions);
+    GArray *matches = g_array_new (FALSE, FALSE, sizeof (GReminderDbFuzzyMatch));
+    GReminderDbFuzzyWalk walk;
+    gsize origin = 0;
+    guint keys = 0;
+
+    g_array_set_clear_func (matches, g_reminder_db_fuzzy_match_clear);
+
+    walk.word = g_utf8_to_ucs4_fast (keyword + term, -1, &walk.len);
+    walk.rows = g_array_new (FALSE, FALSE, sizeof (guint));
+    walk.chars = g_array_new (FALSE, FALSE, sizeof (gunichar));
+    walk.ends = g_array_new (FALSE, FALSE, sizeof (gsize));
+    walk.path = g_string_new (NULL);
+
+    /* The root: the empty prefix is as far from each prefix of the word as it is long */
+    g_array_set_size (walk.rows, walk.len + 1);
+    for (glong j = 0; j <= walk.len; ++j)
+        G_REMINDER_DB_FUZZY_ROW (&walk, 0)[j] = j;
+    g_array_append_val (walk.ends, origin);
+
+    leveldb_iter_seek (it, prefix->str, prefix->len);
+    while (g_reminder_db_iter_has_prefix (it, prefix) && keys < G_REMINDER_DB_FUZZY_MAX_KEYS)
+    {
+        size_t klen, vlen;
+        const gchar *key = leveldb_iter_key (it, &klen);
+        const gchar *name = key + prefix->len;
+        gsize len = klen - prefix->len;
+        gboolean dead = FALSE;
+
+        ++keys;
+        /* Words of the contents come after every keyword */
+        if (!term && len && name[0] == G_REMINDER_DB_TEXT_MARK)
+            break;
+
+        g_reminder_db_fuzzy_walk_unwind (&walk, name, len);
+        for (gsize pos = walk.path->len; pos < len && !dead;)
+        {
+            gunichar c = g_utf8_get_char_validated (name + pos, len - pos);
+            /* Invalid bytes stand for themselves */
+            gsize n = ((gint32) c < 0) ? 1 : (gsize) (g_utf8_next_char (name + pos) - (name + pos));
+
+            if ((gint32) c < 0)
+                c = (guchar) name[pos];
+            dead = (g_reminder_db_fuzzy_walk_push (&walk, c, name + pos, MIN (n, len - pos)) > max_edits);
+            pos += MIN (n, len - pos);
+        }
+
+        if (dead && !g_reminder_db_fuzzy_skip (&walk, it, prefix, max_edits, snapshot))
+            break;
+        if (dead)
+            continue;
+
+        guint distance = G_REMINDER_DB_FUZZY_ROW (&walk, g_reminder_db_fuzzy_walk_depth (&walk))[walk.len];
+        if (distance <= max_edits)
+        {
+            const gchar *value = leveldb_iter_value (it, &vlen);
+            const gchar *data = value;
+            /* Words keep their mark */
+            GReminderDbFuzzyMatch match = { g_reminder_db_strndup (name - term, len + term), distance, 0 };
+
+            if (!g_reminder_db_varint_read (&data, value + vlen, &match.count))
+                match.count = 0;
+            g_array_append_val (matches, match);
+        }
+        leveldb_iter_next (it);
+    }
+
+    G_REMINDER_DB_SNAPSHOT_COUNT (snapshot, keys, keys);
+    g_array_sort (matches, g_reminder_db_fuzzy_match_cmp);
+
+    g_free (walk.word);
+    g_array_unref (walk.rows);
+    g_array_unref (walk.chars);
+    g_array_unref (walk.ends);
+    g_string_free (walk.path, TRUE);
+
+    return matches;
+}
@@ -0,0 +1,64 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_FUZZY_H__
+#define __G_REMINDER_DB_FUZZY_H__
+
+#include "greminder-db-snapshot.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Typo tolerant lookups in the dictionary. The edit distance between the
+ * word and the keywords is computed one character at a time along the
+ * sorted \0K keys, sharing the rows of the prefixes consecutive keys have
+ * in common, which walks the dictionary as a trie. As soon as a prefix is
+ * farther than the allowed distance from every prefix of the word, the walk
+ * seeks to the next character that could still be close enough: only a
+ * small part of the dictionary around the word ever gets read.
+ *
+ * Insertions, deletions, substitutions and swaps of two adjacent characters
+ * count as one edit each. Words of the contents are only matched against
+ * other words, and keywords against keywords.
+ */
+
+/* Keys read before giving up on a lookup */
+#define G_REMINDER_DB_FUZZY_MAX_KEYS 4096
+
+typedef struct
+{
+    gchar   *keyword;
+    guint    distance;
+    guint64  count;
+} GReminderDbFuzzyMatch;
+
+/*
+ * Edits allowed for a keyword: none below 4 characters, where most of the
+ * dictionary is that close, 2 from 8 on, where a walk gets costlier.
+ */
+guint g_reminder_db_fuzzy_get_max_edits (const gchar *keyword);
+
+/* Closest first, then the ones tagging the most items */
+GArray *g_reminder_db_fuzzy_lookup (GReminderDbSnapshot *snapshot,
+                                    const gchar         *keyword,
+                                    guint                max_edits);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_FUZZY_H__*/
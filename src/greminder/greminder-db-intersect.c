@@ -0,0 +1,231 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-intersect.h"
+
+#if defined (__x86_64__) || defined (__i386__)
+#  define G_REMINDER_DB_INTERSECT_X86 1
+#  include <immintrin.h>
+#endif
+
+/* Past this size ratio, galloping through the longer list beats comparing all of it */
+#define G_REMINDER_DB_INTERSECT_SKEW 32
+
+guint
+g_reminder_db_intersect_u16_scalar (const guint16 *a,
+                                    guint          na,
+                                    const guint16 *b,
+                                    guint          nb,
+                                    guint16       *out)
+{
+    guint i = 0, j = 0, n = 0;
+
+    while (i < na && j < nb)
+    {
+        guint16 va = a[i], vb = b[j];
+
+        if (va == vb)
+            out[n++] = va;
+        i += (va <= vb);
+        j += (vb <= va);
+    }
+
+    return n;
+}
+
+/* First index at or after from holding a value greater than or equal to value */
+static guint
+g_reminder_db_intersect_gallop (const guint16 *values,
+                                guint          from,
+                                guint          n,
+                                guint16        value)
+{
+    guint step = 1, lo = from, hi = from;
+
+    while (hi < n && values[hi] < value)
+    {
+        lo = hi + 1;
+        hi += step;
+        step *= 2;
+    }
+    hi = MIN (hi, n);
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+        if (values[mid] < value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* small is walked, each of its values is looked up in large */
+static guint
+g_reminder_db_intersect_u16_gallop (const guint16 *small,
+                                    guint          nsmall,
+                                    const guint16 *large,
+                                    guint          nlarge,
+                                    guint16       *out)
+{
+    guint j = 0, n = 0;
+
+    for (guint i = 0; i < nsmall && j < nlarge; ++i)
+    {
+        j = g_reminder_db_intersect_gallop (large, j, nlarge, small[i]);
+        if (j < nlarge && large[j] == small[i])
+            out[n++] = small[i];
+    }
+
+    return n;
+}
+
+#ifdef G_REMINDER_DB_INTERSECT_X86
+
+/* Compare 8 values of a against 8 of b at once, and move past the block ending first */
+__attribute__((target ("sse4.2")))
+static guint
+g_reminder_db_intersect_u16_sse42 (const guint16 *a,
+                                   guint          na,
+                                   const guint16 *b,
+                                   guint          nb,
+                                   guint16       *out)
+{
+    guint i = 0, j = 0, n = 0;
+
+    while (i + 8 <= na && j + 8 <= nb)
+    {
+        __m128i va = _mm_loadu_si128 ((const __m128i *) (a + i));
+        __m128i vb = _mm_loadu_si128 ((const __m128i *) (b + j));
+        /* Explicit lengths, 0 is a valid value and must not end the comparison */
+        __m128i mask = _mm_cmpestrm (vb, 8, va, 8, _SIDD_UWORD_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK);
+        guint bits = _mm_cvtsi128_si32 (mask);
+        guint16 amax = a[i + 7], bmax = b[j + 7];
+
+        for (; bits; bits &= bits - 1)
+            out[n++] = a[i + __builtin_ctz (bits)];
+
+        i += (amax <= bmax) ? 8 : 0;
+        j += (bmax <= amax) ? 8 : 0;
+    }
+
+    return n + g_reminder_db_intersect_u16_scalar (a + i, na - i, b + j, nb - j, out + n);
+}
+
+/*
+ * Compare 8 values of a against 16 of b at once: a is copied in both lanes
+ * and b rotated within its lanes, so that 8 comparisons cover every pair.
+ */
+__attribute__((target ("avx2")))
+static guint
+g_reminder_db_intersect_u16_avx2 (const guint16 *a,
+                                  guint          na,
+                                  const guint16 *b,
+                                  guint          nb,
+                                  guint16       *out)
+{
+    guint i = 0, j = 0, n = 0;
+
+    while (i + 8 <= na && j + 16 <= nb)
+    {
+        __m256i va = _mm256_broadcastsi128_si256 (_mm_loadu_si128 ((const __m128i *) (a + i)));
+        __m256i vb = _mm256_loadu_si256 ((const __m256i *) (b + j));
+        __m256i eq = _mm256_cmpeq_epi16 (va, vb);
+
+        eq = _mm256_or_si256 (eq, _mm256_cmpeq_epi16 (va, _mm256_alignr_epi8 (vb, vb, 2)));
+        eq = _mm256_or_si256 (eq, _mm256_cmpeq_epi16 (va, _mm256_alignr_epi8 (vb, vb, 4)));
+        eq = _mm256_or_si256 (eq, _mm256_cmpeq_epi16 (va, _mm256_alignr_epi8 (vb, vb, 6)));
+        eq = _mm256_or_si256 (eq, _mm256_cmpeq_epi16 (va, _mm256_alignr_epi8 (vb, vb, 8)));
+        eq = _mm256_or_si256 (eq, _mm256_cmpeq_epi16 (va, _mm256_alignr_epi8 (vb, vb, 10)));
+        eq = _mm256_or_si256 (eq, _mm256_cmpeq_epi16 (va, _mm256_alignr_epi8 (vb, vb, 12)));
+        eq = _mm256_or_si256 (eq, _mm256_cmpeq_epi16 (va, _mm256_alignr_epi8 (vb, vb, 14)));
+
+        /* Both lanes hold the same values of a, each matched against its half of b */
+        __m128i any = _mm_or_si128 (_mm256_castsi256_si128 (eq), _mm256_extracti128_si256 (eq, 1));
+        guint bits = _mm_movemask_epi8 (_mm_packs_epi16 (any, _mm_setzero_si128 ()));
+        guint16 amax = a[i + 7], bmax = b[j + 15];
+
+        for (; bits; bits &= bits - 1)
+            out[n++] = a[i + __builtin_ctz (bits)];
+
+        i += (amax <= bmax) ? 8 : 0;
+        j += (bmax <= amax) ? 16 : 0;
+    }
+
+    return n + g_reminder_db_intersect_u16_sse42 (a + i, na - i, b + j, nb - j, out + n);
+}
+
+#endif /* G_REMINDER_DB_INTERSECT_X86 */
+
+static GReminderDbIntersectFunc
+g_reminder_db_intersect_detect (void)
+{
+#ifdef G_REMINDER_DB_INTERSECT_X86
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2"))
+        return g_reminder_db_intersect_u16_avx2;
+    if (__builtin_cpu_supports ("sse4.2"))
+        return g_reminder_db_intersect_u16_sse42;
+#endif
+    return g_reminder_db_intersect_u16_scalar;
+}
+
+GReminderDbIntersectFunc
+g_reminder_db_intersect_get_kernel (GReminderDbIntersectKernel kernel)
+{
+#ifdef G_REMINDER_DB_INTERSECT_X86
+    __builtin_cpu_init ();
+#endif
+
+    switch (kernel)
+    {
+    case G_REMINDER_DB_INTERSECT_GALLOP:
+        return g_reminder_db_intersect_u16_gallop;
+#ifdef G_REMINDER_DB_INTERSECT_X86
+    case G_REMINDER_DB_INTERSECT_SSE42:
+        return (__builtin_cpu_supports ("sse4.2")) ? g_reminder_db_intersect_u16_sse42 : NULL;
+    case G_REMINDER_DB_INTERSECT_AVX2:
+        return (__builtin_cpu_supports ("avx2")) ? g_reminder_db_intersect_u16_avx2 : NULL;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+guint
+g_reminder_db_intersect_u16 (const guint16 *a,
+                             guint          na,
+                             const guint16 *b,
+                             guint          nb,
+                             guint16       *out)
+{
+    static gsize kernel = 0;
+
+    if (g_once_init_enter (&kernel))
+        g_once_init_leave (&kernel, (gsize) g_reminder_db_intersect_detect ());
+
+    if ((guint64) na * G_REMINDER_DB_INTERSECT_SKEW < nb)
+        return g_reminder_db_intersect_u16_gallop (a, na, b, nb, out);
+    if ((guint64) nb * G_REMINDER_DB_INTERSECT_SKEW < na)
+        return g_reminder_db_intersect_u16_gallop (b, nb, a, na, out);
+
+    return ((GReminderDbIntersectFunc) kernel) (a, na, b, nb, out);
+}
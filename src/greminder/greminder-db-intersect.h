@@ -0,0 +1,68 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_INTERSECT_H__
+#define __G_REMINDER_DB_INTERSECT_H__
+
+#include "greminder-macros.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Intersection of two sorted arrays of distinct values, as found in the
+ * sparse containers of bitmaps. Lists of very different sizes are searched
+ * by galloping through the longer one, others are compared block by block
+ * with the widest vector instructions the CPU supports, as detected on
+ * first use. out must have room for the shorter list. Returns the number
+ * of values written.
+ */
+guint g_reminder_db_intersect_u16 (const guint16 *a,
+                                   guint          na,
+                                   const guint16 *b,
+                                   guint          nb,
+                                   guint16       *out);
+
+/* The portable merge, always available */
+guint g_reminder_db_intersect_u16_scalar (const guint16 *a,
+                                          guint          na,
+                                          const guint16 *b,
+                                          guint          nb,
+                                          guint16       *out);
+
+typedef guint (*GReminderDbIntersectFunc) (const guint16 *a,
+                                           guint          na,
+                                           const guint16 *b,
+                                           guint          nb,
+                                           guint16       *out);
+
+/* The kernels g_reminder_db_intersect_u16 picks from, for tests to check them against the scalar merge */
+typedef enum
+{
+    G_REMINDER_DB_INTERSECT_GALLOP,
+    G_REMINDER_DB_INTERSECT_SSE42,
+    G_REMINDER_DB_INTERSECT_AVX2,
+    G_REMINDER_DB_INTERSECT_N_KERNELS
+} GReminderDbIntersectKernel;
+
+/* NULL if the build or the CPU lacks the instructions it needs */
+GReminderDbIntersectFunc g_reminder_db_intersect_get_kernel (GReminderDbIntersectKernel kernel);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_INTERSECT_H__*/
@@ -0,0 +1,205 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-item-cache.h"
+
+typedef struct
+{
+    guint64        id;
+    GWeakRef       ref;
+    /* Set while the entry is in the LRU, which holds a strong reference */
+    GReminderItem *item;
+    GList         *link;
+} GReminderDbItemCacheEntry;
+
+struct _GReminderDbItemCache
+{
+    GMutex      lock;
+
+    guint       capacity;
+    GHashTable *entries;
+    /* Entries holding a strong reference, most recently used first */
+    GQueue      lru;
+
+    guint64     epoch;
+};
+
+static void
+g_reminder_db_item_cache_entry_free (gpointer data)
+{
+    GReminderDbItemCacheEntry *entry = data;
+
+    g_weak_ref_clear (&entry->ref);
+    g_clear_object (&entry->item);
+    g_free (entry);
+}
+
+GReminderDbItemCache *
+g_reminder_db_item_cache_new (guint capacity)
+{
+    GReminderDbItemCache *self = g_new0 (GReminderDbItemCache, 1);
+
+    g_mutex_init (&self->lock);
+    self->capacity = capacity;
+    self->entries = g_hash_table_new_full (g_int64_hash, g_int64_equal, NULL, g_reminder_db_item_cache_entry_free);
+    g_queue_init (&self->lru);
+
+    return self;
+}
+
+void
+g_reminder_db_item_cache_free (GReminderDbItemCache *self)
+{
+    g_queue_clear (&self->lru);
+    g_hash_table_unref (self->entries);
+    g_mutex_clear (&self->lock);
+    g_free (self);
+}
+
+guint64
+g_reminder_db_item_cache_epoch (GReminderDbItemCache *self)
+{
+    g_mutex_lock (&self->lock);
+    guint64 epoch = self->epoch;
+    g_mutex_unlock (&self->lock);
+
+    return epoch;
+}
+
+static void
+g_reminder_db_item_cache_remove (GReminderDbItemCache      *self,
+                                 GReminderDbItemCacheEntry *entry)
+{
+    if (entry->link)
+        g_queue_delete_link (&self->lru, entry->link);
+    g_hash_table_remove (self->entries, &entry->id);
+}
+
+/* Move to the front of the LRU, demoting the least recently used entries to weak ones */
+static void
+g_reminder_db_item_cache_touch (GReminderDbItemCache      *self,
+                                GReminderDbItemCacheEntry *entry,
+                                GReminderItem             *item)
+{
+    if (entry->link)
+    {
+        g_queue_unlink (&self->lru, entry->link);
+        g_queue_push_head_link (&self->lru, entry->link);
+        return;
+    }
+
+    entry->item = g_object_ref (item);
+    g_queue_push_head (&self->lru, entry);
+    entry->link = g_queue_peek_head_link (&self->lru);
+
+    while (g_queue_get_length (&self->lru) > self->capacity)
+    {
+        GReminderDbItemCacheEntry *last = g_queue_pop_tail (&self->lru);
+        last->link = NULL;
+        g_clear_object (&last->item);
+    }
+}
+
+/* Forget the weak entries whose item is gone, once they outnumber the live ones */
+static void
+g_reminder_db_item_cache_sweep (GReminderDbItemCache *self)
+{
+    if (g_hash_table_size (self->entries) < 2 * self->capacity + 64)
+        return;
+
+    GHashTableIter iter;
+    gpointer value;
+
+    g_hash_table_iter_init (&iter, self->entries);
+    while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+        GReminderDbItemCacheEntry *entry = value;
+        if (entry->link)
+            continue;
+
+        GReminderItem *item = g_weak_ref_get (&entry->ref);
+        if (item)
+            g_object_unref (item);
+        else
+            g_hash_table_iter_remove (&iter);
+    }
+}
+
+GReminderItem *
+g_reminder_db_item_cache_lookup (GReminderDbItemCache *self,
+                                 guint64               id)
+{
+    GReminderItem *item = NULL;
+
+    g_mutex_lock (&self->lock);
+
+    GReminderDbItemCacheEntry *entry = g_hash_table_lookup (self->entries, &id);
+    if (entry)
+    {
+        item = g_weak_ref_get (&entry->ref);
+        if (item)
+            g_reminder_db_item_cache_touch (self, entry, item);
+        else
+            g_reminder_db_item_cache_remove (self, entry);
+    }
+
+    g_mutex_unlock (&self->lock);
+
+    return item;
+}
+
+void
+g_reminder_db_item_cache_insert (GReminderDbItemCache *self,
+                                 GReminderItem        *item,
+                                 guint64               epoch)
+{
+    guint64 id = g_reminder_item_get_id (item);
+
+    g_mutex_lock (&self->lock);
+
+    if (epoch == self->epoch)
+    {
+        GReminderDbItemCacheEntry *entry = g_hash_table_lookup (self->entries, &id);
+        if (entry)
+            g_reminder_db_item_cache_remove (self, entry);
+
+        entry = g_new0 (GReminderDbItemCacheEntry, 1);
+        entry->id = id;
+        g_weak_ref_init (&entry->ref, item);
+        g_hash_table_insert (self->entries, &entry->id, entry);
+        g_reminder_db_item_cache_touch (self, entry, item);
+        g_reminder_db_item_cache_sweep (self);
+    }
+
+    g_mutex_unlock (&self->lock);
+}
+
+void
+g_reminder_db_item_cache_invalidate (GReminderDbItemCache *self,
+                                     guint64               id)
+{
+    g_mutex_lock (&self->lock);
+
+    ++self->epoch;
+    GReminderDbItemCacheEntry *entry = g_hash_table_lookup (self->entries, &id);
+    if (entry)
+        g_reminder_db_item_cache_remove (self, entry);
+
+    g_mutex_unlock (&self->lock);
+}
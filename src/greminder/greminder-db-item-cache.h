@@ -0,0 +1,55 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_ITEM_CACHE_H__
+#define __G_REMINDER_DB_ITEM_CACHE_H__
+
+#include "greminder-item.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Items loaded from the db, by id. The most recently used ones are kept
+ * alive, the others are only tracked through weak references for as long
+ * as somebody else (the editor, a result window) holds them, so that every
+ * lookup of an id shares the same immutable item.
+ *
+ * Loaders insert what they read from a snapshot along with the epoch they
+ * took when creating it: if any item got invalidated since then, what they
+ * read may be stale and is not cached.
+ */
+typedef struct _GReminderDbItemCache GReminderDbItemCache;
+
+GReminderDbItemCache *g_reminder_db_item_cache_new  (guint                 capacity);
+void                  g_reminder_db_item_cache_free (GReminderDbItemCache *self);
+
+guint64 g_reminder_db_item_cache_epoch (GReminderDbItemCache *self);
+
+GReminderItem *g_reminder_db_item_cache_lookup (GReminderDbItemCache *self,
+                                                guint64               id);
+void           g_reminder_db_item_cache_insert (GReminderDbItemCache *self,
+                                                GReminderItem        *item,
+                                                guint64               epoch);
+
+void g_reminder_db_item_cache_invalidate (GReminderDbItemCache *self,
+                                          guint64               id);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_ITEM_CACHE_H__*/
@@ -0,0 +1,140 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-keys.h"
+
+#include <string.h>
+
+GString *
+g_reminder_db_key_new (gchar ns)
+{
+    GString *key = g_string_sized_new (32);
+    g_string_append_c (key, '\0');
+    g_string_append_c (key, ns);
+    return key;
+}
+
+void
+g_reminder_db_key_append_id (GString *key,
+                             guint64  id)
+{
+    guint64 be = GUINT64_TO_BE (id);
+    g_string_append_len (key, (const gchar *) &be, G_REMINDER_DB_ID_LEN);
+}
+
+guint64
+g_reminder_db_key_get_id (const gchar *data)
+{
+    guint64 be;
+    memcpy (&be, data, G_REMINDER_DB_ID_LEN);
+    return GUINT64_FROM_BE (be);
+}
+
+GString *
+g_reminder_db_key_meta (const gchar *name)
+{
+    GString *key = g_reminder_db_key_new (G_REMINDER_DB_NS_META);
+    g_string_append (key, name);
+    return key;
+}
+
+GString *
+g_reminder_db_key_item (guint64 id)
+{
+    GString *key = g_reminder_db_key_new (G_REMINDER_DB_NS_ITEM);
+    g_reminder_db_key_append_id (key, id);
+    return key;
+}
+
+GString *
+g_reminder_db_key_forward_prefix (const gchar *keyword)
+{
+    GString *key = g_reminder_db_key_new (G_REMINDER_DB_NS_FORWARD);
+    g_string_append (key, keyword);
+    g_string_append_c (key, '\0');
+    return key;
+}
+
+GString *
+g_reminder_db_key_forward (const gchar *keyword,
+                           guint64      id)
+{
+    GString *key = g_reminder_db_key_forward_prefix (keyword);
+    g_reminder_db_key_append_id (key, id);
+    return key;
+}
+
+GString *
+g_reminder_db_key_postings_prefix (const gchar *keyword)
+{
+    GString *key = g_reminder_db_key_new (G_REMINDER_DB_NS_POSTINGS);
+    g_string_append (key, keyword);
+    g_string_append_c (key, '\0');
+    return key;
+}
+
+GString *
+g_reminder_db_key_keyword (const gchar *keyword)
+{
+    GString *key = g_reminder_db_key_new (G_REMINDER_DB_NS_KEYWORD);
+    g_string_append (key, keyword);
+    return key;
+}
+
+GString *
+g_reminder_db_key_length (guint64 id)
+{
+    GString *key = g_reminder_db_key_new (G_REMINDER_DB_NS_LENGTH);
+    g_reminder_db_key_append_id (key, id);
+    return key;
+}
+
+gboolean
+g_reminder_db_iter_has_prefix (const leveldb_iterator_t *it,
+                               const GString            *prefix)
+{
+    if (!leveldb_iter_valid (it))
+        return FALSE;
+
+    size_t len;
+    const gchar *key = leveldb_iter_key (it, &len);
+    return (len >= prefix->len && !memcmp (key, prefix->str, prefix->len));
+}
+
+gint
+g_reminder_db_key_cmp (const gchar   *data,
+                       size_t         len,
+                       const GString *key)
+{
+    gint cmp = memcmp (data, key->str, MIN (len, key->len));
+
+    if (cmp)
+        return cmp;
+    return (len > key->len) - (len < key->len);
+}
+
+gchar *
+g_reminder_db_strndup (const gchar *data,
+                       size_t       len)
+{
+    gchar *out = g_new (gchar, len + 1);
+    memcpy (out, data, len);
+    out[len] = '\0';
+    return out;
+}
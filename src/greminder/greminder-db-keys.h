@@ -0,0 +1,135 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_KEYS_H__
+#define __G_REMINDER_DB_KEYS_H__
+
+#include "greminder-macros.h"
+
+#include <leveldb/c.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Schema 6 layout. Every key starts with a NUL byte, which neither a keyword
+ * nor a legacy item key can start with, followed by a namespace byte:
+ *
+ *   \0M<name>                  metadata
+ *   \0I<id>                    item record, see greminder-db-record.h
+ *   \0P<keyword>\0<id>         block of ids ending with id, see greminder-db-block.h
+ *   \0K<keyword>               number of items tagged with keyword, varint,
+ *                              then its spelling if not the keyword itself
+ *   \0L<id>                    length of the item, for ranking, varint
+ *
+ * Keywords are indexed folded, see g_reminder_db_text_fold, and records keep
+ * them as typed. The dictionary shows each as spelled by the first item that
+ * got tagged with it. Words of the contents are indexed as keywords too,
+ * marked so that they sort after all of them, see greminder-db-text.h.
+ *
+ * Ids are stored as 8 bytes big endian so that they sort numerically.
+ *
+ * Schema 2 had one \0F<keyword>\0<id> key with an empty value per posting
+ * instead of the blocks, they get repacked in the background. Schema 3 did
+ * not index the contents, schema 4 did not store the lengths and schema 5
+ * indexed keywords as typed, all of which get fixed in the background too.
+ */
+#define G_REMINDER_DB_SCHEMA_VERSION 6
+#define G_REMINDER_DB_SCHEMA_LENGTHS 5
+#define G_REMINDER_DB_SCHEMA_TEXT    4
+#define G_REMINDER_DB_SCHEMA_BLOCKS  3
+#define G_REMINDER_DB_SCHEMA_FORWARD 2
+
+#define G_REMINDER_DB_NS_META     'M'
+#define G_REMINDER_DB_NS_ITEM     'I'
+#define G_REMINDER_DB_NS_FORWARD  'F'
+#define G_REMINDER_DB_NS_POSTINGS 'P'
+#define G_REMINDER_DB_NS_KEYWORD  'K'
+#define G_REMINDER_DB_NS_LENGTH   'L'
+
+#define G_REMINDER_DB_ID_LEN sizeof (guint64)
+
+#define G_REMINDER_CLEANUP_SLIST_FREE       G_REMINDER_CLEANUP (g_reminder_slist_free_ptr)
+#define G_REMINDER_CLEANUP_STRING_FREE      G_REMINDER_CLEANUP (g_reminder_string_free_ptr)
+#define G_REMINDER_CLEANUP_ARRAY_UNREF      G_REMINDER_CLEANUP (g_reminder_array_unref_ptr)
+#define G_REMINDER_CLEANUP_DB_ITER_DESTROY  G_REMINDER_CLEANUP (g_reminder_db_iter_destroy)
+#define G_REMINDER_CLEANUP_DB_BATCH_DESTROY G_REMINDER_CLEANUP (g_reminder_db_batch_destroy)
+
+static inline void
+g_reminder_slist_free_ptr (GSList **l)
+{
+    g_slist_free_full (*l, g_free);
+    *l = NULL;
+}
+
+static inline void
+g_reminder_string_free_ptr (GString **s)
+{
+    if (*s)
+        g_string_free (*s, TRUE);
+}
+
+static inline void
+g_reminder_array_unref_ptr (GArray **array)
+{
+    if (*array)
+        g_array_unref (*array);
+}
+
+static inline void
+g_reminder_db_iter_destroy (leveldb_iterator_t **it)
+{
+    if (*it)
+        leveldb_iter_destroy (*it);
+}
+
+static inline void
+g_reminder_db_batch_destroy (leveldb_writebatch_t **batch)
+{
+    if (*batch)
+        leveldb_writebatch_destroy (*batch);
+}
+
+GString *g_reminder_db_key_new (gchar ns);
+void     g_reminder_db_key_append_id (GString *key,
+                                      guint64  id);
+guint64  g_reminder_db_key_get_id (const gchar *data);
+
+GString *g_reminder_db_key_meta (const gchar *name);
+GString *g_reminder_db_key_item (guint64 id);
+GString *g_reminder_db_key_forward_prefix (const gchar *keyword);
+GString *g_reminder_db_key_forward (const gchar *keyword,
+                                    guint64      id);
+GString *g_reminder_db_key_postings_prefix (const gchar *keyword);
+GString *g_reminder_db_key_keyword (const gchar *keyword);
+GString *g_reminder_db_key_length (guint64 id);
+
+gboolean g_reminder_db_iter_has_prefix (const leveldb_iterator_t *it,
+                                        const GString            *prefix);
+
+/* Order of keys in the db, as per LevelDB's default bytewise comparator */
+gint g_reminder_db_key_cmp (const gchar   *data,
+                            size_t         len,
+                            const GString *key);
+
+gchar *g_reminder_db_strndup (const gchar *data,
+                              size_t       len);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_KEYS_H__*/
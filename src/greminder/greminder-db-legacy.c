@@ -0,0 +1,233 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-legacy.h"
+
+#include <string.h>
+
+#define G_REMINDER_DB_LEGACY_ID_KEY_LEN 16
+
+static gchar *
+g_reminder_db_legacy_item_key (const GReminderItem *item)
+{
+    guint64 id = g_reminder_item_get_id (item);
+
+    if (id)
+        return g_strdup_printf ("%016" G_GINT64_MODIFIER "x", id);
+    return g_strdup (g_reminder_item_get_checksum (item));
+}
+
+static guint64
+g_reminder_db_legacy_id_from_key (const gchar *key)
+{
+    if (strlen (key) != G_REMINDER_DB_LEGACY_ID_KEY_LEN)
+        return 0;
+    return g_ascii_strtoull (key, NULL, 16);
+}
+
+static void
+g_reminder_db_legacy_delete_suffix (leveldb_writebatch_t *batch,
+                                    const gchar          *key,
+                                    const gchar          *suffix)
+{
+    G_REMINDER_CLEANUP_FREE gchar *_key = g_strdup_printf ("%s%c%s", key, '\0', suffix);
+    leveldb_writebatch_delete (batch, _key, strlen (key) + strlen (suffix) + 1);
+}
+
+void
+g_reminder_db_legacy_seek_first (leveldb_iterator_t *it)
+{
+    /* Everything that doesn't start with a NUL byte belongs to schema 1 */
+    leveldb_iter_seek (it, "\001", 1);
+}
+
+gboolean
+g_reminder_db_legacy_is_item_key (const gchar *key,
+                                  size_t       len)
+{
+    return (len && key[0] && !memchr (key, '\0', len));
+}
+
+GReminderItem *
+g_reminder_db_legacy_read_item (leveldb_iterator_t *it)
+{
+    G_REMINDER_CLEANUP_SLIST_FREE GSList *keywords = NULL;
+    size_t len;
+    const gchar *_key = leveldb_iter_key (it, &len);
+    G_REMINDER_CLEANUP_FREE gchar *key = g_reminder_db_strndup (_key, len);
+    size_t klen = len;
+    const gchar *_contents = leveldb_iter_value (it, &len);
+    G_REMINDER_CLEANUP_FREE gchar *contents = g_reminder_db_strndup (_contents, len);
+
+    /* The reverse entries of an item directly follow its contents */
+    for (leveldb_iter_next (it); leveldb_iter_valid (it); leveldb_iter_next (it))
+    {
+        _key = leveldb_iter_key (it, &len);
+        if (len <= klen || _key[klen] || memcmp (_key, key, klen))
+            break;
+        keywords = g_slist_prepend (keywords, g_reminder_db_strndup (_key + klen + 1, len - klen - 1));
+    }
+    keywords = g_slist_reverse (keywords);
+
+    if (!keywords)
+        return NULL;
+
+    return g_reminder_item_new (g_reminder_db_legacy_id_from_key (key), keywords, contents);
+}
+
+void
+g_reminder_db_legacy_delete_item (leveldb_writebatch_t *batch,
+                                  const GReminderItem  *item)
+{
+    G_REMINDER_CLEANUP_FREE gchar *key = g_reminder_db_legacy_item_key (item);
+
+    leveldb_writebatch_delete (batch, key, strlen (key));
+
+    for (const GSList *k = g_reminder_item_get_keywords (item); k; k = g_slist_next (k))
+    {
+        g_reminder_db_legacy_delete_suffix (batch, k->data, key);
+        g_reminder_db_legacy_delete_suffix (batch, key, k->data);
+    }
+}
+
+static GSList *
+g_reminder_db_legacy_find_one (leveldb_t                   *db,
+                               const leveldb_readoptions_t *roptions,
+                               const gchar                 *keyword)
+{
+    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = leveldb_create_iterator (db, roptions);
+    GSList *items = NULL;
+    size_t len;
+    size_t klen = strlen (keyword);
+
+    leveldb_iter_seek (it, keyword, klen);
+    while (leveldb_iter_valid (it))
+    {
+        const gchar *key = leveldb_iter_key (it, &len);
+        if (klen != len && key[klen])
+            break;
+        if (memcmp (keyword, key, klen))
+            break;
+        items = g_slist_prepend (items, g_reminder_db_strndup (leveldb_iter_value (it, &len), len));
+        leveldb_iter_next (it);
+    }
+
+    return items;
+}
+
+static GReminderItem *
+g_reminder_db_legacy_get_item (leveldb_t                   *db,
+                               const leveldb_readoptions_t *roptions,
+                               const gchar                 *hash)
+{
+    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = leveldb_create_iterator (db, roptions);
+    size_t hlen = strlen (hash);
+
+    leveldb_iter_seek (it, hash, hlen);
+    if (!leveldb_iter_valid (it))
+        return NULL;
+
+    size_t len;
+    const gchar *key = leveldb_iter_key (it, &len);
+    if (len != hlen || memcmp (key, hash, hlen))
+        return NULL;
+
+    return g_reminder_db_legacy_read_item (it);
+}
+
+GSList *
+g_reminder_db_legacy_find (leveldb_t                   *db,
+                           const leveldb_readoptions_t *roptions,
+                           gchar                      **keywords)
+{
+    G_REMINDER_CLEANUP_SLIST_FREE GSList *hashs = NULL;
+    GSList *items = NULL;
+
+    for (gchar **k = keywords; *k; ++k)
+    {
+        GSList *hs = g_reminder_db_legacy_find_one (db, roptions, *k);
+        if (!hashs)
+        {
+            hashs = hs;
+            continue;
+        }
+
+        GSList *_hashs = NULL;
+        for (GSList *h = hs; h; h = g_slist_next (h))
+        {
+            for (GSList *__hashs = hashs; __hashs; __hashs = g_slist_next (__hashs))
+            {
+                if (!g_strcmp0 (__hashs->data, h->data))
+                    _hashs = g_slist_prepend (_hashs, g_strdup (h->data));
+            }
+        }
+        g_slist_free_full (hs, g_free);
+        g_slist_free_full (hashs, g_free);
+        hashs = _hashs;
+        if (!hashs)
+            break;
+    }
+
+    for (GSList *_hashs = hashs; _hashs; _hashs = g_slist_next (_hashs))
+    {
+        GReminderItem *item = g_reminder_db_legacy_get_item (db, roptions, _hashs->data);
+        if (!item)
+            continue;
+        items = g_slist_prepend (items, item);
+    }
+
+    return items;
+}
+
+GSList *
+g_reminder_db_legacy_get_keywords (leveldb_t                   *db,
+                                   const leveldb_readoptions_t *roptions)
+{
+    GSList *keywords = NULL;
+    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = leveldb_create_iterator (db, roptions);
+    G_REMINDER_CLEANUP_FREE gchar *last_hash = NULL;
+
+    for (g_reminder_db_legacy_seek_first (it); leveldb_iter_valid (it); leveldb_iter_next (it))
+    {
+        size_t len;
+        const gchar *key = leveldb_iter_key (it, &len);
+        if (g_reminder_db_legacy_is_item_key (key, len))
+        {
+            g_free (last_hash);
+            last_hash = g_reminder_db_strndup (key, len);
+            continue;
+        }
+        if (last_hash && !g_strcmp0 (key, last_hash))
+            continue;
+
+        gboolean found = FALSE;
+        for (const GSList *k = keywords; k; k = g_slist_next (k))
+        {
+            if (!g_strcmp0 (k->data, key))
+            {
+                found = TRUE;
+                break;
+            }
+        }
+        if (!found)
+            keywords = g_slist_insert_sorted (keywords, g_strdup (key), (GCompareFunc) g_strcmp0);
+    }
+
+    return keywords;
+}
@@ -0,0 +1,54 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_LEGACY_H__
+#define __G_REMINDER_DB_LEGACY_H__
+
+#include "greminder-db-keys.h"
+#include "greminder-item.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Schema 1 layout, which shares one keyspace between contents (<key>),
+ * forward (<keyword>\0<key>) and reverse (<key>\0<keyword>) entries. <key>
+ * is either the sha1 of the contents or the hex form of the item id. It is
+ * only read until the migration to the current schema has completed.
+ */
+
+void g_reminder_db_legacy_seek_first (leveldb_iterator_t *it);
+
+gboolean g_reminder_db_legacy_is_item_key (const gchar *key,
+                                           size_t       len);
+
+GReminderItem *g_reminder_db_legacy_read_item (leveldb_iterator_t *it);
+
+void g_reminder_db_legacy_delete_item (leveldb_writebatch_t *batch,
+                                       const GReminderItem  *item);
+
+GSList *g_reminder_db_legacy_find (leveldb_t                   *db,
+                                   const leveldb_readoptions_t *roptions,
+                                   gchar                      **keywords);
+
+GSList *g_reminder_db_legacy_get_keywords (leveldb_t                   *db,
+                                           const leveldb_readoptions_t *roptions);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_LEGACY_H__*/
@@ -0,0 +1,1042 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-posting.h"
+
+#include "greminder-db-block.h"
+#include "greminder-db-text.h"
+
+#include <string.h>
+
+/*
+ * How many entries (or blocks, for term postings) a posting walks before
+ * giving up and seeking. Stepping is cheaper than seeking while the target
+ * is close, which is the common case when both lists have a similar density.
+ */
+#define G_REMINDER_DB_POSTING_GALLOP 8
+
+/*
+ * Bounds of the chunks a background scan hands over. The first ones are
+ * small so that the join can start right away, later ones grow to keep the
+ * queue traffic low.
+ */
+#define G_REMINDER_DB_SCAN_CHUNK_MIN 64
+#define G_REMINDER_DB_SCAN_CHUNK_MAX 4096
+
+/* Terms with more ids than this are read without filling the block cache */
+#define G_REMINDER_DB_POSTING_LARGE 1024
+
+void
+g_reminder_db_posting_next (GReminderDbPosting *self)
+{
+    if (self->done)
+        return;
+    ++self->steps;
+    self->klass->next (self);
+}
+
+void
+g_reminder_db_posting_seek (GReminderDbPosting *self,
+                            guint64             target)
+{
+    if (self->done || self->id >= target)
+        return;
+    ++self->steps;
+    self->klass->seek (self, target);
+}
+
+void
+g_reminder_db_posting_free (GReminderDbPosting *self)
+{
+    self->klass->free (self);
+}
+
+void
+g_reminder_db_posting_describe (GReminderDbPosting *self,
+                                GString            *out,
+                                guint               depth)
+{
+    g_string_append_printf (out, "%*s", depth * 2, "");
+    self->klass->describe (self, out, depth);
+}
+
+static void
+g_reminder_db_posting_describe_line (GReminderDbPosting *self,
+                                     GString            *out,
+                                     const gchar        *kind,
+                                     const GString      *prefix)
+{
+    g_string_append (out, kind);
+    /* Keyword prefixes are the namespace, the keyword and a separator */
+    if (prefix && prefix->str[2] == G_REMINDER_DB_TEXT_MARK)
+        g_string_append_printf (out, " text:\"%.*s\"", (gint) (prefix->len - 4), prefix->str + 3);
+    else if (prefix)
+        g_string_append_printf (out, " \"%.*s\"", (gint) (prefix->len - 3), prefix->str + 2);
+    g_string_append_printf (out, ", estimate %" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT " steps\n", self->estimate, self->steps);
+}
+
+static void
+g_reminder_db_posting_describe_children (GPtrArray *children,
+                                         GString   *out,
+                                         guint      depth)
+{
+    for (guint i = 0; i < children->len; ++i)
+        g_reminder_db_posting_describe (g_ptr_array_index (children, i), out, depth + 1);
+}
+
+GArray *
+g_reminder_db_posting_collect (GReminderDbPosting *self)
+{
+    GArray *ids = g_array_sized_new (FALSE, FALSE, sizeof (guint64), MIN (self->estimate, 1024));
+
+    for (; !self->done; g_reminder_db_posting_next (self))
+        g_array_append_val (ids, self->id);
+
+    return ids;
+}
+
+/* Term postings: the posting blocks of one keyword, decoded one at a time */
+
+typedef struct
+{
+    GReminderDbPosting   parent;
+
+    GReminderDbSnapshot *snapshot;
+    leveldb_iterator_t  *it;
+    GString             *prefix;
+    /* Ids of the block the iterator is on */
+    GArray              *block;
+    guint                pos;
+} GReminderDbTermPosting;
+
+/* Decode the block the iterator is on, or the next readable one */
+static void
+g_reminder_db_term_posting_read (GReminderDbTermPosting *self)
+{
+    size_t len;
+
+    for (; g_reminder_db_iter_has_prefix (self->it, self->prefix); leveldb_iter_next (self->it))
+    {
+        const gchar *value = leveldb_iter_value (self->it, &len);
+
+        G_REMINDER_DB_SNAPSHOT_COUNT (self->snapshot, keys, 1);
+        G_REMINDER_DB_SNAPSHOT_COUNT (self->snapshot, blocks, 1);
+        g_array_set_size (self->block, 0);
+        if (!g_reminder_db_block_decode (value, len, self->block) || !self->block->len)
+            continue;
+
+        self->pos = 0;
+        self->parent.id = g_array_index (self->block, guint64, 0);
+        return;
+    }
+
+    self->parent.done = TRUE;
+}
+
+static void
+g_reminder_db_term_posting_next (GReminderDbPosting *posting)
+{
+    GReminderDbTermPosting *self = (GReminderDbTermPosting *) posting;
+
+    if (++self->pos < self->block->len)
+    {
+        posting->id = g_array_index (self->block, guint64, self->pos);
+        return;
+    }
+
+    leveldb_iter_next (self->it);
+    g_reminder_db_term_posting_read (self);
+}
+
+/* Whether the block the iterator is on ends before target, without decoding it */
+static gboolean
+g_reminder_db_term_posting_before (GReminderDbTermPosting *self,
+                                   guint64                 target)
+{
+    size_t len;
+    const gchar *key = leveldb_iter_key (self->it, &len);
+
+    return g_reminder_db_key_get_id (key + self->prefix->len) < target;
+}
+
+static void
+g_reminder_db_term_posting_seek (GReminderDbPosting *posting,
+                                 guint64             target)
+{
+    GReminderDbTermPosting *self = (GReminderDbTermPosting *) posting;
+
+    if (g_array_index (self->block, guint64, self->block->len - 1) < target)
+    {
+        guint i = 0;
+
+        /* Block keys hold their last id, blocks ending before the target are skipped unread */
+        for (leveldb_iter_next (self->it); i < G_REMINDER_DB_POSTING_GALLOP; ++i, leveldb_iter_next (self->it))
+        {
+            if (!g_reminder_db_iter_has_prefix (self->it, self->prefix) || !g_reminder_db_term_posting_before (self, target))
+                break;
+            G_REMINDER_DB_SNAPSHOT_COUNT (self->snapshot, keys, 1);
+        }
+
+        if (i == G_REMINDER_DB_POSTING_GALLOP)
+        {
+            gsize len = self->prefix->len;
+            G_REMINDER_DB_SNAPSHOT_COUNT (self->snapshot, seeks, 1);
+            g_reminder_db_key_append_id (self->prefix, target);
+            leveldb_iter_seek (self->it, self->prefix->str, self->prefix->len);
+            g_string_truncate (self->prefix, len);
+        }
+
+        g_reminder_db_term_posting_read (self);
+        if (posting->done)
+            return;
+    }
+
+    guint lo = self->pos, hi = self->block->len - 1;
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+        if (g_array_index (self->block, guint64, mid) < target)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    self->pos = lo;
+    posting->id = g_array_index (self->block, guint64, lo);
+}
+
+static void
+g_reminder_db_term_posting_free (GReminderDbPosting *posting)
+{
+    GReminderDbTermPosting *self = (GReminderDbTermPosting *) posting;
+
+    leveldb_iter_destroy (self->it);
+    g_string_free (self->prefix, TRUE);
+    g_array_unref (self->block);
+    g_free (self);
+}
+
+static void
+g_reminder_db_term_posting_describe (GReminderDbPosting *posting,
+                                     GString            *out,
+                                     guint               depth G_GNUC_UNUSED)
+{
+    g_reminder_db_posting_describe_line (posting, out, "blocks", ((GReminderDbTermPosting *) posting)->prefix);
+}
+
+static const GReminderDbPostingClass g_reminder_db_term_posting_class = {
+    .next = g_reminder_db_term_posting_next,
+    .seek = g_reminder_db_term_posting_seek,
+    .free = g_reminder_db_term_posting_free,
+    .describe = g_reminder_db_term_posting_describe
+};
+
+GReminderDbPosting *
+g_reminder_db_posting_new_term (GReminderDbSnapshot *snapshot,
+                                const gchar         *keyword,
+                                guint64              count)
+{
+    GReminderDbTermPosting *self = g_new0 (GReminderDbTermPosting, 1);
+
+    self->parent.klass = &g_reminder_db_term_posting_class;
+    self->parent.estimate = count;
+    self->prefix = g_reminder_db_key_postings_prefix (keyword);
+    self->block = g_array_sized_new (FALSE, FALSE, sizeof (guint64), G_REMINDER_DB_BLOCK_MAX);
+    self->snapshot = snapshot;
+    self->it = leveldb_create_iterator (snapshot->db, (count > G_REMINDER_DB_POSTING_LARGE) ? snapshot->scan_roptions : snapshot->roptions);
+
+    G_REMINDER_DB_SNAPSHOT_COUNT (snapshot, seeks, 1);
+    leveldb_iter_seek (self->it, self->prefix->str, self->prefix->len);
+    g_reminder_db_term_posting_read (self);
+
+    return &self->parent;
+}
+
+/* Forward postings: a range scan over the schema 2 postings of one keyword, read while they get repacked */
+
+typedef struct
+{
+    GReminderDbPosting   parent;
+
+    GReminderDbSnapshot *snapshot;
+    leveldb_iterator_t  *it;
+    GString             *prefix;
+} GReminderDbForwardPosting;
+
+static void
+g_reminder_db_forward_posting_read (GReminderDbForwardPosting *self)
+{
+    size_t len;
+
+    for (; g_reminder_db_iter_has_prefix (self->it, self->prefix); leveldb_iter_next (self->it))
+    {
+        const gchar *key = leveldb_iter_key (self->it, &len);
+        G_REMINDER_DB_SNAPSHOT_COUNT (self->snapshot, keys, 1);
+        if (len != self->prefix->len + G_REMINDER_DB_ID_LEN)
+            continue;
+        self->parent.id = g_reminder_db_key_get_id (key + self->prefix->len);
+        return;
+    }
+
+    self->parent.done = TRUE;
+}
+
+static void
+g_reminder_db_forward_posting_next (GReminderDbPosting *posting)
+{
+    GReminderDbForwardPosting *self = (GReminderDbForwardPosting *) posting;
+
+    leveldb_iter_next (self->it);
+    g_reminder_db_forward_posting_read (self);
+}
+
+static void
+g_reminder_db_forward_posting_seek (GReminderDbPosting *posting,
+                                 guint64             target)
+{
+    GReminderDbForwardPosting *self = (GReminderDbForwardPosting *) posting;
+
+    for (guint i = 0; i < G_REMINDER_DB_POSTING_GALLOP; ++i)
+    {
+        g_reminder_db_forward_posting_next (posting);
+        if (posting->done || posting->id >= target)
+            return;
+    }
+
+    gsize len = self->prefix->len;
+    G_REMINDER_DB_SNAPSHOT_COUNT (self->snapshot, seeks, 1);
+    g_reminder_db_key_append_id (self->prefix, target);
+    leveldb_iter_seek (self->it, self->prefix->str, self->prefix->len);
+    g_string_truncate (self->prefix, len);
+    g_reminder_db_forward_posting_read (self);
+}
+
+static void
+g_reminder_db_forward_posting_free (GReminderDbPosting *posting)
+{
+    GReminderDbForwardPosting *self = (GReminderDbForwardPosting *) posting;
+
+    leveldb_iter_destroy (self->it);
+    g_string_free (self->prefix, TRUE);
+    g_free (self);
+}
+
+static void
+g_reminder_db_forward_posting_describe (GReminderDbPosting *posting,
+                                        GString            *out,
+                                        guint               depth G_GNUC_UNUSED)
+{
+    g_reminder_db_posting_describe_line (posting, out, "forward", ((GReminderDbForwardPosting *) posting)->prefix);
+}
+
+static const GReminderDbPostingClass g_reminder_db_forward_posting_class = {
+    .next = g_reminder_db_forward_posting_next,
+    .seek = g_reminder_db_forward_posting_seek,
+    .free = g_reminder_db_forward_posting_free,
+    .describe = g_reminder_db_forward_posting_describe
+};
+
+GReminderDbPosting *
+g_reminder_db_posting_new_forward (GReminderDbSnapshot *snapshot,
+                                   const gchar         *keyword,
+                                   guint64              count)
+{
+    GReminderDbForwardPosting *self = g_new0 (GReminderDbForwardPosting, 1);
+
+    self->parent.klass = &g_reminder_db_forward_posting_class;
+    self->parent.estimate = count;
+    self->prefix = g_reminder_db_key_forward_prefix (keyword);
+    self->snapshot = snapshot;
+    self->it = leveldb_create_iterator (snapshot->db, snapshot->scan_roptions);
+
+    G_REMINDER_DB_SNAPSHOT_COUNT (snapshot, seeks, 1);
+    leveldb_iter_seek (self->it, self->prefix->str, self->prefix->len);
+    g_reminder_db_forward_posting_read (self);
+
+    return &self->parent;
+}
+
+/*
+ * Scan postings: the blocks of a term posting, read to completion on a
+ * thread pool. The ids are handed over in chunks as they are decoded, so
+ * that the join consumes all the terms of a query while they are scanned.
+ */
+
+typedef struct
+{
+    gint                 ref;
+    gint                 cancelled;
+
+    GReminderDbSnapshot *snapshot;
+    GString             *prefix;
+    /* Chunks of ids, an empty one marks the end */
+    GAsyncQueue         *chunks;
+} GReminderDbScan;
+
+static void
+g_reminder_db_scan_unref (GReminderDbScan *scan)
+{
+    if (!g_atomic_int_dec_and_test (&scan->ref))
+        return;
+
+    g_reminder_db_snapshot_unref (scan->snapshot);
+    g_string_free (scan->prefix, TRUE);
+    g_async_queue_unref (scan->chunks);
+    g_free (scan);
+}
+
+static void
+g_reminder_db_scan_run (gpointer data,
+                        gpointer user_data G_GNUC_UNUSED)
+{
+    GReminderDbScan *scan = data;
+    guint size = G_REMINDER_DB_SCAN_CHUNK_MIN;
+    GArray *chunk = g_array_sized_new (FALSE, FALSE, sizeof (guint64), size);
+
+    if (!g_atomic_int_get (&scan->cancelled))
+    {
+        G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = leveldb_create_iterator (scan->snapshot->db, scan->snapshot->scan_roptions);
+        size_t len;
+
+        G_REMINDER_DB_SNAPSHOT_COUNT (scan->snapshot, seeks, 1);
+        for (leveldb_iter_seek (it, scan->prefix->str, scan->prefix->len); g_reminder_db_iter_has_prefix (it, scan->prefix); leveldb_iter_next (it))
+        {
+            const gchar *value = leveldb_iter_value (it, &len);
+            guint n = chunk->len;
+
+            G_REMINDER_DB_SNAPSHOT_COUNT (scan->snapshot, keys, 1);
+            G_REMINDER_DB_SNAPSHOT_COUNT (scan->snapshot, blocks, 1);
+            /* Drop what a corrupted block decoded to, like term postings do */
+            if (!g_reminder_db_block_decode (value, len, chunk))
+                g_array_set_size (chunk, n);
+            if (chunk->len < size)
+                continue;
+
+            g_async_queue_push (scan->chunks, chunk);
+            /* Nobody is reading anymore, the join is over */
+            if (g_atomic_int_get (&scan->cancelled))
+            {
+                chunk = NULL;
+                break;
+            }
+            size = MIN (size * 2, G_REMINDER_DB_SCAN_CHUNK_MAX);
+            chunk = g_array_sized_new (FALSE, FALSE, sizeof (guint64), size);
+        }
+    }
+
+    if (chunk && chunk->len)
+    {
+        g_async_queue_push (scan->chunks, chunk);
+        chunk = NULL;
+    }
+    g_async_queue_push (scan->chunks, (chunk) ? chunk : g_array_new (FALSE, FALSE, sizeof (guint64)));
+    g_reminder_db_scan_unref (scan);
+}
+
+GThreadPool *
+g_reminder_db_posting_pool_new (gint max_threads)
+{
+    return g_thread_pool_new (g_reminder_db_scan_run, NULL, max_threads, FALSE, NULL);
+}
+
+typedef struct
+{
+    GReminderDbPosting  parent;
+
+    GReminderDbScan    *scan;
+    GArray             *chunk;
+    guint               pos;
+} GReminderDbScanPosting;
+
+/* Wait for the next chunk of ids, FALSE once the scan is over */
+static gboolean
+g_reminder_db_scan_posting_fill (GReminderDbScanPosting *self)
+{
+    if (self->chunk)
+        g_array_unref (self->chunk);
+
+    self->chunk = g_async_queue_pop (self->scan->chunks);
+    self->pos = 0;
+
+    if (self->chunk->len)
+        return TRUE;
+
+    self->parent.done = TRUE;
+    return FALSE;
+}
+
+static void
+g_reminder_db_scan_posting_read (GReminderDbScanPosting *self)
+{
+    if ((self->chunk && self->pos < self->chunk->len) || g_reminder_db_scan_posting_fill (self))
+        self->parent.id = g_array_index (self->chunk, guint64, self->pos);
+}
+
+static void
+g_reminder_db_scan_posting_next (GReminderDbPosting *posting)
+{
+    GReminderDbScanPosting *self = (GReminderDbScanPosting *) posting;
+
+    ++self->pos;
+    g_reminder_db_scan_posting_read (self);
+}
+
+static void
+g_reminder_db_scan_posting_seek (GReminderDbPosting *posting,
+                                 guint64             target)
+{
+    GReminderDbScanPosting *self = (GReminderDbScanPosting *) posting;
+
+    /* Whole chunks ending before the target are skipped without looking at them */
+    while (g_array_index (self->chunk, guint64, self->chunk->len - 1) < target)
+    {
+        if (!g_reminder_db_scan_posting_fill (self))
+            return;
+    }
+
+    guint lo = self->pos, hi = self->chunk->len - 1;
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+        if (g_array_index (self->chunk, guint64, mid) < target)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    self->pos = lo;
+    self->parent.id = g_array_index (self->chunk, guint64, lo);
+}
+
+static void
+g_reminder_db_scan_posting_free (GReminderDbPosting *posting)
+{
+    GReminderDbScanPosting *self = (GReminderDbScanPosting *) posting;
+
+    g_atomic_int_set (&self->scan->cancelled, TRUE);
+    if (self->chunk)
+        g_array_unref (self->chunk);
+    g_reminder_db_scan_unref (self->scan);
+    g_free (self);
+}
+
+static void
+g_reminder_db_scan_posting_describe (GReminderDbPosting *posting,
+                                     GString            *out,
+                                     guint               depth G_GNUC_UNUSED)
+{
+    g_reminder_db_posting_describe_line (posting, out, "scan", ((GReminderDbScanPosting *) posting)->scan->prefix);
+}
+
+static const GReminderDbPostingClass g_reminder_db_scan_posting_class = {
+    .next = g_reminder_db_scan_posting_next,
+    .seek = g_reminder_db_scan_posting_seek,
+    .free = g_reminder_db_scan_posting_free,
+    .describe = g_reminder_db_scan_posting_describe
+};
+
+GReminderDbPosting *
+g_reminder_db_posting_new_scan (GThreadPool         *pool,
+                                GReminderDbSnapshot *snapshot,
+                                const gchar         *keyword,
+                                guint64              count)
+{
+    GReminderDbScanPosting *self = g_new0 (GReminderDbScanPosting, 1);
+    GReminderDbScan *scan = g_new0 (GReminderDbScan, 1);
+
+    scan->ref = 2;
+    scan->snapshot = g_reminder_db_snapshot_ref (snapshot);
+    scan->prefix = g_reminder_db_key_postings_prefix (keyword);
+    scan->chunks = g_async_queue_new_full ((GDestroyNotify) g_array_unref);
+    g_thread_pool_push (pool, scan, NULL);
+
+    self->parent.klass = &g_reminder_db_scan_posting_class;
+    self->parent.estimate = count;
+    self->scan = scan;
+
+    g_reminder_db_scan_posting_read (self);
+
+    return &self->parent;
+}
+
+/* Bitmap postings: the ids of an in-memory bitmap */
+
+typedef struct
+{
+    GReminderDbPosting  parent;
+
+    GReminderDbBitmap  *bitmap;
+    guint               hint;
+} GReminderDbBitmapPosting;
+
+static void
+g_reminder_db_bitmap_posting_seek (GReminderDbPosting *posting,
+                                   guint64             target)
+{
+    GReminderDbBitmapPosting *self = (GReminderDbBitmapPosting *) posting;
+
+    if (!g_reminder_db_bitmap_next (self->bitmap, target, &self->hint, &posting->id))
+        posting->done = TRUE;
+}
+
+static void
+g_reminder_db_bitmap_posting_next (GReminderDbPosting *posting)
+{
+    g_reminder_db_bitmap_posting_seek (posting, posting->id + 1);
+}
+
+static void
+g_reminder_db_bitmap_posting_free (GReminderDbPosting *posting)
+{
+    GReminderDbBitmapPosting *self = (GReminderDbBitmapPosting *) posting;
+
+    g_reminder_db_bitmap_unref (self->bitmap);
+    g_free (self);
+}
+
+static void
+g_reminder_db_bitmap_posting_describe (GReminderDbPosting *posting,
+                                       GString            *out,
+                                       guint               depth G_GNUC_UNUSED)
+{
+    g_reminder_db_posting_describe_line (posting, out, "bitmap", NULL);
+}
+
+static const GReminderDbPostingClass g_reminder_db_bitmap_posting_class = {
+    .next = g_reminder_db_bitmap_posting_next,
+    .seek = g_reminder_db_bitmap_posting_seek,
+    .free = g_reminder_db_bitmap_posting_free,
+    .describe = g_reminder_db_bitmap_posting_describe
+};
+
+GReminderDbPosting *
+g_reminder_db_posting_new_bitmap (GReminderDbBitmap *bitmap)
+{
+    GReminderDbBitmapPosting *self = g_new0 (GReminderDbBitmapPosting, 1);
+
+    self->parent.klass = &g_reminder_db_bitmap_posting_class;
+    self->parent.estimate = g_reminder_db_bitmap_get_cardinality (bitmap);
+    self->bitmap = bitmap;
+
+    g_reminder_db_bitmap_posting_seek (&self->parent, 0);
+
+    return &self->parent;
+}
+
+/*
+ * And postings: leapfrog join of their children. The children are sorted by
+ * estimate so that the rarest one drives, the others only ever seek forward
+ * to its ids.
+ */
+
+typedef struct
+{
+    GReminderDbPosting  parent;
+
+    GPtrArray          *children;
+} GReminderDbAndPosting;
+
+static gint
+g_reminder_db_posting_cmp_estimate (gconstpointer a,
+                                    gconstpointer b)
+{
+    const GReminderDbPosting *pa = *(const GReminderDbPosting * const *) a;
+    const GReminderDbPosting *pb = *(const GReminderDbPosting * const *) b;
+
+    return (pa->estimate > pb->estimate) - (pa->estimate < pb->estimate);
+}
+
+static void
+g_reminder_db_and_posting_align (GReminderDbAndPosting *self)
+{
+    GReminderDbPosting *lead = g_ptr_array_index (self->children, 0);
+    guint64 candidate = lead->id;
+    guint matched = 1;
+
+    if (lead->done)
+    {
+        self->parent.done = TRUE;
+        return;
+    }
+
+    for (guint i = 1; matched < self->children->len; i = (i + 1) % self->children->len)
+    {
+        GReminderDbPosting *child = g_ptr_array_index (self->children, i);
+
+        g_reminder_db_posting_seek (child, candidate);
+        if (child->done)
+        {
+            self->parent.done = TRUE;
+            return;
+        }
+
+        if (child->id == candidate)
+            ++matched;
+        else
+        {
+            candidate = child->id;
+            matched = 1;
+        }
+    }
+
+    self->parent.id = candidate;
+}
+
+static void
+g_reminder_db_and_posting_next (GReminderDbPosting *posting)
+{
+    GReminderDbAndPosting *self = (GReminderDbAndPosting *) posting;
+
+    g_reminder_db_posting_next (g_ptr_array_index (self->children, 0));
+    g_reminder_db_and_posting_align (self);
+}
+
+static void
+g_reminder_db_and_posting_seek (GReminderDbPosting *posting,
+                                guint64             target)
+{
+    GReminderDbAndPosting *self = (GReminderDbAndPosting *) posting;
+
+    g_reminder_db_posting_seek (g_ptr_array_index (self->children, 0), target);
+    g_reminder_db_and_posting_align (self);
+}
+
+static void
+g_reminder_db_and_posting_free (GReminderDbPosting *posting)
+{
+    GReminderDbAndPosting *self = (GReminderDbAndPosting *) posting;
+
+    g_ptr_array_unref (self->children);
+    g_free (self);
+}
+
+static void
+g_reminder_db_and_posting_describe (GReminderDbPosting *posting,
+                                    GString            *out,
+                                    guint               depth)
+{
+    g_reminder_db_posting_describe_line (posting, out, "and", NULL);
+    g_reminder_db_posting_describe_children (((GReminderDbAndPosting *) posting)->children, out, depth);
+}
+
+static const GReminderDbPostingClass g_reminder_db_and_posting_class = {
+    .next = g_reminder_db_and_posting_next,
+    .seek = g_reminder_db_and_posting_seek,
+    .free = g_reminder_db_and_posting_free,
+    .describe = g_reminder_db_and_posting_describe
+};
+
+GReminderDbPosting *
+g_reminder_db_posting_new_and (GPtrArray *postings)
+{
+    g_return_val_if_fail (postings && postings->len, NULL);
+
+    if (postings->len == 1)
+    {
+        GReminderDbPosting *posting = g_ptr_array_index (postings, 0);
+        g_ptr_array_set_free_func (postings, NULL);
+        g_ptr_array_unref (postings);
+        return posting;
+    }
+
+    GReminderDbAndPosting *self = g_new0 (GReminderDbAndPosting, 1);
+
+    g_ptr_array_sort (postings, g_reminder_db_posting_cmp_estimate);
+    self->parent.klass = &g_reminder_db_and_posting_class;
+    self->parent.estimate = ((GReminderDbPosting *) g_ptr_array_index (postings, 0))->estimate;
+    self->children = postings;
+
+    g_reminder_db_and_posting_align (self);
+
+    return &self->parent;
+}
+
+GReminderDbBitmap *
+g_reminder_db_posting_read_range (GReminderDbSnapshot *snapshot,
+                                  const gchar         *first,
+                                  const gchar         *last)
+{
+    G_REMINDER_CLEANUP_STRING_FREE GString *start = g_reminder_db_key_postings_prefix (first);
+    G_REMINDER_CLEANUP_STRING_FREE GString *end = g_reminder_db_key_postings_prefix (last);
+    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = leveldb_create_iterator (snapshot->db, snapshot->scan_roptions);
+    G_REMINDER_CLEANUP_ARRAY_UNREF GArray *block = g_array_new (FALSE, FALSE, sizeof (guint64));
+    GReminderDbBitmap *bitmap = g_reminder_db_bitmap_new ();
+
+    G_REMINDER_DB_SNAPSHOT_COUNT (snapshot, seeks, 1);
+
+    /* The separator sorts before any keyword byte, the blocks of the keywords in between are all there is */
+    for (leveldb_iter_seek (it, start->str, start->len); leveldb_iter_valid (it); leveldb_iter_next (it))
+    {
+        size_t klen, vlen;
+        const gchar *key = leveldb_iter_key (it, &klen);
+
+        if (!g_reminder_db_iter_has_prefix (it, end) && g_reminder_db_key_cmp (key, klen, end) > 0)
+            break;
+
+        const gchar *value = leveldb_iter_value (it, &vlen);
+
+        G_REMINDER_DB_SNAPSHOT_COUNT (snapshot, keys, 1);
+        G_REMINDER_DB_SNAPSHOT_COUNT (snapshot, blocks, 1);
+        g_array_set_size (block, 0);
+        /* Corrupted blocks are skipped as a whole, like term postings do */
+        if (!g_reminder_db_block_decode (value, vlen, block))
+            continue;
+        for (guint i = 0; i < block->len; ++i)
+            g_reminder_db_bitmap_add (bitmap, g_array_index (block, guint64, i));
+    }
+
+    return bitmap;
+}
+
+/*
+ * Or postings: merge of their children, each id is only reported once. The
+ * children still going are kept in a min-heap by id, so that moving one
+ * costs a logarithm of their number however broad the union is.
+ */
+
+typedef struct
+{
+    GReminderDbPosting   parent;
+
+    GPtrArray           *children;
+    GReminderDbPosting **heap;
+    guint                alive;
+} GReminderDbOrPosting;
+
+/* Move the child at i down to its place, dropping it if done */
+static void
+g_reminder_db_or_posting_sift (GReminderDbOrPosting *self,
+                               guint                 i)
+{
+    GReminderDbPosting **heap = self->heap;
+
+    if (heap[i]->done)
+        heap[i] = heap[--self->alive];
+
+    for (;;)
+    {
+        guint min = i, l = 2 * i + 1, r = l + 1;
+
+        if (l < self->alive && heap[l]->id < heap[min]->id)
+            min = l;
+        if (r < self->alive && heap[r]->id < heap[min]->id)
+            min = r;
+        if (min == i)
+            break;
+
+        GReminderDbPosting *child = heap[i];
+        heap[i] = heap[min];
+        heap[min] = child;
+        i = min;
+    }
+}
+
+static void
+g_reminder_db_or_posting_read (GReminderDbOrPosting *self)
+{
+    self->parent.done = !self->alive;
+    if (self->alive)
+        self->parent.id = self->heap[0]->id;
+}
+
+static void
+g_reminder_db_or_posting_next (GReminderDbPosting *posting)
+{
+    GReminderDbOrPosting *self = (GReminderDbOrPosting *) posting;
+
+    while (self->alive && self->heap[0]->id == posting->id)
+    {
+        g_reminder_db_posting_next (self->heap[0]);
+        g_reminder_db_or_posting_sift (self, 0);
+    }
+
+    g_reminder_db_or_posting_read (self);
+}
+
+static void
+g_reminder_db_or_posting_seek (GReminderDbPosting *posting,
+                               guint64             target)
+{
+    GReminderDbOrPosting *self = (GReminderDbOrPosting *) posting;
+
+    /* Children already past target stay where they are */
+    while (self->alive && self->heap[0]->id < target)
+    {
+        g_reminder_db_posting_seek (self->heap[0], target);
+        g_reminder_db_or_posting_sift (self, 0);
+    }
+
+    g_reminder_db_or_posting_read (self);
+}
+
+static void
+g_reminder_db_or_posting_free (GReminderDbPosting *posting)
+{
+    GReminderDbOrPosting *self = (GReminderDbOrPosting *) posting;
+
+    g_ptr_array_unref (self->children);
+    g_free (self->heap);
+    g_free (self);
+}
+
+static void
+g_reminder_db_or_posting_describe (GReminderDbPosting *posting,
+                                   GString            *out,
+                                   guint               depth)
+{
+    g_reminder_db_posting_describe_line (posting, out, "or", NULL);
+    g_reminder_db_posting_describe_children (((GReminderDbOrPosting *) posting)->children, out, depth);
+}
+
+static const GReminderDbPostingClass g_reminder_db_or_posting_class = {
+    .next = g_reminder_db_or_posting_next,
+    .seek = g_reminder_db_or_posting_seek,
+    .free = g_reminder_db_or_posting_free,
+    .describe = g_reminder_db_or_posting_describe
+};
+
+GReminderDbPosting *
+g_reminder_db_posting_new_or (GPtrArray *postings)
+{
+    g_return_val_if_fail (postings && postings->len, NULL);
+
+    if (postings->len == 1)
+    {
+        GReminderDbPosting *posting = g_ptr_array_index (postings, 0);
+        g_ptr_array_set_free_func (postings, NULL);
+        g_ptr_array_unref (postings);
+        return posting;
+    }
+
+    GReminderDbOrPosting *self = g_new0 (GReminderDbOrPosting, 1);
+
+    self->parent.klass = &g_reminder_db_or_posting_class;
+    self->children = postings;
+    self->heap = g_new (GReminderDbPosting *, postings->len);
+    for (guint i = 0; i < postings->len; ++i)
+    {
+        GReminderDbPosting *child = g_ptr_array_index (postings, i);
+
+        self->parent.estimate += child->estimate;
+        if (!child->done)
+            self->heap[self->alive++] = child;
+    }
+    for (guint i = self->alive / 2; i-- > 0;)
+        g_reminder_db_or_posting_sift (self, i);
+
+    g_reminder_db_or_posting_read (self);
+
+    return &self->parent;
+}
+
+/*
+ * Andnot postings: the ids of a posting missing from another one. The
+ * excluded one is only ever sought to the ids that would be reported, it
+ * costs no more than a filter of the results.
+ */
+
+typedef struct
+{
+    GReminderDbPosting  parent;
+
+    GReminderDbPosting *include;
+    GReminderDbPosting *exclude;
+} GReminderDbAndnotPosting;
+
+static void
+g_reminder_db_andnot_posting_align (GReminderDbAndnotPosting *self)
+{
+    for (; !self->include->done; g_reminder_db_posting_next (self->include))
+    {
+        g_reminder_db_posting_seek (self->exclude, self->include->id);
+        if (self->exclude->done || self->exclude->id != self->include->id)
+        {
+            self->parent.id = self->include->id;
+            return;
+        }
+    }
+
+    self->parent.done = TRUE;
+}
+
+static void
+g_reminder_db_andnot_posting_next (GReminderDbPosting *posting)
+{
+    GReminderDbAndnotPosting *self = (GReminderDbAndnotPosting *) posting;
+
+    g_reminder_db_posting_next (self->include);
+    g_reminder_db_andnot_posting_align (self);
+}
+
+static void
+g_reminder_db_andnot_posting_seek (GReminderDbPosting *posting,
+                                   guint64             target)
+{
+    GReminderDbAndnotPosting *self = (GReminderDbAndnotPosting *) posting;
+
+    g_reminder_db_posting_seek (self->include, target);
+    g_reminder_db_andnot_posting_align (self);
+}
+
+static void
+g_reminder_db_andnot_posting_free (GReminderDbPosting *posting)
+{
+    GReminderDbAndnotPosting *self = (GReminderDbAndnotPosting *) posting;
+
+    g_reminder_db_posting_free (self->include);
+    g_reminder_db_posting_free (self->exclude);
+    g_free (self);
+}
+
+static void
+g_reminder_db_andnot_posting_describe (GReminderDbPosting *posting,
+                                       GString            *out,
+                                       guint               depth)
+{
+    GReminderDbAndnotPosting *self = (GReminderDbAndnotPosting *) posting;
+
+    g_reminder_db_posting_describe_line (posting, out, "andnot", NULL);
+    g_reminder_db_posting_describe (self->include, out, depth + 1);
+    g_reminder_db_posting_describe (self->exclude, out, depth + 1);
+}
+
+static const GReminderDbPostingClass g_reminder_db_andnot_posting_class = {
+    .next = g_reminder_db_andnot_posting_next,
+    .seek = g_reminder_db_andnot_posting_seek,
+    .free = g_reminder_db_andnot_posting_free,
+    .describe = g_reminder_db_andnot_posting_describe
+};
+
+GReminderDbPosting *
+g_reminder_db_posting_new_andnot (GReminderDbPosting *include,
+                                  GReminderDbPosting *exclude)
+{
+    g_return_val_if_fail (include && exclude, NULL);
+
+    GReminderDbAndnotPosting *self = g_new0 (GReminderDbAndnotPosting, 1);
+
+    self->parent.klass = &g_reminder_db_andnot_posting_class;
+    self->parent.estimate = include->estimate;
+    self->include = include;
+    self->exclude = exclude;
+
+    g_reminder_db_andnot_posting_align (self);
+
+    return &self->parent;
+}
@@ -0,0 +1,118 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_POSTING_H__
+#define __G_REMINDER_DB_POSTING_H__
+
+#include "greminder-db-bitmap.h"
+#include "greminder-db-snapshot.h"
+
+G_BEGIN_DECLS
+
+/*
+ * A posting is a stream of item ids in increasing order. Postings are
+ * positioned on their first id as soon as they are created and expose it
+ * in id until done is set.
+ */
+typedef struct _GReminderDbPosting      GReminderDbPosting;
+typedef struct _GReminderDbPostingClass GReminderDbPostingClass;
+
+struct _GReminderDbPostingClass
+{
+    void (*next) (GReminderDbPosting *self);
+    /* Move to the first id greater than or equal to target */
+    void (*seek) (GReminderDbPosting *self,
+                  guint64             target);
+    void (*free) (GReminderDbPosting *self);
+    /* Append a line about the posting, then its children one level deeper */
+    void (*describe) (GReminderDbPosting *self,
+                      GString            *out,
+                      guint               depth);
+};
+
+struct _GReminderDbPosting
+{
+    const GReminderDbPostingClass *klass;
+
+    guint64                        id;
+    gboolean                       done;
+    /* Upper bound of the number of ids, used to plan evaluation order */
+    guint64                        estimate;
+    /* Nexts and seeks so far, what the posting actually cost */
+    guint64                        steps;
+};
+
+#define G_REMINDER_CLEANUP_POSTING_FREE G_REMINDER_CLEANUP (g_reminder_db_posting_free_ptr)
+
+void g_reminder_db_posting_next (GReminderDbPosting *self);
+void g_reminder_db_posting_seek (GReminderDbPosting *self,
+                                 guint64             target);
+void g_reminder_db_posting_free (GReminderDbPosting *self);
+
+/* The tree of postings as it is evaluated, one indented line per posting */
+void g_reminder_db_posting_describe (GReminderDbPosting *self,
+                                     GString            *out,
+                                     guint               depth);
+
+static inline void
+g_reminder_db_posting_free_ptr (GReminderDbPosting **self)
+{
+    if (*self)
+        g_reminder_db_posting_free (*self);
+}
+
+GReminderDbPosting *g_reminder_db_posting_new_term (GReminderDbSnapshot *snapshot,
+                                                    const gchar         *keyword,
+                                                    guint64              count);
+/* Schema 2 postings of keyword, only around while they get repacked */
+GReminderDbPosting *g_reminder_db_posting_new_forward (GReminderDbSnapshot *snapshot,
+                                                       const gchar         *keyword,
+                                                       guint64              count);
+
+GThreadPool *g_reminder_db_posting_pool_new (gint max_threads);
+
+GReminderDbPosting *g_reminder_db_posting_new_scan (GThreadPool         *pool,
+                                                    GReminderDbSnapshot *snapshot,
+                                                    const gchar         *keyword,
+                                                    guint64              count);
+
+/*
+ * Union of the postings of every keyword from first to last, in dictionary
+ * order. Their blocks are stored next to each other and get read in a
+ * single pass, which beats merging many postings one id at a time.
+ */
+GReminderDbBitmap *g_reminder_db_posting_read_range (GReminderDbSnapshot *snapshot,
+                                                     const gchar         *first,
+                                                     const gchar         *last);
+
+/* Takes ownership of the bitmap */
+GReminderDbPosting *g_reminder_db_posting_new_bitmap (GReminderDbBitmap *bitmap);
+
+/* Take ownership of the postings */
+GReminderDbPosting *g_reminder_db_posting_new_and (GPtrArray *postings);
+GReminderDbPosting *g_reminder_db_posting_new_or  (GPtrArray *postings);
+/* Takes ownership of both postings */
+GReminderDbPosting *g_reminder_db_posting_new_andnot (GReminderDbPosting *include,
+                                                      GReminderDbPosting *exclude);
+
+GArray *g_reminder_db_posting_collect (GReminderDbPosting *self);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_POSTING_H__*/
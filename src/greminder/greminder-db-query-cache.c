@@ -0,0 +1,237 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-query-cache.h"
+
+#include <string.h>
+
+typedef struct
+{
+    gchar   *key;
+    gchar  **keywords;
+    guint64  stamp;
+    GArray  *ids;
+    gsize    size;
+    GList   *link;
+} GReminderDbQueryCacheEntry;
+
+struct _GReminderDbQueryCache
+{
+    GMutex      lock;
+
+    gsize       budget;
+    gsize       size;
+    /* Key to entry, and the entries from most to least recently used */
+    GHashTable *entries;
+    GQueue      lru;
+
+    guint64     clock;
+    /* Keyword to the clock value of the last write touching it */
+    GHashTable *generations;
+
+    guint64     hits;
+    guint64     misses;
+};
+
+static void
+g_reminder_db_query_cache_entry_free (gpointer data)
+{
+    GReminderDbQueryCacheEntry *entry = data;
+
+    g_free (entry->key);
+    g_strfreev (entry->keywords);
+    g_array_unref (entry->ids);
+    g_free (entry);
+}
+
+static void
+g_reminder_db_query_cache_remove (GReminderDbQueryCache      *self,
+                                  GReminderDbQueryCacheEntry *entry)
+{
+    self->size -= entry->size;
+    g_queue_delete_link (&self->lru, entry->link);
+    g_hash_table_remove (self->entries, entry->key);
+}
+
+GReminderDbQueryCache *
+g_reminder_db_query_cache_new (gsize budget)
+{
+    GReminderDbQueryCache *self = g_new0 (GReminderDbQueryCache, 1);
+
+    g_mutex_init (&self->lock);
+    self->budget = budget;
+    self->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_reminder_db_query_cache_entry_free);
+    g_queue_init (&self->lru);
+    self->generations = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+    return self;
+}
+
+void
+g_reminder_db_query_cache_free (GReminderDbQueryCache *self)
+{
+    g_queue_clear (&self->lru);
+    g_hash_table_unref (self->entries);
+    g_hash_table_unref (self->generations);
+    g_mutex_clear (&self->lock);
+    g_free (self);
+}
+
+guint64
+g_reminder_db_query_cache_stamp (GReminderDbQueryCache *self)
+{
+    g_mutex_lock (&self->lock);
+    guint64 stamp = self->clock;
+    g_mutex_unlock (&self->lock);
+
+    return stamp;
+}
+
+static gboolean
+g_reminder_db_query_cache_is_valid (GReminderDbQueryCache      *self,
+                                    GReminderDbQueryCacheEntry *entry)
+{
+    for (gchar **k = entry->keywords; *k; ++k)
+    {
+        gpointer generation;
+        if (g_hash_table_lookup_extended (self->generations, *k, NULL, &generation) && *(guint64 *) generation > entry->stamp)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+GArray *
+g_reminder_db_query_cache_lookup (GReminderDbQueryCache *self,
+                                  const gchar           *key)
+{
+    GArray *ids = NULL;
+
+    g_mutex_lock (&self->lock);
+
+    GReminderDbQueryCacheEntry *entry = g_hash_table_lookup (self->entries, key);
+    if (entry && !g_reminder_db_query_cache_is_valid (self, entry))
+    {
+        g_reminder_db_query_cache_remove (self, entry);
+        entry = NULL;
+    }
+
+    if (entry)
+    {
+        ++self->hits;
+        g_queue_unlink (&self->lru, entry->link);
+        g_queue_push_head_link (&self->lru, entry->link);
+        ids = g_array_sized_new (FALSE, FALSE, sizeof (guint64), entry->ids->len);
+        g_array_append_vals (ids, entry->ids->data, entry->ids->len);
+    }
+    else
+        ++self->misses;
+
+    g_mutex_unlock (&self->lock);
+
+    return ids;
+}
+
+gboolean
+g_reminder_db_query_cache_contains (GReminderDbQueryCache *self,
+                                    const gchar           *key)
+{
+    g_mutex_lock (&self->lock);
+
+    GReminderDbQueryCacheEntry *entry = g_hash_table_lookup (self->entries, key);
+    gboolean valid = entry && g_reminder_db_query_cache_is_valid (self, entry);
+
+    g_mutex_unlock (&self->lock);
+
+    return valid;
+}
+
+void
+g_reminder_db_query_cache_insert (GReminderDbQueryCache *self,
+                                  const gchar           *key,
+                                  gchar                **keywords,
+                                  guint64                stamp,
+                                  const GArray          *ids)
+{
+    GReminderDbQueryCacheEntry *entry = g_new (GReminderDbQueryCacheEntry, 1);
+    gsize keywords_size = 0;
+
+    for (gchar **k = keywords; *k; ++k)
+        keywords_size += sizeof (gchar *) + strlen (*k) + 1;
+
+    entry->key = g_strdup (key);
+    entry->keywords = g_strdupv (keywords);
+    entry->stamp = stamp;
+    entry->ids = g_array_sized_new (FALSE, FALSE, sizeof (guint64), ids->len);
+    g_array_append_vals (entry->ids, ids->data, ids->len);
+    entry->size = sizeof (GReminderDbQueryCacheEntry) + strlen (entry->key) + keywords_size + ids->len * sizeof (guint64);
+
+    g_mutex_lock (&self->lock);
+
+    /* Something this query depends on changed while it ran */
+    if (entry->size > self->budget || !g_reminder_db_query_cache_is_valid (self, entry))
+    {
+        g_mutex_unlock (&self->lock);
+        g_reminder_db_query_cache_entry_free (entry);
+        return;
+    }
+
+    GReminderDbQueryCacheEntry *old = g_hash_table_lookup (self->entries, entry->key);
+    if (old)
+        g_reminder_db_query_cache_remove (self, old);
+
+    while (self->size + entry->size > self->budget)
+        g_reminder_db_query_cache_remove (self, g_queue_peek_tail (&self->lru));
+
+    g_queue_push_head (&self->lru, entry);
+    entry->link = g_queue_peek_head_link (&self->lru);
+    g_hash_table_insert (self->entries, entry->key, entry);
+    self->size += entry->size;
+
+    g_mutex_unlock (&self->lock);
+}
+
+void
+g_reminder_db_query_cache_invalidate (GReminderDbQueryCache *self,
+                                      const gchar           *keyword)
+{
+    g_mutex_lock (&self->lock);
+
+    guint64 *generation = g_hash_table_lookup (self->generations, keyword);
+    if (!generation)
+    {
+        generation = g_new (guint64, 1);
+        g_hash_table_insert (self->generations, g_strdup (keyword), generation);
+    }
+    *generation = ++self->clock;
+
+    g_mutex_unlock (&self->lock);
+}
+
+void
+g_reminder_db_query_cache_get_stats (GReminderDbQueryCache *self,
+                                     guint64               *hits,
+                                     guint64               *misses)
+{
+    g_mutex_lock (&self->lock);
+    if (hits)
+        *hits = self->hits;
+    if (misses)
+        *misses = self->misses;
+    g_mutex_unlock (&self->lock);
+}
@@ -0,0 +1,68 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_QUERY_CACHE_H__
+#define __G_REMINDER_DB_QUERY_CACHE_H__
+
+#include "greminder-macros.h"
+
+G_BEGIN_DECLS
+
+/*
+ * LRU cache of the ids matching a query, within a memory budget.
+ *
+ * Every write bumps the generation of the keywords it indexes or unindexes.
+ * An entry only stays valid while none of its keywords got a generation
+ * newer than the stamp taken before the query started reading, so entries
+ * are invalidated by exactly the writes that can change their results.
+ */
+typedef struct _GReminderDbQueryCache GReminderDbQueryCache;
+
+GReminderDbQueryCache *g_reminder_db_query_cache_new  (gsize                  budget);
+void                   g_reminder_db_query_cache_free (GReminderDbQueryCache *self);
+
+/* Take before reading anything the result will be computed from */
+guint64 g_reminder_db_query_cache_stamp (GReminderDbQueryCache *self);
+
+/*
+ * Queries are keyed by their canonical form, see g_reminder_db_query_to_string.
+ * Returns a copy of the cached ids, or NULL on a miss.
+ */
+GArray *g_reminder_db_query_cache_lookup (GReminderDbQueryCache *self,
+                                          const gchar           *key);
+/* Like lookup, without counting or touching the entry */
+gboolean g_reminder_db_query_cache_contains (GReminderDbQueryCache *self,
+                                             const gchar           *key);
+/* The entry depends on keywords, every keyword the query reads */
+void    g_reminder_db_query_cache_insert (GReminderDbQueryCache *self,
+                                          const gchar           *key,
+                                          gchar                **keywords,
+                                          guint64                stamp,
+                                          const GArray          *ids);
+
+void g_reminder_db_query_cache_invalidate (GReminderDbQueryCache *self,
+                                           const gchar           *keyword);
+
+void g_reminder_db_query_cache_get_stats (GReminderDbQueryCache *self,
+                                          guint64               *hits,
+                                          guint64               *misses);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_QUERY_CACHE_H__*/
@@ -0,0 +1,579 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-query.h"
+
+#include "greminder-db-text.h"
+
+#include <gio/gio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Nesting allowed in parentheses and negations, the parser is recursive */
+#define G_REMINDER_DB_QUERY_MAX_DEPTH 32
+
+typedef enum
+{
+    G_REMINDER_DB_QUERY_TOKEN_END,
+    G_REMINDER_DB_QUERY_TOKEN_WORD,
+    G_REMINDER_DB_QUERY_TOKEN_PREFIX,
+    G_REMINDER_DB_QUERY_TOKEN_AND,
+    G_REMINDER_DB_QUERY_TOKEN_OR,
+    G_REMINDER_DB_QUERY_TOKEN_NOT,
+    G_REMINDER_DB_QUERY_TOKEN_OPEN,
+    G_REMINDER_DB_QUERY_TOKEN_CLOSE
+} GReminderDbQueryToken;
+
+typedef struct
+{
+    const gchar           *text;
+    const gchar           *pos;
+
+    /* Current token, where it starts and the keyword it holds, if any */
+    GReminderDbQueryToken  token;
+    glong                  offset;
+    gchar                 *word;
+    /* Whether the keyword was scoped to the contents with text: */
+    gboolean               contents;
+
+    guint                  depth;
+} GReminderDbQueryParser;
+
+static GReminderDbQuery *
+g_reminder_db_query_new (GReminderDbQueryKind  kind,
+                         gchar                *term)
+{
+    GReminderDbQuery *self = g_new (GReminderDbQuery, 1);
+
+    self->kind = kind;
+    self->term = term;
+    self->children = (term) ? NULL : g_ptr_array_new_with_free_func ((GDestroyNotify) g_reminder_db_query_free);
+
+    return self;
+}
+
+void
+g_reminder_db_query_free (GReminderDbQuery *self)
+{
+    g_free (self->term);
+    if (self->children)
+        g_ptr_array_unref (self->children);
+    g_free (self);
+}
+
+static gboolean
+g_reminder_db_query_fail (GReminderDbQueryParser  *parser,
+                          GError                 **error,
+                          const gchar             *reason)
+{
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, "%s at offset %ld of '%s'", reason, parser->offset, parser->text);
+    return FALSE;
+}
+
+static gboolean
+g_reminder_db_query_is_special (gchar c)
+{
+    return g_ascii_isspace (c) || c == '(' || c == ')' || c == '"';
+}
+
+static gboolean
+g_reminder_db_query_lex (GReminderDbQueryParser  *parser,
+                         GError                 **error)
+{
+    g_clear_pointer (&parser->word, g_free);
+
+    while (g_ascii_isspace (*parser->pos))
+        ++parser->pos;
+    parser->offset = parser->pos - parser->text;
+
+    parser->contents = !strncmp (parser->pos, "text:", 5) && parser->pos[5] && !g_ascii_isspace (parser->pos[5]) && parser->pos[5] != '(' && parser->pos[5] != ')';
+    if (parser->contents)
+        parser->pos += 5;
+
+    switch (*parser->pos)
+    {
+    case '\0':
+        parser->token = G_REMINDER_DB_QUERY_TOKEN_END;
+        return TRUE;
+    case '(':
+        ++parser->pos;
+        parser->token = G_REMINDER_DB_QUERY_TOKEN_OPEN;
+        return TRUE;
+    case ')':
+        ++parser->pos;
+        parser->token = G_REMINDER_DB_QUERY_TOKEN_CLOSE;
+        return TRUE;
+    case '"':
+    {
+        GString *word = g_string_new (NULL);
+
+        for (++parser->pos; *parser->pos && *parser->pos != '"'; ++parser->pos)
+        {
+            if (*parser->pos == '\\' && parser->pos[1])
+                ++parser->pos;
+            g_string_append_c (word, *parser->pos);
+        }
+        if (!*parser->pos || !word->len)
+        {
+            g_string_free (word, TRUE);
+            return g_reminder_db_query_fail (parser, error, (*parser->pos) ? "Empty keyword" : "Unterminated quote");
+        }
+
+        ++parser->pos;
+        parser->token = G_REMINDER_DB_QUERY_TOKEN_WORD;
+        if (*parser->pos == '*')
+        {
+            ++parser->pos;
+            parser->token = G_REMINDER_DB_QUERY_TOKEN_PREFIX;
+        }
+        parser->word = g_string_free (word, FALSE);
+        return TRUE;
+    }
+    default:
+        break;
+    }
+
+    const gchar *start = parser->pos;
+    while (*parser->pos && !g_reminder_db_query_is_special (*parser->pos))
+        ++parser->pos;
+
+    gsize len = parser->pos - start;
+    if (!parser->contents && len == 3 && !strncmp (start, "AND", len))
+        parser->token = G_REMINDER_DB_QUERY_TOKEN_AND;
+    else if (!parser->contents && len == 2 && !strncmp (start, "OR", len))
+        parser->token = G_REMINDER_DB_QUERY_TOKEN_OR;
+    else if (!parser->contents && len == 3 && !strncmp (start, "NOT", len))
+        parser->token = G_REMINDER_DB_QUERY_TOKEN_NOT;
+    else if (start[len - 1] == '*')
+    {
+        if (len == 1)
+            return g_reminder_db_query_fail (parser, error, "A lone * would match every keyword");
+        parser->token = G_REMINDER_DB_QUERY_TOKEN_PREFIX;
+        parser->word = g_strndup (start, len - 1);
+    }
+    else
+    {
+        parser->token = G_REMINDER_DB_QUERY_TOKEN_WORD;
+        parser->word = g_strndup (start, len);
+    }
+
+    return TRUE;
+}
+
+/* Operands of nested operators of the same kind are merged into a single one */
+static GReminderDbQuery *
+g_reminder_db_query_combine (GReminderDbQueryKind  kind,
+                             GReminderDbQuery     *left,
+                             GReminderDbQuery     *right)
+{
+    GReminderDbQuery *self = left;
+
+    if (left->kind != kind)
+    {
+        self = g_reminder_db_query_new (kind, NULL);
+        g_ptr_array_add (self->children, left);
+    }
+
+    if (right->kind != kind)
+    {
+        g_ptr_array_add (self->children, right);
+        return self;
+    }
+
+    for (guint i = 0; i < right->children->len; ++i)
+        g_ptr_array_add (self->children, g_ptr_array_index (right->children, i));
+    g_ptr_array_set_free_func (right->children, NULL);
+    g_reminder_db_query_free (right);
+
+    return self;
+}
+
+/* Words scoped to the contents stand for all of their terms, prefixes for a single one */
+static GReminderDbQuery *
+g_reminder_db_query_new_text (GReminderDbQueryParser  *parser,
+                              GError                 **error)
+{
+    G_REMINDER_CLEANUP_STRFREEV gchar **terms = g_reminder_db_text_get_terms (parser->word);
+    guint n = g_strv_length (terms);
+
+    if (!n)
+    {
+        g_reminder_db_query_fail (parser, error, "No word to look for");
+        return NULL;
+    }
+
+    if (parser->token == G_REMINDER_DB_QUERY_TOKEN_PREFIX)
+    {
+        if (n > 1)
+        {
+            g_reminder_db_query_fail (parser, error, "A prefix of the contents can only be one word");
+            return NULL;
+        }
+        return g_reminder_db_query_new (G_REMINDER_DB_QUERY_PREFIX, g_strdup (terms[0]));
+    }
+
+    if (n == 1)
+        return g_reminder_db_query_new (G_REMINDER_DB_QUERY_TERM, g_strdup (terms[0]));
+
+    GReminderDbQuery *self = g_reminder_db_query_new (G_REMINDER_DB_QUERY_AND, NULL);
+    for (guint i = 0; i < n; ++i)
+        g_ptr_array_add (self->children, g_reminder_db_query_new (G_REMINDER_DB_QUERY_TERM, g_strdup (terms[i])));
+
+    return self;
+}
+
+static GReminderDbQuery *g_reminder_db_query_parse_or (GReminderDbQueryParser  *parser,
+                                                       GError                 **error);
+
+static GReminderDbQuery *
+g_reminder_db_query_parse_primary (GReminderDbQueryParser  *parser,
+                                   GError                 **error)
+{
+    GReminderDbQuery *self = NULL;
+
+    switch (parser->token)
+    {
+    case G_REMINDER_DB_QUERY_TOKEN_WORD:
+    case G_REMINDER_DB_QUERY_TOKEN_PREFIX:
+        if (parser->contents)
+        {
+            if (!(self = g_reminder_db_query_new_text (parser, error)))
+                return NULL;
+            break;
+        }
+        /* Keywords are indexed folded, see greminder-db-keys.h, prefixes may then miss some, see greminder-db-query.h */
+        self = g_reminder_db_query_new ((parser->token == G_REMINDER_DB_QUERY_TOKEN_WORD) ? G_REMINDER_DB_QUERY_TERM : G_REMINDER_DB_QUERY_PREFIX, g_reminder_db_text_fold (parser->word));
+        break;
+    case G_REMINDER_DB_QUERY_TOKEN_OPEN:
+        if (!g_reminder_db_query_lex (parser, error) || !(self = g_reminder_db_query_parse_or (parser, error)))
+            return NULL;
+        if (parser->token != G_REMINDER_DB_QUERY_TOKEN_CLOSE)
+        {
+            g_reminder_db_query_free (self);
+            g_reminder_db_query_fail (parser, error, "Missing )");
+            return NULL;
+        }
+        break;
+    case G_REMINDER_DB_QUERY_TOKEN_CLOSE:
+        g_reminder_db_query_fail (parser, error, "Unexpected )");
+        return NULL;
+    default:
+        g_reminder_db_query_fail (parser, error, "Missing keyword");
+        return NULL;
+    }
+
+    if (!g_reminder_db_query_lex (parser, error))
+    {
+        g_reminder_db_query_free (self);
+        return NULL;
+    }
+
+    return self;
+}
+
+static GReminderDbQuery *
+g_reminder_db_query_parse_unary (GReminderDbQueryParser  *parser,
+                                 GError                 **error)
+{
+    GReminderDbQuery *self;
+
+    if (++parser->depth > G_REMINDER_DB_QUERY_MAX_DEPTH)
+    {
+        g_reminder_db_query_fail (parser, error, "Too much nesting");
+        return NULL;
+    }
+
+    if (parser->token != G_REMINDER_DB_QUERY_TOKEN_NOT)
+        self = g_reminder_db_query_parse_primary (parser, error);
+    else if (!g_reminder_db_query_lex (parser, error) || !(self = g_reminder_db_query_parse_unary (parser, error)))
+        self = NULL;
+    else if (self->kind == G_REMINDER_DB_QUERY_NOT)
+    {
+        /* Double negations cancel out */
+        GReminderDbQuery *child = g_ptr_array_index (self->children, 0);
+        g_ptr_array_set_free_func (self->children, NULL);
+        g_reminder_db_query_free (self);
+        self = child;
+    }
+    else
+    {
+        GReminderDbQuery *not = g_reminder_db_query_new (G_REMINDER_DB_QUERY_NOT, NULL);
+        g_ptr_array_add (not->children, self);
+        self = not;
+    }
+
+    --parser->depth;
+    return self;
+}
+
+static GReminderDbQuery *
+g_reminder_db_query_parse_and (GReminderDbQueryParser  *parser,
+                               GError                 **error)
+{
+    GReminderDbQuery *self = g_reminder_db_query_parse_unary (parser, error);
+
+    while (self && parser->token != G_REMINDER_DB_QUERY_TOKEN_END && parser->token != G_REMINDER_DB_QUERY_TOKEN_OR && parser->token != G_REMINDER_DB_QUERY_TOKEN_CLOSE)
+    {
+        GReminderDbQuery *right;
+
+        if ((parser->token == G_REMINDER_DB_QUERY_TOKEN_AND && !g_reminder_db_query_lex (parser, error)) || !(right = g_reminder_db_query_parse_unary (parser, error)))
+        {
+            g_reminder_db_query_free (self);
+            return NULL;
+        }
+        self = g_reminder_db_query_combine (G_REMINDER_DB_QUERY_AND, self, right);
+    }
+
+    return self;
+}
+
+static GReminderDbQuery *
+g_reminder_db_query_parse_or (GReminderDbQueryParser  *parser,
+                              GError                 **error)
+{
+    GReminderDbQuery *self = g_reminder_db_query_parse_and (parser, error);
+
+    while (self && parser->token == G_REMINDER_DB_QUERY_TOKEN_OR)
+    {
+        GReminderDbQuery *right;
+
+        if (!g_reminder_db_query_lex (parser, error) || !(right = g_reminder_db_query_parse_and (parser, error)))
+        {
+            g_reminder_db_query_free (self);
+            return NULL;
+        }
+        self = g_reminder_db_query_combine (G_REMINDER_DB_QUERY_OR, self, right);
+    }
+
+    return self;
+}
+
+/*
+ * Whether the index alone can answer a query: ANDs need a positive operand
+ * to filter the negated ones with, ORs and negations need positive operands
+ * all the way down.
+ */
+static gboolean
+g_reminder_db_query_is_bounded (const GReminderDbQuery *self)
+{
+    gboolean positive = FALSE;
+
+    switch (self->kind)
+    {
+    case G_REMINDER_DB_QUERY_TERM:
+    case G_REMINDER_DB_QUERY_PREFIX:
+        return TRUE;
+    case G_REMINDER_DB_QUERY_NOT:
+        return FALSE;
+    case G_REMINDER_DB_QUERY_OR:
+        for (guint i = 0; i < self->children->len; ++i)
+        {
+            if (!g_reminder_db_query_is_bounded (g_ptr_array_index (self->children, i)))
+                return FALSE;
+        }
+        return TRUE;
+    case G_REMINDER_DB_QUERY_AND:
+        for (guint i = 0; i < self->children->len; ++i)
+        {
+            const GReminderDbQuery *child = g_ptr_array_index (self->children, i);
+
+            if (child->kind == G_REMINDER_DB_QUERY_NOT)
+                child = g_ptr_array_index (child->children, 0);
+            else
+                positive = TRUE;
+            if (!g_reminder_db_query_is_bounded (child))
+                return FALSE;
+        }
+        return positive;
+    }
+
+    return FALSE;
+}
+
+GReminderDbQuery *
+g_reminder_db_query_parse (const gchar  *text,
+                           GError      **error)
+{
+    GReminderDbQueryParser parser = { text, text, G_REMINDER_DB_QUERY_TOKEN_END, 0, NULL, FALSE, 0 };
+    GReminderDbQuery *self = NULL;
+
+    g_return_val_if_fail (text, NULL);
+
+    if (!g_reminder_db_query_lex (&parser, error))
+        return NULL;
+
+    if (parser.token == G_REMINDER_DB_QUERY_TOKEN_END)
+        g_reminder_db_query_fail (&parser, error, "Empty query");
+    else if ((self = g_reminder_db_query_parse_or (&parser, error)) && parser.token != G_REMINDER_DB_QUERY_TOKEN_END)
+    {
+        g_reminder_db_query_fail (&parser, error, "Unexpected )");
+        g_clear_pointer (&self, g_reminder_db_query_free);
+    }
+    else if (self && !g_reminder_db_query_is_bounded (self))
+    {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, "Negations need other keywords to filter in '%s'", text);
+        g_clear_pointer (&self, g_reminder_db_query_free);
+    }
+
+    g_free (parser.word);
+    return self;
+}
+
+static gint
+g_reminder_db_query_cmp (const void *a,
+                         const void *b)
+{
+    return strcmp (*(const gchar * const *) a, *(const gchar * const *) b);
+}
+
+/* Sort and deduplicate a NULL terminated array of strings, in place */
+static void
+g_reminder_db_query_sort (gchar **strings,
+                          guint   n)
+{
+    guint len = 0;
+
+    qsort (strings, n, sizeof (gchar *), g_reminder_db_query_cmp);
+    for (guint i = 0; i < n; ++i)
+    {
+        if (len && !strcmp (strings[len - 1], strings[i]))
+            g_free (strings[i]);
+        else
+            strings[len++] = strings[i];
+    }
+    strings[len] = NULL;
+}
+
+static void
+g_reminder_db_query_append_term (GString     *out,
+                                 const gchar *term)
+{
+    g_string_append_c (out, '"');
+    for (const gchar *c = term; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            g_string_append_c (out, '\\');
+        g_string_append_c (out, *c);
+    }
+    g_string_append_c (out, '"');
+}
+
+gchar *
+g_reminder_db_query_to_string (const GReminderDbQuery *self)
+{
+    GString *out = g_string_new (NULL);
+
+    switch (self->kind)
+    {
+    case G_REMINDER_DB_QUERY_TERM:
+    case G_REMINDER_DB_QUERY_PREFIX:
+        if (g_reminder_db_text_is_term (self->term))
+        {
+            g_string_append (out, "text:");
+            g_reminder_db_query_append_term (out, self->term + 1);
+        }
+        else
+            g_reminder_db_query_append_term (out, self->term);
+        if (self->kind == G_REMINDER_DB_QUERY_PREFIX)
+            g_string_append_c (out, '*');
+        break;
+    case G_REMINDER_DB_QUERY_NOT:
+    {
+        G_REMINDER_CLEANUP_FREE gchar *child = g_reminder_db_query_to_string (g_ptr_array_index (self->children, 0));
+        g_string_append_printf (out, "NOT %s", child);
+        break;
+    }
+    case G_REMINDER_DB_QUERY_AND:
+    case G_REMINDER_DB_QUERY_OR:
+    {
+        guint n = self->children->len;
+        G_REMINDER_CLEANUP_STRFREEV gchar **children = g_new0 (gchar *, n + 1);
+
+        for (guint i = 0; i < n; ++i)
+            children[i] = g_reminder_db_query_to_string (g_ptr_array_index (self->children, i));
+        g_reminder_db_query_sort (children, n);
+
+        G_REMINDER_CLEANUP_FREE gchar *joined = g_strjoinv ((self->kind == G_REMINDER_DB_QUERY_AND) ? " AND " : " OR ", children);
+        g_string_append_printf (out, "(%s)", joined);
+        break;
+    }
+    }
+
+    return g_string_free (out, FALSE);
+}
+
+static void
+g_reminder_db_query_collect_terms (const GReminderDbQuery *self,
+                                   GPtrArray              *terms)
+{
+    if (self->kind == G_REMINDER_DB_QUERY_TERM)
+        g_ptr_array_add (terms, g_strdup (self->term));
+
+    for (guint i = 0; self->children && i < self->children->len; ++i)
+        g_reminder_db_query_collect_terms (g_ptr_array_index (self->children, i), terms);
+}
+
+gchar **
+g_reminder_db_query_get_terms (const GReminderDbQuery *self)
+{
+    GPtrArray *terms = g_ptr_array_new ();
+    guint n;
+
+    g_reminder_db_query_collect_terms (self, terms);
+    n = terms->len;
+    g_ptr_array_add (terms, NULL);
+
+    gchar **strings = (gchar **) g_ptr_array_free (terms, FALSE);
+    g_reminder_db_query_sort (strings, n);
+    return strings;
+}
+
+gboolean
+g_reminder_db_query_has_prefix (const GReminderDbQuery *self)
+{
+    if (self->kind == G_REMINDER_DB_QUERY_PREFIX)
+        return TRUE;
+
+    for (guint i = 0; self->children && i < self->children->len; ++i)
+    {
+        if (g_reminder_db_query_has_prefix (g_ptr_array_index (self->children, i)))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+gchar **
+g_reminder_db_query_get_conjunction (const GReminderDbQuery *self)
+{
+    if (self->kind == G_REMINDER_DB_QUERY_AND)
+    {
+        for (guint i = 0; i < self->children->len; ++i)
+        {
+            const GReminderDbQuery *child = g_ptr_array_index (self->children, i);
+
+            if (child->kind != G_REMINDER_DB_QUERY_TERM || g_reminder_db_text_is_term (child->term))
+                return NULL;
+        }
+    }
+    else if (self->kind != G_REMINDER_DB_QUERY_TERM || g_reminder_db_text_is_term (self->term))
+        return NULL;
+
+    return g_reminder_db_query_get_terms (self);
+}
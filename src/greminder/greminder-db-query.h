@@ -0,0 +1,94 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_QUERY_H__
+#define __G_REMINDER_DB_QUERY_H__
+
+#include "greminder-macros.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Search queries. Terms are keywords, separated by any amount of blanks:
+ *
+ *   a b            both a and b, the same as a AND b
+ *   a OR b         either of them
+ *   a NOT b        a but not b, the same as a AND NOT b
+ *   (a OR b) c     grouping
+ *   "a b"          a keyword with blanks or operators in it, \" and \\ escape
+ *   proj-*         any keyword starting with proj-, "proj-"* works too
+ *   text:milk      items whose contents hold the word milk, see greminder-db-text.h
+ *   text:"a b"     both words in the contents, text:mil* any word starting with mil
+ *
+ * Keywords match regardless of case and Unicode normalization form, "Café"
+ * finds items tagged "CAFÉ". Prefixes are folded on their own though, and
+ * the fold of a prefix is not always a prefix of the folded keyword: the
+ * characters that follow can compose with its last one, like a combining
+ * accent or a Hangul final consonant, and such keywords are then missed.
+ * Operators are only recognized in upper case, AND binds tighter than OR.
+ * A query must be answerable from the index alone: negations can only
+ * filter the results of other terms, a query only made of them would have
+ * to go through every item and is rejected along with malformed ones.
+ */
+typedef enum
+{
+    G_REMINDER_DB_QUERY_TERM,
+    G_REMINDER_DB_QUERY_PREFIX,
+    G_REMINDER_DB_QUERY_AND,
+    G_REMINDER_DB_QUERY_OR,
+    G_REMINDER_DB_QUERY_NOT
+} GReminderDbQueryKind;
+
+typedef struct _GReminderDbQuery GReminderDbQuery;
+
+struct _GReminderDbQuery
+{
+    GReminderDbQueryKind  kind;
+
+    /* Keyword, or prefix, of terms */
+    gchar                *term;
+    /* Operands of AND and OR, the single one of NOT */
+    GPtrArray            *children;
+};
+
+#define G_REMINDER_CLEANUP_QUERY_FREE G_REMINDER_CLEANUP (g_reminder_db_query_free_ptr)
+
+GReminderDbQuery *g_reminder_db_query_parse (const gchar  *text,
+                                             GError      **error);
+void              g_reminder_db_query_free  (GReminderDbQuery *self);
+
+static inline void
+g_reminder_db_query_free_ptr (GReminderDbQuery **self)
+{
+    if (*self)
+        g_reminder_db_query_free (*self);
+}
+
+/* The same string for queries only differing by the order of their operands or by quoting */
+gchar *g_reminder_db_query_to_string (const GReminderDbQuery *self);
+
+/* Keywords of the exact terms, sorted and deduplicated */
+gchar  **g_reminder_db_query_get_terms      (const GReminderDbQuery *self);
+gboolean g_reminder_db_query_has_prefix     (const GReminderDbQuery *self);
+/* Keywords of a query only made of exact keywords and implicit or explicit ANDs, NULL otherwise */
+gchar  **g_reminder_db_query_get_conjunction (const GReminderDbQuery *self);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_QUERY_H__*/
@@ -0,0 +1,314 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-rank.h"
+
+#include "greminder-db-record.h"
+
+#include <math.h>
+
+/* How many candidates go by between checks for cancellation */
+#define G_REMINDER_DB_RANK_CANCEL_CHECK 1024
+
+typedef struct
+{
+    GReminderDbPosting *posting;
+    gdouble             weight;
+    /* Most an item can get from the term, and from the ones before along with it */
+    gdouble             bound;
+    gdouble             bounds;
+} GReminderDbRankTerm;
+
+typedef struct
+{
+    guint64 id;
+    gdouble score;
+} GReminderDbRankHit;
+
+struct _GReminderDbRank
+{
+    GReminderDbSnapshot *snapshot;
+    guint64              items;
+    gdouble              average;
+    GArray              *terms;
+};
+
+static void
+g_reminder_db_rank_term_clear (gpointer data)
+{
+    GReminderDbRankTerm *term = data;
+    g_clear_pointer (&term->posting, g_reminder_db_posting_free);
+}
+
+GReminderDbRank *
+g_reminder_db_rank_new (GReminderDbSnapshot *snapshot,
+                        guint64              items,
+                        guint64              length)
+{
+    GReminderDbRank *self = g_new (GReminderDbRank, 1);
+
+    self->snapshot = g_reminder_db_snapshot_ref (snapshot);
+    self->items = items;
+    self->average = (items && length) ? (gdouble) length / items : 1.0;
+    self->terms = g_array_new (FALSE, FALSE, sizeof (GReminderDbRankTerm));
+    g_array_set_clear_func (self->terms, g_reminder_db_rank_term_clear);
+
+    return self;
+}
+
+void
+g_reminder_db_rank_free (GReminderDbRank *self)
+{
+    g_array_unref (self->terms);
+    g_reminder_db_snapshot_unref (self->snapshot);
+    g_free (self);
+}
+
+/* The part of the score of a term that depends on the length of the item */
+static gdouble
+g_reminder_db_rank_norm (const GReminderDbRank *self,
+                         gdouble                length)
+{
+    return (G_REMINDER_DB_RANK_K1 + 1) / (1 + G_REMINDER_DB_RANK_K1 * (1 - G_REMINDER_DB_RANK_B + G_REMINDER_DB_RANK_B * length / self->average));
+}
+
+void
+g_reminder_db_rank_add_term (GReminderDbRank    *self,
+                             GReminderDbPosting *posting,
+                             guint64             count,
+                             gdouble             boost)
+{
+    /* Items indexed before the lengths were stored are not counted yet */
+    gdouble items = MAX (self->items, count);
+    gdouble idf = log (1 + (items - count + 0.5) / (count + 0.5));
+    GReminderDbRankTerm term = { posting, boost * idf, 0, 0 };
+
+    /* Empty items score the most */
+    term.bound = term.weight * g_reminder_db_rank_norm (self, 0);
+    g_array_append_val (self->terms, term);
+}
+
+/* Items missing a length were not measured yet, they count as average */
+static gdouble
+g_reminder_db_rank_get_length (GReminderDbRank *self,
+                               guint64          id)
+{
+    G_REMINDER_CLEANUP_STRING_FREE GString *key = g_reminder_db_key_length (id);
+    G_REMINDER_CLEANUP_FREE gchar *err = NULL;
+    size_t len;
+    guint64 length;
+    gchar *value = leveldb_get (self->snapshot->db, self->snapshot->roptions, key->str, key->len, &len, &err);
+
+    G_REMINDER_DB_SNAPSHOT_COUNT (self->snapshot, keys, 1);
+    if (!value)
+        return self->average;
+
+    const gchar *data = value;
+    gboolean ok = g_reminder_db_varint_read (&data, value + len, &length);
+    leveldb_free (value);
+
+    return (ok) ? (gdouble) length : self->average;
+}
+
+static gint
+g_reminder_db_rank_term_cmp (gconstpointer a,
+                             gconstpointer b)
+{
+    gdouble x = ((const GReminderDbRankTerm *) a)->bound;
+    gdouble y = ((const GReminderDbRankTerm *) b)->bound;
+
+    return (x > y) - (x < y);
+}
+
+/* Ties go to the newest item */
+static gboolean
+g_reminder_db_rank_hit_is_worse (const GReminderDbRankHit *a,
+                                 const GReminderDbRankHit *b)
+{
+    if (a->score < b->score)
+        return TRUE;
+    if (a->score > b->score)
+        return FALSE;
+    return a->id < b->id;
+}
+
+#define G_REMINDER_DB_RANK_HIT(heap, i) (&g_array_index (heap, GReminderDbRankHit, i))
+
+static void
+g_reminder_db_rank_heap_swap (GArray *heap,
+                              guint   i,
+                              guint   j)
+{
+    GReminderDbRankHit hit = *G_REMINDER_DB_RANK_HIT (heap, i);
+
+    *G_REMINDER_DB_RANK_HIT (heap, i) = *G_REMINDER_DB_RANK_HIT (heap, j);
+    *G_REMINDER_DB_RANK_HIT (heap, j) = hit;
+}
+
+/* Min heap, the worst hit on top */
+static void
+g_reminder_db_rank_heap_down (GArray *heap,
+                              guint   i)
+{
+    for (;;)
+    {
+        guint worst = i;
+
+        for (guint child = 2 * i + 1; child <= 2 * i + 2 && child < heap->len; ++child)
+        {
+            if (g_reminder_db_rank_hit_is_worse (G_REMINDER_DB_RANK_HIT (heap, child), G_REMINDER_DB_RANK_HIT (heap, worst)))
+                worst = child;
+        }
+        if (worst == i)
+            return;
+        g_reminder_db_rank_heap_swap (heap, i, worst);
+        i = worst;
+    }
+}
+
+static void
+g_reminder_db_rank_heap_push (GArray                   *heap,
+                              const GReminderDbRankHit *hit)
+{
+    guint i = heap->len;
+
+    g_array_append_val (heap, *hit);
+    for (; i && g_reminder_db_rank_hit_is_worse (G_REMINDER_DB_RANK_HIT (heap, i), G_REMINDER_DB_RANK_HIT (heap, (i - 1) / 2)); i = (i - 1) / 2)
+        g_reminder_db_rank_heap_swap (heap, i, (i - 1) / 2);
+}
+
+GArray *
+g_reminder_db_rank_top (GReminderDbRank    *self,
+                        GReminderDbPosting *match,
+                        guint               n,
+                        GCancellable       *cancellable)
+{
+    GArray *terms = self->terms;
+    GArray *heap = g_array_new (FALSE, FALSE, sizeof (GReminderDbRankHit));
+    /* Terms before the first essential one cannot make it to the top by themselves */
+    guint essential = 0;
+    gdouble threshold = -1;
+    guint64 target = 0;
+    guint candidates = 0;
+
+    if (!n)
+        n = G_MAXUINT;
+
+    g_array_sort (terms, g_reminder_db_rank_term_cmp);
+    for (guint i = 0; i < terms->len; ++i)
+    {
+        GReminderDbRankTerm *term = &g_array_index (terms, GReminderDbRankTerm, i);
+        term->bounds = term->bound + ((i) ? g_array_index (terms, GReminderDbRankTerm, i - 1).bounds : 0);
+    }
+
+    while (!match->done)
+    {
+        /* Without terms to score, every match is a candidate */
+        guint64 id = (terms->len) ? G_MAXUINT64 : target;
+
+        if (!(++candidates % G_REMINDER_DB_RANK_CANCEL_CHECK) && g_cancellable_is_cancelled (cancellable))
+            break;
+
+        /* The next item holding an essential term, if it matches */
+        for (guint i = essential; i < terms->len; ++i)
+        {
+            GReminderDbPosting *posting = g_array_index (terms, GReminderDbRankTerm, i).posting;
+
+            g_reminder_db_posting_seek (posting, target);
+            if (!posting->done)
+                id = MIN (id, posting->id);
+        }
+        if (id == G_MAXUINT64)
+            break;
+
+        g_reminder_db_posting_seek (match, id);
+        if (match->done)
+            break;
+        if (match->id != id)
+        {
+            target = match->id;
+            continue;
+        }
+
+        gdouble norm = g_reminder_db_rank_norm (self, g_reminder_db_rank_get_length (self, id));
+        GReminderDbRankHit hit = { id, 0 };
+        gboolean out = FALSE;
+
+        target = id + 1;
+        for (guint i = essential; i < terms->len; ++i)
+        {
+            const GReminderDbRankTerm *term = &g_array_index (terms, GReminderDbRankTerm, i);
+            if (!term->posting->done && term->posting->id == id)
+                hit.score += term->weight * norm;
+        }
+        /* Stop checking the others as soon as they cannot make up for the difference */
+        for (guint i = essential; i-- > 0;)
+        {
+            const GReminderDbRankTerm *term = &g_array_index (terms, GReminderDbRankTerm, i);
+
+            if ((out = (hit.score + term->bounds < threshold)))
+                break;
+            g_reminder_db_posting_seek (term->posting, id);
+            if (!term->posting->done && term->posting->id == id)
+                hit.score += term->weight * norm;
+        }
+        if (out)
+            continue;
+
+        /* Summed again in a fixed order, so that equal items get equal scores */
+        hit.score = 0;
+        for (guint i = 0; i < terms->len; ++i)
+        {
+            const GReminderDbRankTerm *term = &g_array_index (terms, GReminderDbRankTerm, i);
+            if (!term->posting->done && term->posting->id == id)
+                hit.score += term->weight;
+        }
+        hit.score *= norm;
+
+        if (heap->len < n)
+            g_reminder_db_rank_heap_push (heap, &hit);
+        else if (g_reminder_db_rank_hit_is_worse (G_REMINDER_DB_RANK_HIT (heap, 0), &hit))
+        {
+            *G_REMINDER_DB_RANK_HIT (heap, 0) = hit;
+            g_reminder_db_rank_heap_down (heap, 0);
+        }
+        else
+            continue;
+
+        if (heap->len < n)
+            continue;
+        /* Later items win ties, only those strictly below the worst hit are out */
+        threshold = G_REMINDER_DB_RANK_HIT (heap, 0)->score;
+        while (essential < terms->len && g_array_index (terms, GReminderDbRankTerm, essential).bounds < threshold)
+            ++essential;
+    }
+
+    GArray *ids = g_array_sized_new (FALSE, FALSE, sizeof (guint64), heap->len);
+    g_array_set_size (ids, heap->len);
+    for (guint i = heap->len; i-- > 0;)
+    {
+        g_array_index (ids, guint64, i) = G_REMINDER_DB_RANK_HIT (heap, 0)->id;
+        g_reminder_db_rank_heap_swap (heap, 0, heap->len - 1);
+        g_array_set_size (heap, heap->len - 1);
+        g_reminder_db_rank_heap_down (heap, 0);
+    }
+    g_array_unref (heap);
+
+    return ids;
+}
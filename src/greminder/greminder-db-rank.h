@@ -0,0 +1,74 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_RANK_H__
+#define __G_REMINDER_DB_RANK_H__
+
+#include "greminder-db-posting.h"
+
+G_BEGIN_DECLS
+
+/*
+ * BM25 ranking of the items matching a query. Postings are sets, so each
+ * term counts once per item, and the length of an item is its number of
+ * keywords plus its number of distinct words, stored under \0L<id>. Terms
+ * get the idf of their number of items, keywords weigh more than words.
+ */
+#define G_REMINDER_DB_RANK_K1            1.2
+#define G_REMINDER_DB_RANK_B             0.75
+#define G_REMINDER_DB_RANK_KEYWORD_BOOST 2.0
+#define G_REMINDER_DB_RANK_TEXT_BOOST    1.0
+
+typedef struct _GReminderDbRank GReminderDbRank;
+
+#define G_REMINDER_CLEANUP_RANK_FREE G_REMINDER_CLEANUP (g_reminder_db_rank_free_ptr)
+
+/* items and length are those of the whole db, as of snapshot */
+GReminderDbRank *g_reminder_db_rank_new  (GReminderDbSnapshot *snapshot,
+                                          guint64              items,
+                                          guint64              length);
+void             g_reminder_db_rank_free (GReminderDbRank     *self);
+
+static inline void
+g_reminder_db_rank_free_ptr (GReminderDbRank **self)
+{
+    if (*self)
+        g_reminder_db_rank_free (*self);
+}
+
+/* Takes ownership of the posting of a term found in count items */
+void g_reminder_db_rank_add_term (GReminderDbRank    *self,
+                                  GReminderDbPosting *posting,
+                                  guint64             count,
+                                  gdouble             boost);
+
+/*
+ * Ids of the n best items of match, best first, ties going to the newest.
+ * 0 ranks them all. Following MaxScore, once n items are in, the terms
+ * that could not lift an item above the worst of them together stop
+ * proposing candidates and are only checked while they still could.
+ */
+GArray *g_reminder_db_rank_top (GReminderDbRank    *self,
+                                GReminderDbPosting *match,
+                                guint               n,
+                                GCancellable       *cancellable);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_RANK_H__*/
@@ -0,0 +1,107 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-record.h"
+
+#include "greminder-db-keys.h"
+#include "greminder-item-private.h"
+
+#include <string.h>
+
+void
+g_reminder_db_varint_append (GString *out,
+                             guint64  value)
+{
+    while (value >= 0x80)
+    {
+        g_string_append_c (out, (gchar) ((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    g_string_append_c (out, (gchar) value);
+}
+
+gboolean
+g_reminder_db_varint_read (const gchar **data,
+                           const gchar  *end,
+                           guint64      *value)
+{
+    guint64 v = 0;
+
+    for (guint shift = 0; *data < end && shift < 64; shift += 7)
+    {
+        guchar byte = (guchar) *(*data)++;
+        v |= (guint64) (byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            *value = v;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+GString *
+g_reminder_db_record_encode (const GReminderItem *item)
+{
+    const GSList *keywords = g_reminder_item_get_keywords (item);
+    GString *record = g_string_sized_new (64);
+
+    g_string_append_c (record, G_REMINDER_DB_RECORD_FORMAT);
+    g_reminder_db_varint_append (record, g_slist_length ((GSList *) keywords));
+    for (const GSList *k = keywords; k; k = g_slist_next (k))
+    {
+        size_t len = strlen (k->data);
+        g_reminder_db_varint_append (record, len);
+        g_string_append_len (record, k->data, len);
+    }
+    g_string_append (record, g_reminder_item_get_contents (item));
+
+    return record;
+}
+
+GReminderItem *
+g_reminder_db_record_decode (guint64      id,
+                             const gchar *data,
+                             size_t       len)
+{
+    G_REMINDER_CLEANUP_SLIST_FREE GSList *keywords = NULL;
+    const gchar *end = data + len;
+    guint64 count;
+
+    if (!len || *data++ != G_REMINDER_DB_RECORD_FORMAT)
+        return NULL;
+
+    if (!g_reminder_db_varint_read (&data, end, &count))
+        return NULL;
+
+    for (guint64 i = 0; i < count; ++i)
+    {
+        guint64 klen;
+        if (!g_reminder_db_varint_read (&data, end, &klen) || klen > (guint64) (end - data))
+            return NULL;
+        keywords = g_slist_prepend (keywords, g_reminder_db_strndup (data, klen));
+        data += klen;
+    }
+    keywords = g_slist_reverse (keywords);
+
+    GReminderItem *item = g_reminder_item_new_take (id, keywords, g_reminder_db_strndup (data, end - data));
+    keywords = NULL;
+    return item;
+}
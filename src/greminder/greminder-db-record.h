@@ -0,0 +1,52 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_RECORD_H__
+#define __G_REMINDER_DB_RECORD_H__
+
+#include "greminder-item.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Value stored under \0I<id>. Everything needed to rebuild the item is in
+ * there so that loading it is a single point read:
+ *
+ *   <format> <keyword count> (<length> <keyword>)* <contents>
+ *
+ * The format is one byte, counts and lengths are varints and the contents
+ * run until the end of the value.
+ */
+#define G_REMINDER_DB_RECORD_FORMAT 1
+
+GString *g_reminder_db_record_encode (const GReminderItem *item);
+
+GReminderItem *g_reminder_db_record_decode (guint64      id,
+                                            const gchar *data,
+                                            size_t       len);
+
+void     g_reminder_db_varint_append (GString *out,
+                                      guint64  value);
+gboolean g_reminder_db_varint_read   (const gchar **data,
+                                      const gchar  *end,
+                                      guint64      *value);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_RECORD_H__*/
@@ -0,0 +1,159 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-snapshot.h"
+
+#include "greminder-db-record.h"
+
+/* How far the batched loads step forward before seeking to the next record */
+#define G_REMINDER_DB_GET_ITEMS_STEPS 8
+
+GReminderDbSnapshot *
+g_reminder_db_snapshot_new (leveldb_t              *db,
+                            GReminderDbItemCache   *items,
+                            GReminderDbBitmapCache *bitmaps)
+{
+    GReminderDbSnapshot *self = g_new (GReminderDbSnapshot, 1);
+
+    self->ref = 1;
+    self->db = db;
+    self->items = items;
+    /* Taken first, anything invalidated from now on may be stale in the snapshot */
+    self->epoch = (items) ? g_reminder_db_item_cache_epoch (items) : 0;
+    /* Taken around it, a write in between leaves the snapshot without cached bitmaps */
+    self->version = (bitmaps) ? g_reminder_db_bitmap_cache_begin_read (bitmaps) : 0;
+    self->snapshot = leveldb_create_snapshot (db);
+    if (bitmaps)
+        self->version = g_reminder_db_bitmap_cache_end_read (bitmaps, self->version);
+    self->stats = NULL;
+
+    self->roptions = leveldb_readoptions_create ();
+    leveldb_readoptions_set_snapshot (self->roptions, self->snapshot);
+
+    self->scan_roptions = leveldb_readoptions_create ();
+    leveldb_readoptions_set_snapshot (self->scan_roptions, self->snapshot);
+    leveldb_readoptions_set_fill_cache (self->scan_roptions, FALSE);
+
+    return self;
+}
+
+GReminderDbSnapshot *
+g_reminder_db_snapshot_ref (GReminderDbSnapshot *self)
+{
+    g_atomic_int_inc (&self->ref);
+    return self;
+}
+
+void
+g_reminder_db_snapshot_unref (GReminderDbSnapshot *self)
+{
+    if (!g_atomic_int_dec_and_test (&self->ref))
+        return;
+
+    leveldb_readoptions_destroy (self->roptions);
+    leveldb_readoptions_destroy (self->scan_roptions);
+    leveldb_release_snapshot (self->db, self->snapshot);
+    g_free (self->stats);
+    g_free (self);
+}
+
+static gint
+g_reminder_db_id_cmp (gconstpointer a,
+                      gconstpointer b)
+{
+    guint64 ia = *(const guint64 *) a;
+    guint64 ib = *(const guint64 *) b;
+
+    return (ia > ib) - (ia < ib);
+}
+
+/*
+ * Ids are sorted so that a single iterator only ever moves forward,
+ * stepping over the gaps between close ids and seeking over larger ones.
+ */
+GSList *
+g_reminder_db_snapshot_get_items (GReminderDbSnapshot *snapshot,
+                                  GArray              *ids,
+                                  GCancellable        *cancellable)
+{
+    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = leveldb_create_iterator (snapshot->db, snapshot->roptions);
+    G_REMINDER_CLEANUP_STRING_FREE GString *key = g_reminder_db_key_new (G_REMINDER_DB_NS_ITEM);
+    gsize prefix_len = key->len;
+    gboolean positioned = FALSE;
+    GSList *items = NULL;
+
+    g_array_sort (ids, g_reminder_db_id_cmp);
+
+    for (guint i = 0; i < ids->len; ++i)
+    {
+        guint64 id = g_array_index (ids, guint64, i);
+        size_t klen, vlen;
+        const gchar *k;
+
+        if (g_cancellable_is_cancelled (cancellable))
+            break;
+        if (i && id == g_array_index (ids, guint64, i - 1))
+            continue;
+
+        GReminderItem *cached = (snapshot->items) ? g_reminder_db_item_cache_lookup (snapshot->items, id) : NULL;
+        if (cached)
+        {
+            G_REMINDER_DB_SNAPSHOT_COUNT (snapshot, item_cache_hits, 1);
+            items = g_slist_prepend (items, cached);
+            continue;
+        }
+
+        g_string_truncate (key, prefix_len);
+        g_reminder_db_key_append_id (key, id);
+
+        /* Step while the record is close by, a few nexts are cheaper than a seek */
+        for (guint step = 0; positioned && step < G_REMINDER_DB_GET_ITEMS_STEPS && leveldb_iter_valid (it); ++step)
+        {
+            k = leveldb_iter_key (it, &klen);
+            if (g_reminder_db_key_cmp (k, klen, key) >= 0)
+                break;
+            leveldb_iter_next (it);
+        }
+
+        if (!positioned || !leveldb_iter_valid (it) || g_reminder_db_key_cmp (leveldb_iter_key (it, &klen), klen, key) < 0)
+        {
+            G_REMINDER_DB_SNAPSHOT_COUNT (snapshot, seeks, 1);
+            leveldb_iter_seek (it, key->str, key->len);
+        }
+        positioned = TRUE;
+
+        if (!leveldb_iter_valid (it))
+            break;
+
+        k = leveldb_iter_key (it, &klen);
+        if (g_reminder_db_key_cmp (k, klen, key))
+            continue;
+
+        const gchar *record = leveldb_iter_value (it, &vlen);
+        G_REMINDER_DB_SNAPSHOT_COUNT (snapshot, items, 1);
+        GReminderItem *item = g_reminder_db_record_decode (id, record, vlen);
+        if (!item)
+            continue;
+        if (snapshot->items)
+            g_reminder_db_item_cache_insert (snapshot->items, item, snapshot->epoch);
+        items = g_slist_prepend (items, item);
+    }
+
+    return items;
+}
@@ -0,0 +1,99 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_SNAPSHOT_H__
+#define __G_REMINDER_DB_SNAPSHOT_H__
+
+#include "greminder-db-bitmap-cache.h"
+#include "greminder-db-item-cache.h"
+#include "greminder-db-keys.h"
+
+G_BEGIN_DECLS
+
+/*
+ * A consistent view of the db for the reads of one query. Point lookups go
+ * through roptions and fill the block cache, long scans go through
+ * scan_roptions which leave it alone so that they do not evict the blocks
+ * interactive lookups keep hitting. Background scans hold a reference on
+ * the snapshot, it is released when the last of them is done. Items are
+ * looked up in the item cache, if any, before being read.
+ */
+
+/* Work done through a snapshot, only counted for searches being analyzed */
+typedef struct
+{
+    gint keys;
+    gint blocks;
+    gint seeks;
+    gint items;
+    gint item_cache_hits;
+} GReminderDbSnapshotStats;
+
+/* Scans count from their own threads */
+#define G_REMINDER_DB_SNAPSHOT_COUNT(snapshot, counter, n)       \
+    G_STMT_START {                                               \
+        if ((snapshot)->stats)                                   \
+            g_atomic_int_add (&(snapshot)->stats->counter, (n)); \
+    } G_STMT_END
+
+typedef struct
+{
+    gint                      ref;
+
+    leveldb_t                *db;
+    const leveldb_snapshot_t *snapshot;
+    leveldb_readoptions_t    *roptions;
+    leveldb_readoptions_t    *scan_roptions;
+
+    GReminderDbItemCache     *items;
+    guint64                   epoch;
+    /* The last write the snapshot includes, for the bitmap cache */
+    guint64                   version;
+
+    /* Owned, scans may still be counting once the search is over */
+    GReminderDbSnapshotStats *stats;
+} GReminderDbSnapshot;
+
+#define G_REMINDER_CLEANUP_SNAPSHOT_UNREF G_REMINDER_CLEANUP (g_reminder_db_snapshot_unref_ptr)
+
+GReminderDbSnapshot *g_reminder_db_snapshot_new (leveldb_t              *db,
+                                                 GReminderDbItemCache   *items,
+                                                 GReminderDbBitmapCache *bitmaps);
+
+GReminderDbSnapshot *g_reminder_db_snapshot_ref   (GReminderDbSnapshot *self);
+void                 g_reminder_db_snapshot_unref (GReminderDbSnapshot *self);
+
+/*
+ * Load the records of a set of ids in one ordered pass, sorting ids in place.
+ * The items come out in descending id order, newest first.
+ */
+GSList *g_reminder_db_snapshot_get_items (GReminderDbSnapshot *snapshot,
+                                          GArray              *ids,
+                                          GCancellable        *cancellable);
+
+static inline void
+g_reminder_db_snapshot_unref_ptr (GReminderDbSnapshot **self)
+{
+    if (*self)
+        g_reminder_db_snapshot_unref (*self);
+}
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_SNAPSHOT_H__*/
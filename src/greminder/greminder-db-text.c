@@ -0,0 +1,106 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-text.h"
+
+#include <string.h>
+
+static gint
+g_reminder_db_text_cmp (gconstpointer a,
+                        gconstpointer b)
+{
+    return strcmp (*(const gchar * const *) a, *(const gchar * const *) b);
+}
+
+static void
+g_reminder_db_text_add_word (GPtrArray *terms,
+                             GString   *word)
+{
+    /* Only the mark */
+    if (word->len > 1)
+        g_ptr_array_add (terms, g_strndup (word->str, word->len));
+    g_string_truncate (word, 1);
+}
+
+gchar **
+g_reminder_db_text_get_terms (const gchar *text)
+{
+    G_REMINDER_CLEANUP_FREE gchar *normalized = (text) ? g_utf8_normalize (text, -1, G_NORMALIZE_NFKC) : NULL;
+    G_REMINDER_CLEANUP_FREE gchar *folded = (normalized) ? g_utf8_casefold (normalized, -1) : NULL;
+    GPtrArray *terms = g_ptr_array_new ();
+    GString *word = g_string_new (NULL);
+    gboolean cut = FALSE;
+    guint len = 0;
+
+    g_string_append_c (word, G_REMINDER_DB_TEXT_MARK);
+
+    for (const gchar *c = folded; c && *c; c = g_utf8_next_char (c))
+    {
+        gunichar u = g_utf8_get_char (c);
+
+        if (!g_unichar_isalnum (u) && !g_unichar_ismark (u))
+        {
+            g_reminder_db_text_add_word (terms, word);
+            cut = FALSE;
+            continue;
+        }
+
+        /* Once a character does not fit, the rest of the word is skipped rather than squeezed in */
+        if (!cut && word->len - 1 + g_unichar_to_utf8 (u, NULL) <= G_REMINDER_DB_TEXT_WORD_MAX)
+            g_string_append_unichar (word, u);
+        else
+            cut = TRUE;
+    }
+    g_reminder_db_text_add_word (terms, word);
+    g_string_free (word, TRUE);
+
+    g_ptr_array_sort (terms, g_reminder_db_text_cmp);
+    for (guint i = 0; i < terms->len; ++i)
+    {
+        if (len && !strcmp (g_ptr_array_index (terms, len - 1), g_ptr_array_index (terms, i)))
+            g_free (g_ptr_array_index (terms, i));
+        else
+            g_ptr_array_index (terms, len++) = g_ptr_array_index (terms, i);
+    }
+    g_ptr_array_set_size (terms, len);
+    g_ptr_array_add (terms, NULL);
+
+    return (gchar **) g_ptr_array_free (terms, FALSE);
+}
+
+gchar *
+g_reminder_db_text_fold (const gchar *keyword)
+{
+    G_REMINDER_CLEANUP_FREE gchar *normalized = g_utf8_normalize (keyword, -1, G_NORMALIZE_NFKC);
+
+    if (!normalized)
+        return g_strdup (keyword);
+
+    G_REMINDER_CLEANUP_FREE gchar *folded = g_utf8_casefold (normalized, -1);
+    return g_utf8_normalize (folded, -1, G_NORMALIZE_NFKC);
+}
+
+gchar *
+g_reminder_db_text_to_string (const gchar *keyword)
+{
+    if (!g_reminder_db_text_is_term (keyword))
+        return g_strdup (keyword);
+
+    return g_strdup_printf ("text:\"%s\"", keyword + 1);
+}
@@ -0,0 +1,62 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __G_REMINDER_DB_TEXT_H__
+#define __G_REMINDER_DB_TEXT_H__
+
+#include "greminder-macros.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Words of the contents of items are indexed like keywords, under terms
+ * made of the word behind a mark byte. The mark never occurs in UTF-8, so
+ * terms never collide with keywords, and it sorts after any keyword byte,
+ * so terms all come after the keywords in the dictionary.
+ */
+#define G_REMINDER_DB_TEXT_MARK '\xff'
+
+/* Longest word indexed, in bytes, longer ones are cut on a character boundary */
+#define G_REMINDER_DB_TEXT_WORD_MAX 64
+
+/*
+ * Terms of some text: its runs of letters, digits and marks, NFKC
+ * normalized and case folded. Sorted and deduplicated, NULL gives none.
+ */
+gchar **g_reminder_db_text_get_terms (const gchar *text);
+
+/*
+ * What keywords are indexed and looked up under: NFKC normalized, case
+ * folded and normalized again, since folding may denormalize, so that a
+ * folded keyword folds to itself. Invalid UTF-8 is kept as is.
+ */
+gchar *g_reminder_db_text_fold (const gchar *keyword);
+
+static inline gboolean
+g_reminder_db_text_is_term (const gchar *keyword)
+{
+    return keyword[0] == G_REMINDER_DB_TEXT_MARK;
+}
+
+/* How a keyword or term is written in a query, terms as text:"word" */
+gchar *g_reminder_db_text_to_string (const gchar *keyword);
+
+G_END_DECLS
+
+#endif /*__G_REMINDER_DB_TEXT_H__*/
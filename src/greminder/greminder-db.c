@@ -19,320 +19,2240 @@
 
 #include "greminder-db-private.h"
 
-#include <leveldb/c.h>
+#include "greminder-db-bitmap-cache.h"
+#include "greminder-db-block.h"
+#include "greminder-db-config.h"
+#include "greminder-db-cursor-private.h"
+#include "greminder-db-explain-private.h"
+#include "greminder-db-fuzzy.h"
+#include "greminder-db-item-cache.h"
+#include "greminder-db-keys.h"
+#include "greminder-db-legacy.h"
+#include "greminder-db-posting.h"
+#include "greminder-db-query.h"
+#include "greminder-db-query-cache.h"
+#include "greminder-db-rank.h"
+#include "greminder-db-record.h"
+#include "greminder-db-snapshot.h"
+#include "greminder-db-text.h"
 
 #include <string.h>
 
-#define G_REMINDER_CLEANUP_SLIST_FREE G_REMINDER_CLEANUP (g_reminder_slist_free_ptr)
+/* Relaxed writes get synced once none came for this long, in microseconds */
+#define G_REMINDER_DB_FLUSH_DELAY G_TIME_SPAN_SECOND
 
-#define G_REMINDER_CLEANUP_DB_ITER_DESTROY G_REMINDER_CLEANUP (g_reminder_db_iter_destroy)
+/* Upper bounds for the work done by one step of the schema migration */
+#define G_REMINDER_DB_MIGRATION_ITEMS 64
+#define G_REMINDER_DB_MIGRATION_KEYS  1024
 
-static void
-g_reminder_slist_free_ptr (GSList **l)
-{
-    g_slist_free_full (*l, g_free);
-    *l = NULL;
-}
+/*
+ * Terms of a query get scanned in parallel when they are long enough for the
+ * thread handoff to pay off, and not so much longer than the rarest term that
+ * seeking through them from its ids would beat reading them whole.
+ */
+#define G_REMINDER_DB_SCAN_MIN  4096
+#define G_REMINDER_DB_SCAN_SKEW 16
 
-static void
-g_reminder_db_iter_destroy (leveldb_iterator_t **it)
-{
-    leveldb_iter_destroy (*it);
-}
+/* Keywords tagging more items than this get their postings cached as bitmaps */
+#define G_REMINDER_DB_BITMAP_MIN 1024
+
+/* Prefixes only look for the first keywords they expand to, explain reports the cut */
+#define G_REMINDER_DB_PREFIX_MAX_TERMS 4096
+/* Prefixes expanding to more keywords than this read them all in one range scan */
+#define G_REMINDER_DB_PREFIX_MERGE_MAX 16
 
 struct _GReminderDbPrivate
 {
     leveldb_t              *db;
     leveldb_options_t      *options;
+    leveldb_cache_t        *cache;
+    leveldb_filterpolicy_t *filter;
     leveldb_readoptions_t  *roptions;
+    leveldb_readoptions_t  *scan_roptions;
     leveldb_writeoptions_t *woptions;
+    leveldb_writeoptions_t *sync_woptions;
+    GThreadPool            *scan_pool;
+    GReminderDbQueryCache  *query_cache;
+    GReminderDbItemCache   *item_cache;
+    GReminderDbBitmapCache *bitmap_cache;
+
+    guint64                 next_id;
+    /* Number and total length of the items measured, see greminder-db-rank.h */
+    guint64                 rank_items;
+    guint64                 rank_length;
+    guint                   search_results;
+
+    GReminderDbDurability   durability;
+    gulong                  group_commit_window;
+    GMutex                  write_lock;
+    GMutex                  sync_lock;
+    GCond                   synced;
+    guint64                 written;
+    guint64                 durable;
+    gboolean                syncing;
+    /* The relaxed flush waiting for writes to pause, and finalize to stop it */
+    gboolean                flushing;
+    gboolean                closing;
+    GCond                   flush_wake;
+
+    gboolean                migrating;
+    gboolean                repacking;
+    gboolean                indexing;
+    gboolean                folding;
+    GCancellable           *migration_cancellable;
+    gboolean                migration_running;
+    GCond                   migrated;
+    GHashTable             *legacy_ids;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (GReminderDb, g_reminder_db, G_TYPE_OBJECT)
 
-static gboolean
-g_reminder_db_private_put (GReminderDbPrivate *priv,
-                           const gchar        *key,
-                           size_t              klen,
-                           const gchar        *value)
+/* New length of an item, -1 once deleted */
+typedef struct
+{
+    guint64 id;
+    gint64  length;
+} GReminderDbLength;
+
+/* A write batch along with the posting changes it implies, per keyword */
+typedef struct
+{
+    leveldb_writebatch_t *batch;
+    GHashTable           *postings;
+    /* How the keywords new to the dictionary are spelled, by folded keyword */
+    GHashTable           *spellings;
+    /* Ids of the records written or deleted */
+    GArray               *ids;
+    GArray               *lengths;
+    /* Postings only move to blocks, the dictionary stays as is */
+    gboolean              repack;
+    /* Keywords may still be indexed as typed, removals go there too */
+    gboolean              folding;
+} GReminderDbBatch;
+
+#define G_REMINDER_CLEANUP_BATCH_FREE G_REMINDER_CLEANUP (g_reminder_db_batch_free_ptr)
+
+static GReminderDbBatch *
+g_reminder_db_batch_new (void)
+{
+    GReminderDbBatch *batch = g_new (GReminderDbBatch, 1);
+
+    batch->batch = leveldb_writebatch_create ();
+    batch->postings = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_array_unref);
+    batch->spellings = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    batch->ids = g_array_new (FALSE, FALSE, sizeof (guint64));
+    batch->lengths = g_array_new (FALSE, FALSE, sizeof (GReminderDbLength));
+    batch->repack = FALSE;
+    batch->folding = FALSE;
+
+    return batch;
+}
+
+static void
+g_reminder_db_batch_free_ptr (GReminderDbBatch **batch)
+{
+    leveldb_writebatch_destroy ((*batch)->batch);
+    g_hash_table_unref ((*batch)->postings);
+    g_hash_table_unref ((*batch)->spellings);
+    g_array_unref ((*batch)->ids);
+    g_array_unref ((*batch)->lengths);
+    g_free (*batch);
+}
+
+static void
+g_reminder_db_batch_posting (GReminderDbBatch *batch,
+                             const gchar      *keyword,
+                             guint64           id,
+                             gboolean          add)
+{
+    GArray *ops = g_hash_table_lookup (batch->postings, keyword);
+
+    if (!ops)
+    {
+        ops = g_reminder_db_block_ops_new ();
+        g_hash_table_insert (batch->postings, g_strdup (keyword), ops);
+    }
+    g_reminder_db_block_ops_add (ops, id, add);
+}
+
+/* The first spelling of a keyword wins, should it be new to the dictionary */
+static void
+g_reminder_db_batch_spelling (GReminderDbBatch *batch,
+                              const gchar      *keyword,
+                              const gchar      *spelling)
+{
+    if (strcmp (keyword, spelling) && !g_hash_table_contains (batch->spellings, keyword))
+        g_hash_table_insert (batch->spellings, g_strdup (keyword), g_strdup (spelling));
+}
+
+/* Reads the count of a dictionary entry, returns its spelling if it has one */
+static gchar *
+g_reminder_db_keyword_decode (const gchar *value,
+                              size_t       len,
+                              guint64     *count)
+{
+    const gchar *data = value;
+
+    if (!g_reminder_db_varint_read (&data, value + len, count))
+    {
+        *count = 0;
+        return NULL;
+    }
+    return (data < value + len) ? g_reminder_db_strndup (data, value + len - data) : NULL;
+}
+
+static guint64
+g_reminder_db_private_get_keyword_count (GReminderDbPrivate          *priv,
+                                         const leveldb_readoptions_t *roptions,
+                                         const gchar                 *keyword)
 {
+    G_REMINDER_CLEANUP_STRING_FREE GString *key = g_reminder_db_key_keyword (keyword);
     G_REMINDER_CLEANUP_FREE gchar *err = NULL;
-    leveldb_put (priv->db, priv->woptions, key, klen, value, strlen (value), &err);
-    return !err;
+    size_t len;
+    guint64 count = 0;
+    gchar *value = leveldb_get (priv->db, roptions, key->str, key->len, &len, &err);
+
+    if (!value)
+        return 0;
+
+    const gchar *data = value;
+    if (!g_reminder_db_varint_read (&data, value + len, &count))
+        count = 0;
+    leveldb_free (value);
+    return count;
 }
 
 static gboolean
-g_reminder_db_private_put_suffix (GReminderDbPrivate *priv,
-                                  const gchar        *key,
-                                  const gchar        *value)
+g_reminder_db_private_get_length (GReminderDbPrivate *priv,
+                                  guint64             id,
+                                  guint64            *length)
 {
-    G_REMINDER_CLEANUP_FREE gchar *_key = g_strdup_printf ("%s%c%s", key, '\0', value);
-    return g_reminder_db_private_put (priv, _key, strlen (key) + strlen (value) + 1, value);
+    G_REMINDER_CLEANUP_STRING_FREE GString *key = g_reminder_db_key_length (id);
+    G_REMINDER_CLEANUP_FREE gchar *err = NULL;
+    size_t len;
+    gchar *value = leveldb_get (priv->db, priv->roptions, key->str, key->len, &len, &err);
+
+    if (!value)
+        return FALSE;
+
+    const gchar *data = value;
+    gboolean ok = g_reminder_db_varint_read (&data, value + len, length);
+    leveldb_free (value);
+    return ok;
 }
 
-static gchar *sdup (const gchar *in, size_t *s)
+static void
+g_reminder_db_private_put_total (leveldb_writebatch_t *batch,
+                                 const gchar          *name,
+                                 guint64               total)
 {
-    gchar *out = g_new0 (char, *s + 1);
-    memcpy (out, in, *s);
-    return out;
+    G_REMINDER_CLEANUP_STRING_FREE GString *key = g_reminder_db_key_meta (name);
+    G_REMINDER_CLEANUP_FREE gchar *value = g_strdup_printf ("%" G_GUINT64_FORMAT, total);
+
+    leveldb_writebatch_put (batch, key->str, key->len, value, strlen (value));
 }
 
-G_REMINDER_VISIBLE gboolean
-g_reminder_db_save (const GReminderDb   *self,
-                    const GReminderItem *item)
+/*
+ * The totals follow from what each length replaces, so that measuring an
+ * item twice, as the backfill may do, does not count it twice. An item
+ * written twice by the same batch replaces the length it got first.
+ */
+static void
+g_reminder_db_private_apply_lengths (GReminderDbPrivate *priv,
+                                     GReminderDbBatch   *batch,
+                                     guint64            *items,
+                                     guint64            *length)
 {
-    g_return_val_if_fail (G_REMINDER_IS_DB (self), FALSE);
-    g_return_val_if_fail (G_REMINDER_IS_ITEM (item), FALSE);
+    GHashTable *written = g_hash_table_new (g_int64_hash, g_int64_equal);
 
-    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
-    
-    const gchar *contents = g_reminder_item_get_contents (item);
-    const gchar *checksum = g_reminder_item_get_checksum (item);
+    for (guint i = 0; i < batch->lengths->len; ++i)
+    {
+        const GReminderDbLength *change = &g_array_index (batch->lengths, GReminderDbLength, i);
+        const GReminderDbLength *previous = g_hash_table_lookup (written, &change->id);
+        G_REMINDER_CLEANUP_STRING_FREE GString *key = g_reminder_db_key_length (change->id);
+        guint64 old = (previous) ? (guint64) previous->length : 0;
+        gboolean measured = (previous) ? previous->length >= 0 : g_reminder_db_private_get_length (priv, change->id, &old);
+
+        g_hash_table_insert (written, (gpointer) &change->id, (gpointer) change);
+        if (measured)
+        {
+            --*items;
+            *length -= MIN (old, *length);
+        }
+
+        if (change->length < 0)
+        {
+            leveldb_writebatch_delete (batch->batch, key->str, key->len);
+            continue;
+        }
+
+        G_REMINDER_CLEANUP_STRING_FREE GString *value = g_string_sized_new (10);
+        g_reminder_db_varint_append (value, change->length);
+        leveldb_writebatch_put (batch->batch, key->str, key->len, value->str, value->len);
+        ++*items;
+        *length += change->length;
+    }
+    g_hash_table_unref (written);
+
+    if (batch->lengths->len)
+    {
+        g_reminder_db_private_put_total (batch->batch, "rank-items", *items);
+        g_reminder_db_private_put_total (batch->batch, "rank-length", *length);
+    }
+}
+
+static gboolean
+g_reminder_db_private_apply (GReminderDbPrivate *priv,
+                             GReminderDbBatch   *batch)
+{
+    G_REMINDER_CLEANUP_FREE gchar *err = NULL;
+    guint64 items = priv->rank_items;
+    guint64 length = priv->rank_length;
+    GHashTableIter iter;
+    gpointer keyword, ops;
+
+    g_hash_table_iter_init (&iter, batch->postings);
+    while (g_hash_table_iter_next (&iter, &keyword, &ops))
+    {
+        gint64 delta = g_reminder_db_block_update (priv->db, priv->roptions, batch->batch, keyword, ops, priv->repacking);
+        if (!delta || batch->repack)
+            continue;
+
+        G_REMINDER_CLEANUP_STRING_FREE GString *key = g_reminder_db_key_keyword (keyword);
+        G_REMINDER_CLEANUP_FREE gchar *get_err = NULL;
+        size_t len;
+        guint64 old = 0;
+        gchar *entry = leveldb_get (priv->db, priv->roptions, key->str, key->len, &len, &get_err);
+        /* Keywords already in the dictionary keep their spelling */
+        G_REMINDER_CLEANUP_FREE gchar *spelling = (entry) ? g_reminder_db_keyword_decode (entry, len, &old) : g_strdup (g_hash_table_lookup (batch->spellings, keyword));
+        gint64 count = (gint64) old + delta;
+
+        leveldb_free (entry);
+        if (count > 0)
+        {
+            G_REMINDER_CLEANUP_STRING_FREE GString *value = g_string_sized_new (10);
+            g_reminder_db_varint_append (value, count);
+            if (spelling)
+                g_string_append (value, spelling);
+            leveldb_writebatch_put (batch->batch, key->str, key->len, value->str, value->len);
+        }
+        else
+            leveldb_writebatch_delete (batch->batch, key->str, key->len);
+    }
 
-    if (!g_reminder_db_private_put (priv, checksum, strlen (checksum), contents))
+    g_reminder_db_private_apply_lengths (priv, batch, &items, &length);
+
+    leveldb_write (priv->db, (priv->durability == G_REMINDER_DB_DURABILITY_SYNC) ? priv->sync_woptions : priv->woptions, batch->batch, &err);
+    if (err)
         return FALSE;
 
+    priv->rank_items = items;
+    priv->rank_length = length;
+    return TRUE;
+}
+
+/* Make every write numbered up to seq durable, sharing the sync with other waiters */
+static gboolean
+g_reminder_db_private_sync (GReminderDbPrivate *priv,
+                            guint64             seq,
+                            gulong              window)
+{
+    gboolean ok = TRUE;
+
+    g_mutex_lock (&priv->sync_lock);
+    while (ok && priv->durable < seq)
+    {
+        if (priv->syncing)
+        {
+            g_cond_wait (&priv->synced, &priv->sync_lock);
+            continue;
+        }
+
+        priv->syncing = TRUE;
+        g_mutex_unlock (&priv->sync_lock);
+
+        /* Give the writers arriving right behind us a chance to ride along */
+        if (window)
+            g_usleep (window);
+
+        g_mutex_lock (&priv->sync_lock);
+        guint64 target = priv->written;
+        g_mutex_unlock (&priv->sync_lock);
+
+        /* An empty synced write flushes the log, including all the writes before it */
+        G_REMINDER_CLEANUP_DB_BATCH_DESTROY leveldb_writebatch_t *empty = leveldb_writebatch_create ();
+        G_REMINDER_CLEANUP_FREE gchar *err = NULL;
+        leveldb_write (priv->db, priv->sync_woptions, empty, &err);
+        ok = !err;
+
+        g_mutex_lock (&priv->sync_lock);
+        if (ok)
+            priv->durable = MAX (priv->durable, target);
+        priv->syncing = FALSE;
+        g_cond_broadcast (&priv->synced);
+    }
+    g_mutex_unlock (&priv->sync_lock);
+
+    return ok;
+}
+
+static gboolean
+g_reminder_db_private_flush (GReminderDbPrivate *priv)
+{
+    g_mutex_lock (&priv->sync_lock);
+    guint64 seq = priv->written;
+    g_mutex_unlock (&priv->sync_lock);
+
+    return g_reminder_db_private_sync (priv, seq, 0);
+}
+
+/*
+ * Relaxed writes start a flush on GTask's worker pool, which syncs once no
+ * write came for G_REMINDER_DB_FLUSH_DELAY. It needs no main loop and keeps
+ * the sync off the UI thread. It holds no reference on the db: finalize
+ * wakes it up and waits for it, then flushes by itself.
+ */
+static void
+g_reminder_db_flush_thread (GTask        *task,
+                            gpointer      source_object G_GNUC_UNUSED,
+                            gpointer      task_data,
+                            GCancellable *cancellable G_GNUC_UNUSED)
+{
+    GReminderDbPrivate *priv = task_data;
+    gboolean ok = TRUE;
+
+    g_mutex_lock (&priv->sync_lock);
+    /* Writes landing during the sync are flushed in another round */
+    while (ok && !priv->closing && priv->durable < priv->written)
+    {
+        for (guint64 written = 0; !priv->closing && written != priv->written;)
+        {
+            gint64 deadline = g_get_monotonic_time () + G_REMINDER_DB_FLUSH_DELAY;
+
+            written = priv->written;
+            while (!priv->closing && g_cond_wait_until (&priv->flush_wake, &priv->sync_lock, deadline));
+        }
+        if (priv->closing)
+            break;
+
+        g_mutex_unlock (&priv->sync_lock);
+        if (!(ok = g_reminder_db_private_flush (priv)))
+            g_warning ("Could not flush the database to disk");
+        g_mutex_lock (&priv->sync_lock);
+    }
+    priv->flushing = FALSE;
+    g_cond_broadcast (&priv->flush_wake);
+    g_mutex_unlock (&priv->sync_lock);
+
+    g_task_return_boolean (task, TRUE);
+}
+
+/*
+ * Writers hold write_lock from the moment they read what their batch depends
+ * on (dictionary counts, ids, the migration state) until it is applied. The
+ * returned sequence number is what to wait on, once the lock is released.
+ */
+static gboolean
+g_reminder_db_private_write (GReminderDbPrivate *priv,
+                             GReminderDbBatch   *batch,
+                             guint64            *seq)
+{
+    if (priv->bitmap_cache)
+        g_reminder_db_bitmap_cache_begin_write (priv->bitmap_cache);
+
+    gboolean ok = g_reminder_db_private_apply (priv, batch);
+
+    if (ok && priv->query_cache && !batch->repack)
+    {
+        GHashTableIter iter;
+        gpointer keyword;
+
+        g_hash_table_iter_init (&iter, batch->postings);
+        while (g_hash_table_iter_next (&iter, &keyword, NULL))
+            g_reminder_db_query_cache_invalidate (priv->query_cache, keyword);
+    }
+
+    if (ok && priv->bitmap_cache && !batch->repack)
+    {
+        GHashTableIter iter;
+        gpointer keyword, ops;
+
+        g_hash_table_iter_init (&iter, batch->postings);
+        while (g_hash_table_iter_next (&iter, &keyword, &ops))
+            g_reminder_db_bitmap_cache_update (priv->bitmap_cache, keyword, ops);
+    }
+
+    if (priv->bitmap_cache)
+        g_reminder_db_bitmap_cache_end_write (priv->bitmap_cache);
+
+    /* Whether the write went through or not, cached versions cannot be trusted anymore */
+    for (guint i = 0; priv->item_cache && i < batch->ids->len; ++i)
+        g_reminder_db_item_cache_invalidate (priv->item_cache, g_array_index (batch->ids, guint64, i));
+
+    g_mutex_lock (&priv->sync_lock);
+    *seq = ++priv->written;
+    if (ok && priv->durability == G_REMINDER_DB_DURABILITY_SYNC)
+        priv->durable = *seq;
+    else if (ok && priv->durability == G_REMINDER_DB_DURABILITY_RELAXED && !priv->flushing)
+    {
+        G_REMINDER_CLEANUP_UNREF GTask *task = g_task_new (NULL, NULL, NULL, NULL);
+
+        priv->flushing = TRUE;
+        g_task_set_task_data (task, priv, NULL);
+        g_task_run_in_thread (task, g_reminder_db_flush_thread);
+    }
+    g_mutex_unlock (&priv->sync_lock);
+
+    return ok;
+}
+
+static gboolean
+g_reminder_db_private_wait_durable (GReminderDbPrivate *priv,
+                                    guint64             seq)
+{
+    if (priv->durability != G_REMINDER_DB_DURABILITY_GROUP)
+        return TRUE;
+    return g_reminder_db_private_sync (priv, seq, priv->group_commit_window);
+}
+
+static gchar *
+g_reminder_db_private_get_meta (GReminderDbPrivate *priv,
+                                const gchar        *name)
+{
+    G_REMINDER_CLEANUP_STRING_FREE GString *key = g_reminder_db_key_meta (name);
+    G_REMINDER_CLEANUP_FREE gchar *err = NULL;
+    size_t len;
+    gchar *value = leveldb_get (priv->db, priv->roptions, key->str, key->len, &len, &err);
+
+    if (!value)
+        return NULL;
+
+    gchar *ret = g_reminder_db_strndup (value, len);
+    leveldb_free (value);
+    return ret;
+}
+
+/* Totals are kept as metadata, read through roptions to see them as of some snapshot */
+static guint64
+g_reminder_db_private_get_total (GReminderDbPrivate          *priv,
+                                 const leveldb_readoptions_t *roptions,
+                                 const gchar                 *name)
+{
+    G_REMINDER_CLEANUP_STRING_FREE GString *key = g_reminder_db_key_meta (name);
+    G_REMINDER_CLEANUP_FREE gchar *err = NULL;
+    size_t len;
+    gchar *value = leveldb_get (priv->db, roptions, key->str, key->len, &len, &err);
+
+    if (!value)
+        return 0;
+
+    G_REMINDER_CLEANUP_FREE gchar *total = g_reminder_db_strndup (value, len);
+    leveldb_free (value);
+    return g_ascii_strtoull (total, NULL, 10);
+}
+
+static void
+g_reminder_db_private_put_meta (GReminderDbBatch     *batch,
+                                const gchar          *name,
+                                const gchar          *value)
+{
+    G_REMINDER_CLEANUP_STRING_FREE GString *key = g_reminder_db_key_meta (name);
+    leveldb_writebatch_put (batch->batch, key->str, key->len, value, strlen (value));
+}
+
+static void
+g_reminder_db_private_delete_meta (GReminderDbBatch     *batch,
+                                   const gchar          *name)
+{
+    G_REMINDER_CLEANUP_STRING_FREE GString *key = g_reminder_db_key_meta (name);
+    leveldb_writebatch_delete (batch->batch, key->str, key->len);
+}
+
+/* Give the item an id if it has none yet, and persist the id counter */
+static void
+g_reminder_db_private_assign_id (GReminderDbPrivate   *priv,
+                                 GReminderDbBatch     *batch,
+                                 GReminderItem        *item)
+{
+    if (!g_reminder_item_get_id (item))
+        g_reminder_item_set_id (item, priv->next_id++);
+
+    G_REMINDER_CLEANUP_FREE gchar *next_id = g_strdup_printf ("%" G_GUINT64_FORMAT, priv->next_id);
+    g_reminder_db_private_put_meta (batch, "next-id", next_id);
+}
+
+/* Whether item has a keyword folding like the folded one */
+static gboolean
+g_reminder_db_private_has_keyword (const GReminderItem *item,
+                                   const gchar         *folded)
+{
     for (const GSList *k = g_reminder_item_get_keywords (item); k; k = g_slist_next (k))
     {
-        if (!g_reminder_db_private_put_suffix (priv, k->data, checksum) ||
-            !g_reminder_db_private_put_suffix (priv, checksum, k->data))
-                return FALSE;
+        G_REMINDER_CLEANUP_FREE gchar *keyword = g_reminder_db_text_fold (k->data);
+        if (!strcmp (keyword, folded))
+            return TRUE;
     }
+    return FALSE;
+}
 
-    return TRUE;
+static void
+g_reminder_db_private_put_keyword (GReminderDbBatch     *batch,
+                                   guint64               id,
+                                   const gchar          *keyword)
+{
+    G_REMINDER_CLEANUP_FREE gchar *folded = g_reminder_db_text_fold (keyword);
+
+    g_reminder_db_batch_posting (batch, folded, id, TRUE);
+    g_reminder_db_batch_spelling (batch, folded, keyword);
 }
 
-static GSList *
-g_reminder_db_private_find (GReminderDbPrivate *priv,
-                            const gchar        *keyword)
+static void
+g_reminder_db_private_delete_keyword (GReminderDbBatch     *batch,
+                                      guint64               id,
+                                      const gchar          *keyword)
+{
+    G_REMINDER_CLEANUP_FREE gchar *folded = g_reminder_db_text_fold (keyword);
+
+    g_reminder_db_batch_posting (batch, folded, id, FALSE);
+    if (batch->folding && strcmp (folded, keyword))
+        g_reminder_db_batch_posting (batch, keyword, id, FALSE);
+}
+
+/*
+ * Index the words of the contents of item in place of those of old, either
+ * of which may be NULL. Only the terms that differ get their postings
+ * changed, the length of the item is stored in any case.
+ */
+static void
+g_reminder_db_private_index_contents (GReminderDbBatch     *batch,
+                                      guint64               id,
+                                      const GReminderItem  *old,
+                                      const GReminderItem  *item)
+{
+    const gchar *before = (old) ? g_reminder_item_get_contents (old) : NULL;
+    const gchar *after = (item) ? g_reminder_item_get_contents (item) : NULL;
+    G_REMINDER_CLEANUP_STRFREEV gchar **added = g_reminder_db_text_get_terms (after);
+    GReminderDbLength length = { id, -1 };
+
+    if (item)
+        length.length = g_slist_length ((GSList *) g_reminder_item_get_keywords (item)) + g_strv_length (added);
+    g_array_append_val (batch->lengths, length);
+
+    if (old && item && !g_strcmp0 (before, after))
+        return;
+
+    G_REMINDER_CLEANUP_STRFREEV gchar **removed = g_reminder_db_text_get_terms (before);
+    gchar **r = removed, **a = added;
+
+    while (*r || *a)
+    {
+        gint cmp = (!*a) ? -1 : (!*r) ? 1 : strcmp (*r, *a);
+
+        if (cmp < 0)
+            g_reminder_db_batch_posting (batch, *r++, id, FALSE);
+        else if (cmp > 0)
+            g_reminder_db_batch_posting (batch, *a++, id, TRUE);
+        else
+        {
+            ++r;
+            ++a;
+        }
+    }
+}
+
+static void
+g_reminder_db_private_put_record (GReminderDbBatch     *batch,
+                                  const GReminderItem  *item)
+{
+    guint64 id = g_reminder_item_get_id (item);
+    G_REMINDER_CLEANUP_STRING_FREE GString *key = g_reminder_db_key_item (id);
+    G_REMINDER_CLEANUP_STRING_FREE GString *record = g_reminder_db_record_encode (item);
+
+    leveldb_writebatch_put (batch->batch, key->str, key->len, record->str, record->len);
+    g_array_append_val (batch->ids, id);
+}
+
+static void
+g_reminder_db_private_save_item (GReminderDbBatch     *batch,
+                                 const GReminderItem  *item)
+{
+    guint64 id = g_reminder_item_get_id (item);
+
+    g_reminder_db_private_put_record (batch, item);
+
+    for (const GSList *k = g_reminder_item_get_keywords (item); k; k = g_slist_next (k))
+        g_reminder_db_private_put_keyword (batch, id, k->data);
+    g_reminder_db_private_index_contents (batch, id, NULL, item);
+}
+
+static void
+g_reminder_db_private_delete_item (GReminderDbBatch     *batch,
+                                   const GReminderItem  *item)
+{
+    guint64 id = g_reminder_item_get_id (item);
+    G_REMINDER_CLEANUP_STRING_FREE GString *key = g_reminder_db_key_item (id);
+
+    leveldb_writebatch_delete (batch->batch, key->str, key->len);
+    g_array_append_val (batch->ids, id);
+
+    for (const GSList *k = g_reminder_item_get_keywords (item); k; k = g_slist_next (k))
+        g_reminder_db_private_delete_keyword (batch, id, k->data);
+    g_reminder_db_private_index_contents (batch, id, item, NULL);
+}
+
+/* Only write what differs between two versions of the same item */
+static void
+g_reminder_db_private_update_item (GReminderDbBatch     *batch,
+                                   const GReminderItem  *old,
+                                   const GReminderItem  *item)
+{
+    guint64 id = g_reminder_item_get_id (item);
+
+    /* The record holds the keywords too, the index only needs the ones that changed */
+    g_reminder_db_private_put_record (batch, item);
+
+    /* Respelling a keyword changes nothing to the index */
+    for (const GSList *k = g_reminder_item_get_keywords (old); k; k = g_slist_next (k))
+    {
+        G_REMINDER_CLEANUP_FREE gchar *folded = g_reminder_db_text_fold (k->data);
+        if (!g_reminder_db_private_has_keyword (item, folded))
+            g_reminder_db_private_delete_keyword (batch, id, k->data);
+    }
+
+    for (const GSList *k = g_reminder_item_get_keywords (item); k; k = g_slist_next (k))
+    {
+        G_REMINDER_CLEANUP_FREE gchar *folded = g_reminder_db_text_fold (k->data);
+        if (!g_reminder_db_private_has_keyword (old, folded))
+            g_reminder_db_private_put_keyword (batch, id, k->data);
+    }
+
+    g_reminder_db_private_index_contents (batch, id, old, item);
+}
+
+/*
+ * Items loaded from the legacy layout have no id yet. If the migration moved
+ * them in the meantime, they have to be edited under the id they got then.
+ */
+static GReminderItem *
+g_reminder_db_private_resolve_legacy (GReminderDbPrivate  *priv,
+                                      const GReminderItem *item)
+{
+    const guint64 *id = NULL;
+
+    if (!g_reminder_item_get_id (item))
+        id = g_hash_table_lookup (priv->legacy_ids, g_reminder_item_get_checksum (item));
+
+    if (!id)
+        return g_object_ref ((GReminderItem *) item);
+
+    return g_reminder_item_new (*id, g_reminder_item_get_keywords (item), g_reminder_item_get_contents (item));
+}
+
+/* Whether an item lives in the current layout rather than in the legacy one */
+static gboolean
+g_reminder_db_private_has_item (GReminderDbPrivate  *priv,
+                                const GReminderItem *item)
+{
+    guint64 id = g_reminder_item_get_id (item);
+
+    if (!id)
+        return FALSE;
+    if (!priv->migrating)
+        return TRUE;
+
+    G_REMINDER_CLEANUP_STRING_FREE GString *key = g_reminder_db_key_item (id);
+    G_REMINDER_CLEANUP_FREE gchar *err = NULL;
+    size_t len;
+    gchar *value = leveldb_get (priv->db, priv->roptions, key->str, key->len, &len, &err);
+
+    leveldb_free (value);
+    return !!value;
+}
+
+/*
+ * New items get their id on the caller's thread, before the write is handed
+ * over to a worker: the caller can then keep using the item without racing
+ * with the write. Items loaded from the legacy layout get the id the
+ * migration gave them, if it moved them already.
+ */
+static void
+g_reminder_db_private_prepare (GReminderDbPrivate  *priv,
+                               const GReminderItem *old,
+                               GReminderItem       *item)
+{
+    if (g_reminder_item_get_id (item))
+        return;
+
+    g_mutex_lock (&priv->write_lock);
+    const guint64 *id = (old) ? g_hash_table_lookup (priv->legacy_ids, g_reminder_item_get_checksum (old)) : NULL;
+    g_reminder_item_set_id (item, (id) ? *id : priv->next_id++);
+    g_mutex_unlock (&priv->write_lock);
+}
+
+static gboolean
+g_reminder_db_private_save (GReminderDbPrivate *priv,
+                            GReminderItem      *item)
+{
+    G_REMINDER_CLEANUP_BATCH_FREE GReminderDbBatch *batch = g_reminder_db_batch_new ();
+    guint64 seq;
+
+    g_mutex_lock (&priv->write_lock);
+    g_reminder_db_private_assign_id (priv, batch, item);
+    g_reminder_db_private_save_item (batch, item);
+    gboolean ok = g_reminder_db_private_write (priv, batch, &seq);
+    g_mutex_unlock (&priv->write_lock);
+
+    return ok && g_reminder_db_private_wait_durable (priv, seq);
+}
+
+static gboolean
+g_reminder_db_private_update (GReminderDbPrivate  *priv,
+                              const GReminderItem *old,
+                              GReminderItem       *item)
+{
+    G_REMINDER_CLEANUP_BATCH_FREE GReminderDbBatch *batch = g_reminder_db_batch_new ();
+    guint64 seq;
+
+    g_mutex_lock (&priv->write_lock);
+    batch->folding = priv->folding;
+    G_REMINDER_CLEANUP_UNREF GReminderItem *_old = g_reminder_db_private_resolve_legacy (priv, old);
+
+    if (!g_reminder_db_private_has_item (priv, _old))
+    {
+        /* The old version still lives in the legacy layout, move it over as a whole */
+        g_reminder_db_legacy_delete_item (batch->batch, old);
+        g_reminder_db_private_assign_id (priv, batch, item);
+        g_reminder_db_private_save_item (batch, item);
+    }
+    else if (g_reminder_item_get_id (_old) != g_reminder_item_get_id (item))
+    {
+        /* The migration moved the old version after the new one got its id */
+        g_reminder_db_private_delete_item (batch, _old);
+        g_reminder_db_private_assign_id (priv, batch, item);
+        g_reminder_db_private_save_item (batch, item);
+    }
+    else
+        g_reminder_db_private_update_item (batch, _old, item);
+
+    gboolean ok = g_reminder_db_private_write (priv, batch, &seq);
+    g_mutex_unlock (&priv->write_lock);
+
+    return ok && g_reminder_db_private_wait_durable (priv, seq);
+}
+
+static gboolean
+g_reminder_db_private_delete (GReminderDbPrivate  *priv,
+                              const GReminderItem *item)
+{
+    G_REMINDER_CLEANUP_BATCH_FREE GReminderDbBatch *batch = g_reminder_db_batch_new ();
+    guint64 seq;
+
+    g_mutex_lock (&priv->write_lock);
+    batch->folding = priv->folding;
+    G_REMINDER_CLEANUP_UNREF GReminderItem *_item = g_reminder_db_private_resolve_legacy (priv, item);
+
+    if (g_reminder_db_private_has_item (priv, _item))
+        g_reminder_db_private_delete_item (batch, _item);
+    else
+        g_reminder_db_legacy_delete_item (batch->batch, item);
+
+    gboolean ok = g_reminder_db_private_write (priv, batch, &seq);
+    g_mutex_unlock (&priv->write_lock);
+
+    return ok && g_reminder_db_private_wait_durable (priv, seq);
+}
+
+G_REMINDER_VISIBLE gboolean
+g_reminder_db_save (const GReminderDb *self,
+                    GReminderItem     *item)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB (self), FALSE);
+    g_return_val_if_fail (G_REMINDER_IS_ITEM (item), FALSE);
+
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
+
+    return g_reminder_db_private_save (priv, item);
+}
+
+G_REMINDER_VISIBLE gboolean
+g_reminder_db_update (const GReminderDb   *self,
+                      const GReminderItem *old,
+                      GReminderItem       *item)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB (self), FALSE);
+    g_return_val_if_fail (G_REMINDER_IS_ITEM (old), FALSE);
+    g_return_val_if_fail (G_REMINDER_IS_ITEM (item), FALSE);
+    g_return_val_if_fail (g_reminder_item_get_id (old) == g_reminder_item_get_id (item), FALSE);
+
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
+
+    g_reminder_db_private_prepare (priv, old, item);
+    return g_reminder_db_private_update (priv, old, item);
+}
+
+G_REMINDER_VISIBLE gboolean
+g_reminder_db_delete (const GReminderDb   *self,
+                      const GReminderItem *item)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB (self), FALSE);
+    g_return_val_if_fail (G_REMINDER_IS_ITEM (item), FALSE);
+
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
+
+    return g_reminder_db_private_delete (priv, item);
+}
+
+static gboolean
+g_reminder_db_private_scan_in_parallel (GReminderDbPrivate *priv,
+                                        guint64             count,
+                                        guint64             rarest)
+{
+    return priv->scan_pool && count >= G_REMINDER_DB_SCAN_MIN && count / G_REMINDER_DB_SCAN_SKEW <= rarest;
+}
+
+/*
+ * Bitmap of a frequent keyword, built from its blocks on first use and
+ * counted from it from then on. Builds read the query's snapshot, so that
+ * the bitmap matches the rest of what the query reads, and are only cached
+ * if that snapshot is the latest: the writes that follow keep it up to date.
+ */
+static GReminderDbBitmap *
+g_reminder_db_private_get_bitmap (GReminderDbPrivate  *priv,
+                                  GReminderDbSnapshot *snapshot,
+                                  const gchar         *keyword,
+                                  guint64             *count)
+{
+    GReminderDbBitmap *bitmap = g_reminder_db_bitmap_cache_lookup (priv->bitmap_cache, keyword, snapshot->version);
+
+    if (bitmap)
+    {
+        *count = g_reminder_db_bitmap_get_cardinality (bitmap);
+        return bitmap;
+    }
+
+    *count = g_reminder_db_private_get_keyword_count (priv, snapshot->roptions, keyword);
+    if (*count < G_REMINDER_DB_BITMAP_MIN)
+        return NULL;
+
+    /* Built from the query's own snapshot, it only gets cached if nothing got written since */
+    G_REMINDER_CLEANUP_POSTING_FREE GReminderDbPosting *posting = g_reminder_db_posting_new_term (snapshot, keyword, *count);
+
+    bitmap = g_reminder_db_bitmap_new ();
+    for (; !posting->done; g_reminder_db_posting_next (posting))
+        g_reminder_db_bitmap_add (bitmap, posting->id);
+    g_reminder_db_bitmap_cache_insert (priv->bitmap_cache, keyword, g_reminder_db_bitmap_ref (bitmap), snapshot->version);
+
+    return bitmap;
+}
+
+/*
+ * Operand of a query being planned: the bitmap of frequent keywords, a
+ * posting, or a term whose posting is only opened once its siblings are
+ * known. Nothing set means no match.
+ */
+typedef struct
+{
+    GReminderDbBitmap  *bitmap;
+    GReminderDbPosting *posting;
+    const gchar        *term;
+    guint64             estimate;
+} GReminderDbOperand;
+
+typedef struct
+{
+    GReminderDbPrivate  *priv;
+    GReminderDbSnapshot *snapshot;
+    gboolean             forward;
+    /* Told about every term looked up, if set */
+    GReminderDbExplain  *explain;
+} GReminderDbPlan;
+
+static void
+g_reminder_db_operand_clear (gpointer data)
+{
+    GReminderDbOperand *operand = data;
+
+    g_clear_pointer (&operand->bitmap, g_reminder_db_bitmap_unref);
+    g_clear_pointer (&operand->posting, g_reminder_db_posting_free);
+    operand->term = NULL;
+}
+
+static gboolean
+g_reminder_db_operand_is_empty (const GReminderDbOperand *operand)
+{
+    return !operand->bitmap && !operand->posting && !operand->term;
+}
+
+static GArray *
+g_reminder_db_operands_new (void)
+{
+    GArray *operands = g_array_new (FALSE, FALSE, sizeof (GReminderDbOperand));
+    g_array_set_clear_func (operands, g_reminder_db_operand_clear);
+    return operands;
+}
+
+/*
+ * Turns a non empty operand into a posting. With forward set, which has to
+ * be read before the snapshot gets taken, the postings not repacked yet are
+ * read along with the blocks.
+ */
+static GReminderDbPosting *
+g_reminder_db_plan_open (GReminderDbPlan    *plan,
+                         GReminderDbOperand *operand,
+                         gboolean            scan)
+{
+    GReminderDbPosting *posting = operand->posting;
+
+    if (operand->bitmap)
+        posting = g_reminder_db_posting_new_bitmap (operand->bitmap);
+    else if (!posting && plan->forward)
+    {
+        GPtrArray *layouts = g_ptr_array_new_with_free_func ((GDestroyNotify) g_reminder_db_posting_free);
+        g_ptr_array_add (layouts, g_reminder_db_posting_new_term (plan->snapshot, operand->term, operand->estimate));
+        g_ptr_array_add (layouts, g_reminder_db_posting_new_forward (plan->snapshot, operand->term, operand->estimate));
+        posting = g_reminder_db_posting_new_or (layouts);
+    }
+    else if (!posting && scan)
+        posting = g_reminder_db_posting_new_scan (plan->priv->scan_pool, plan->snapshot, operand->term, operand->estimate);
+    else if (!posting)
+        posting = g_reminder_db_posting_new_term (plan->snapshot, operand->term, operand->estimate);
+
+    operand->bitmap = NULL;
+    operand->posting = NULL;
+    operand->term = NULL;
+
+    return posting;
+}
+
+static void g_reminder_db_plan_node (GReminderDbPlan        *plan,
+                                     const GReminderDbQuery *node,
+                                     GReminderDbOperand     *operand);
+
+/* Terms are looked up in the dictionary first, their counts drive the plan */
+static void
+g_reminder_db_plan_term (GReminderDbPlan    *plan,
+                         const gchar        *keyword,
+                         GReminderDbOperand *operand)
+{
+    GReminderDbPrivate *priv = plan->priv;
+
+    if (priv->bitmap_cache && !plan->forward)
+        operand->bitmap = g_reminder_db_private_get_bitmap (priv, plan->snapshot, keyword, &operand->estimate);
+    else
+        operand->estimate = g_reminder_db_private_get_keyword_count (priv, plan->snapshot->roptions, keyword);
+
+    if (!operand->estimate)
+        g_clear_pointer (&operand->bitmap, g_reminder_db_bitmap_unref);
+    else if (!operand->bitmap)
+        operand->term = keyword;
+
+    if (plan->explain)
+    {
+        G_REMINDER_CLEANUP_FREE gchar *term = g_reminder_db_text_to_string (keyword);
+        g_reminder_db_explain_add_term (plan->explain, term, operand->estimate, (operand->bitmap) ? "bitmap" : (operand->term) ? "blocks" : "none");
+    }
+}
+
+/* Takes ownership of the operands, bitmaps are merged in memory and the rest streamed */
+static void
+g_reminder_db_plan_union (GReminderDbPlan    *plan,
+                          GArray             *operands,
+                          GReminderDbOperand *operand)
+{
+    GPtrArray *postings = g_ptr_array_new_with_free_func ((GDestroyNotify) g_reminder_db_posting_free);
+    GReminderDbBitmap *bitmap = NULL;
+
+    for (guint i = 0; i < operands->len; ++i)
+    {
+        GReminderDbOperand *child = &g_array_index (operands, GReminderDbOperand, i);
+
+        if (child->bitmap)
+        {
+            GReminderDbBitmap *either = (bitmap) ? g_reminder_db_bitmap_or (bitmap, child->bitmap) : g_reminder_db_bitmap_ref (child->bitmap);
+            g_clear_pointer (&bitmap, g_reminder_db_bitmap_unref);
+            bitmap = either;
+        }
+        else if (!g_reminder_db_operand_is_empty (child))
+            g_ptr_array_add (postings, g_reminder_db_plan_open (plan, child, FALSE));
+    }
+    g_array_unref (operands);
+
+    if (!postings->len)
+    {
+        g_ptr_array_unref (postings);
+        operand->bitmap = bitmap;
+        operand->estimate = (bitmap) ? g_reminder_db_bitmap_get_cardinality (bitmap) : 0;
+        return;
+    }
+
+    if (bitmap)
+        g_ptr_array_add (postings, g_reminder_db_posting_new_bitmap (bitmap));
+    operand->posting = g_reminder_db_posting_new_or (postings);
+    operand->estimate = operand->posting->estimate;
+}
+
+/*
+ * Prefixes stand for the union of every keyword of the dictionary they
+ * start, up to G_REMINDER_DB_PREFIX_MAX_TERMS of them in dictionary order.
+ * A few get merged like any other union, many get their blocks read in a
+ * single pass over the range they span, see g_reminder_db_posting_read_range.
+ */
+static void
+g_reminder_db_plan_prefix (GReminderDbPlan    *plan,
+                           const gchar        *prefix,
+                           GReminderDbOperand *operand)
+{
+    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = leveldb_create_iterator (plan->priv->db, plan->snapshot->scan_roptions);
+    G_REMINDER_CLEANUP_STRING_FREE GString *key_prefix = g_reminder_db_key_keyword (prefix);
+    gsize skip = key_prefix->len - strlen (prefix);
+    GPtrArray *keywords = g_ptr_array_new_with_free_func (g_free);
+    gboolean truncated = FALSE;
+    guint64 count = 0;
+
+    for (leveldb_iter_seek (it, key_prefix->str, key_prefix->len); g_reminder_db_iter_has_prefix (it, key_prefix); leveldb_iter_next (it))
+    {
+        size_t klen, vlen;
+        const gchar *key = leveldb_iter_key (it, &klen);
+        const gchar *value = leveldb_iter_value (it, &vlen);
+        guint64 n = 0;
+
+        if (keywords->len == G_REMINDER_DB_PREFIX_MAX_TERMS)
+        {
+            truncated = TRUE;
+            break;
+        }
+
+        g_reminder_db_varint_read (&value, value + vlen, &n);
+        g_ptr_array_add (keywords, g_reminder_db_strndup (key + skip, klen - skip));
+        count += n;
+    }
+
+    /* The results are incomplete, explain reports it along with the terms */
+    if (truncated)
+    {
+        G_REMINDER_CLEANUP_FREE gchar *term = g_reminder_db_text_to_string (prefix);
+        G_REMINDER_CLEANUP_FREE gchar *cut = g_strdup_printf ("%s*", term);
+
+        g_message ("%s matches more than %d keywords, only the first ones are searched", cut, G_REMINDER_DB_PREFIX_MAX_TERMS);
+        if (plan->explain)
+            g_reminder_db_explain_add_term (plan->explain, cut, count, "truncated");
+    }
+
+    /* The schema 2 postings are not part of the range */
+    if (keywords->len > G_REMINDER_DB_PREFIX_MERGE_MAX && !plan->forward)
+    {
+        operand->bitmap = g_reminder_db_posting_read_range (plan->snapshot, g_ptr_array_index (keywords, 0), g_ptr_array_index (keywords, keywords->len - 1));
+        operand->estimate = g_reminder_db_bitmap_get_cardinality (operand->bitmap);
+        if (!operand->estimate)
+            g_clear_pointer (&operand->bitmap, g_reminder_db_bitmap_unref);
+
+        if (plan->explain)
+        {
+            G_REMINDER_CLEANUP_FREE gchar *term = g_reminder_db_text_to_string (prefix);
+            G_REMINDER_CLEANUP_FREE gchar *range = g_strdup_printf ("%s*", term);
+            g_reminder_db_explain_add_term (plan->explain, range, count, "range");
+        }
+        g_ptr_array_unref (keywords);
+        return;
+    }
+
+    GArray *operands = g_reminder_db_operands_new ();
+    for (guint i = 0; i < keywords->len; ++i)
+    {
+        GReminderDbOperand child = { 0 };
+
+        g_reminder_db_plan_term (plan, g_ptr_array_index (keywords, i), &child);
+        /* The keyword does not outlive the planning of the prefix */
+        if (child.term)
+            child.posting = g_reminder_db_plan_open (plan, &child, FALSE);
+        if (!g_reminder_db_operand_is_empty (&child))
+            g_array_append_val (operands, child);
+    }
+    g_ptr_array_unref (keywords);
+
+    g_reminder_db_plan_union (plan, operands, operand);
+}
+
+/*
+ * Ands start with the operands matching nothing, which short-circuit the
+ * whole of them, then intersect the bitmaps of frequent terms in memory
+ * and join the rest, driven by the rarest one. Negated operands are only
+ * checked against the ids that got through.
+ */
+static void
+g_reminder_db_plan_and (GReminderDbPlan        *plan,
+                        const GReminderDbQuery *node,
+                        GReminderDbOperand     *operand)
+{
+    G_REMINDER_CLEANUP_ARRAY_UNREF GArray *positives = g_reminder_db_operands_new ();
+    GArray *negatives = g_reminder_db_operands_new ();
+    G_REMINDER_CLEANUP_BITMAP_UNREF GReminderDbBitmap *matches = NULL;
+    guint64 rarest = G_MAXUINT64;
+    guint parallel = 0;
+
+    for (guint i = 0; i < node->children->len; ++i)
+    {
+        const GReminderDbQuery *child = g_ptr_array_index (node->children, i);
+        GReminderDbOperand planned = { 0 };
+
+        if (child->kind == G_REMINDER_DB_QUERY_NOT)
+        {
+            g_reminder_db_plan_node (plan, g_ptr_array_index (child->children, 0), &planned);
+            if (!g_reminder_db_operand_is_empty (&planned))
+                g_array_append_val (negatives, planned);
+            continue;
+        }
+
+        g_reminder_db_plan_node (plan, child, &planned);
+        if (g_reminder_db_operand_is_empty (&planned))
+        {
+            g_array_unref (negatives);
+            return;
+        }
+        g_array_append_val (positives, planned);
+    }
+
+    for (guint i = 0; i < positives->len; ++i)
+    {
+        GReminderDbOperand *child = &g_array_index (positives, GReminderDbOperand, i);
+
+        if (child->bitmap)
+        {
+            GReminderDbBitmap *both = (matches) ? g_reminder_db_bitmap_and (matches, child->bitmap) : g_reminder_db_bitmap_ref (child->bitmap);
+            g_clear_pointer (&matches, g_reminder_db_bitmap_unref);
+            matches = both;
+            g_reminder_db_operand_clear (child);
+        }
+    }
+
+    for (guint i = 0; matches && i < negatives->len; ++i)
+    {
+        GReminderDbOperand *child = &g_array_index (negatives, GReminderDbOperand, i);
+
+        if (child->bitmap)
+        {
+            GReminderDbBitmap *left = g_reminder_db_bitmap_andnot (matches, child->bitmap);
+            g_reminder_db_bitmap_unref (matches);
+            matches = left;
+            g_reminder_db_operand_clear (child);
+        }
+    }
+
+    if (matches && !g_reminder_db_bitmap_get_cardinality (matches))
+    {
+        g_array_unref (negatives);
+        return;
+    }
+
+    GReminderDbOperand excluded = { 0 };
+    g_reminder_db_plan_union (plan, negatives, &excluded);
+
+    for (guint i = 0; i < positives->len; ++i)
+    {
+        GReminderDbOperand *child = &g_array_index (positives, GReminderDbOperand, i);
+        if (!g_reminder_db_operand_is_empty (child))
+            rarest = MIN (rarest, child->estimate);
+    }
+
+    /* Only bitmaps, the result stays one */
+    if (matches && rarest == G_MAXUINT64 && g_reminder_db_operand_is_empty (&excluded))
+    {
+        operand->estimate = g_reminder_db_bitmap_get_cardinality (matches);
+        operand->bitmap = matches;
+        matches = NULL;
+        return;
+    }
+
+    GPtrArray *postings = g_ptr_array_new_with_free_func ((GDestroyNotify) g_reminder_db_posting_free);
+    if (matches)
+    {
+        rarest = MIN (rarest, g_reminder_db_bitmap_get_cardinality (matches));
+        g_ptr_array_add (postings, g_reminder_db_posting_new_bitmap (matches));
+        matches = NULL;
+    }
+    for (guint i = 0; i < positives->len && !plan->forward; ++i)
+    {
+        GReminderDbOperand *child = &g_array_index (positives, GReminderDbOperand, i);
+        if (child->term && g_reminder_db_private_scan_in_parallel (plan->priv, child->estimate, rarest))
+            ++parallel;
+    }
+
+    for (guint i = 0; i < positives->len; ++i)
+    {
+        GReminderDbOperand *child = &g_array_index (positives, GReminderDbOperand, i);
+
+        if (g_reminder_db_operand_is_empty (child))
+            continue;
+        /* A lone long term is better left to seeks from the others */
+        gboolean scan = !plan->forward && child->term && parallel > 1 && g_reminder_db_private_scan_in_parallel (plan->priv, child->estimate, rarest);
+        g_ptr_array_add (postings, g_reminder_db_plan_open (plan, child, scan));
+    }
+
+    GReminderDbPosting *posting = g_reminder_db_posting_new_and (postings);
+    if (!g_reminder_db_operand_is_empty (&excluded))
+        posting = g_reminder_db_posting_new_andnot (posting, g_reminder_db_plan_open (plan, &excluded, FALSE));
+
+    operand->posting = posting;
+    operand->estimate = posting->estimate;
+}
+
+static void
+g_reminder_db_plan_node (GReminderDbPlan        *plan,
+                         const GReminderDbQuery *node,
+                         GReminderDbOperand     *operand)
+{
+    switch (node->kind)
+    {
+    case G_REMINDER_DB_QUERY_TERM:
+        g_reminder_db_plan_term (plan, node->term, operand);
+        break;
+    case G_REMINDER_DB_QUERY_PREFIX:
+        g_reminder_db_plan_prefix (plan, node->term, operand);
+        break;
+    case G_REMINDER_DB_QUERY_AND:
+        g_reminder_db_plan_and (plan, node, operand);
+        break;
+    case G_REMINDER_DB_QUERY_OR:
+    {
+        GArray *operands = g_reminder_db_operands_new ();
+
+        for (guint i = 0; i < node->children->len; ++i)
+        {
+            GReminderDbOperand child = { 0 };
+
+            g_reminder_db_plan_node (plan, g_ptr_array_index (node->children, i), &child);
+            if (!g_reminder_db_operand_is_empty (&child))
+                g_array_append_val (operands, child);
+        }
+        g_reminder_db_plan_union (plan, operands, operand);
+        break;
+    }
+    case G_REMINDER_DB_QUERY_NOT:
+        /* Parsing only lets negations through as operands of ands */
+        g_return_if_reached ();
+    }
+}
+
+/*
+ * Terms missing from the dictionary are taken for typos of the closest
+ * keyword, the most frequent one on ties, see greminder-db-fuzzy.h.
+ * Negated terms and prefixes are left alone, and so is everything while
+ * the legacy layout may still hold keywords the dictionary does not know,
+ * or the dictionary keywords not folded yet.
+ * Returns whether the results depend on keywords the query does not name,
+ * so must not be cached: some term got replaced, or is missing and would
+ * be as soon as a close enough keyword gets saved.
+ */
+static gboolean
+g_reminder_db_private_correct (GReminderDbPrivate  *priv,
+                               GReminderDbSnapshot *snapshot,
+                               GReminderDbQuery    *query,
+                               GReminderDbExplain  *explain)
+{
+    gboolean corrected = FALSE;
+
+    switch (query->kind)
+    {
+    case G_REMINDER_DB_QUERY_TERM:
+    {
+        guint max_edits = g_reminder_db_fuzzy_get_max_edits (query->term);
+
+        if (!max_edits || g_reminder_db_private_get_keyword_count (priv, snapshot->roptions, query->term))
+            break;
+
+        /* Writes only invalidate the keywords they touch, never the typos of them */
+        corrected = TRUE;
+        if (g_atomic_int_get (&priv->migrating) || g_atomic_int_get (&priv->folding))
+            break;
+
+        G_REMINDER_CLEANUP_ARRAY_UNREF GArray *matches = g_reminder_db_fuzzy_lookup (snapshot, query->term, max_edits);
+        if (!matches->len)
+            break;
+
+        if (explain)
+        {
+            G_REMINDER_CLEANUP_FREE gchar *term = g_reminder_db_text_to_string (query->term);
+            g_reminder_db_explain_add_term (explain, term, 0, "fuzzy");
+        }
+
+        GReminderDbFuzzyMatch *best = &g_array_index (matches, GReminderDbFuzzyMatch, 0);
+        g_free (query->term);
+        query->term = best->keyword;
+        best->keyword = NULL;
+        break;
+    }
+    case G_REMINDER_DB_QUERY_AND:
+    case G_REMINDER_DB_QUERY_OR:
+        for (guint i = 0; i < query->children->len; ++i)
+            corrected |= g_reminder_db_private_correct (priv, snapshot, g_ptr_array_index (query->children, i), explain);
+        break;
+    case G_REMINDER_DB_QUERY_PREFIX:
+    case G_REMINDER_DB_QUERY_NOT:
+        break;
+    }
+
+    return corrected;
+}
+
+/* Returns NULL when nothing matches the query */
+static GReminderDbPosting *
+g_reminder_db_private_find (GReminderDbPrivate     *priv,
+                            GReminderDbSnapshot    *snapshot,
+                            const GReminderDbQuery *query,
+                            gboolean                forward,
+                            GReminderDbExplain     *explain)
+{
+    GReminderDbPlan plan = { priv, snapshot, forward, explain };
+    GReminderDbOperand operand = { 0 };
+
+    g_reminder_db_plan_node (&plan, query, &operand);
+    if (g_reminder_db_operand_is_empty (&operand))
+        return NULL;
+
+    return g_reminder_db_plan_open (&plan, &operand, FALSE);
+}
+
+/* Items get scored on the terms of the query that are not negated */
+static void
+g_reminder_db_plan_rank (GReminderDbPlan        *plan,
+                         const GReminderDbQuery *node,
+                         GReminderDbRank        *rank)
+{
+    switch (node->kind)
+    {
+    case G_REMINDER_DB_QUERY_TERM:
+    case G_REMINDER_DB_QUERY_PREFIX:
+    {
+        GReminderDbOperand operand = { 0 };
+
+        g_reminder_db_plan_node (plan, node, &operand);
+        if (g_reminder_db_operand_is_empty (&operand))
+            break;
+
+        guint64 count = operand.estimate;
+        gdouble boost = (g_reminder_db_text_is_term (node->term)) ? G_REMINDER_DB_RANK_TEXT_BOOST : G_REMINDER_DB_RANK_KEYWORD_BOOST;
+        g_reminder_db_rank_add_term (rank, g_reminder_db_plan_open (plan, &operand, FALSE), count, boost);
+        break;
+    }
+    case G_REMINDER_DB_QUERY_AND:
+    case G_REMINDER_DB_QUERY_OR:
+        for (guint i = 0; i < node->children->len; ++i)
+            g_reminder_db_plan_rank (plan, g_ptr_array_index (node->children, i), rank);
+        break;
+    case G_REMINDER_DB_QUERY_NOT:
+        break;
+    }
+}
+
+static gint
+g_reminder_db_rank_position_cmp (gconstpointer a,
+                                 gconstpointer b,
+                                 gpointer      user_data)
+{
+    guint64 x = g_reminder_item_get_id (a);
+    guint64 y = g_reminder_item_get_id (b);
+    gint i = GPOINTER_TO_INT (g_hash_table_lookup (user_data, &x));
+    gint j = GPOINTER_TO_INT (g_hash_table_lookup (user_data, &y));
+
+    return (i > j) - (i < j);
+}
+
+/*
+ * Load the best SearchResults items matching posting, best first. Only
+ * those get read from the db. Takes ownership of the posting.
+ */
+static GSList *
+g_reminder_db_private_rank (GReminderDbPrivate     *priv,
+                            GReminderDbSnapshot    *snapshot,
+                            const GReminderDbQuery *query,
+                            gboolean                forward,
+                            GReminderDbPosting     *posting,
+                            GCancellable           *cancellable)
+{
+    G_REMINDER_CLEANUP_POSTING_FREE GReminderDbPosting *match = posting;
+    guint64 items = g_reminder_db_private_get_total (priv, snapshot->roptions, "rank-items");
+    guint64 length = g_reminder_db_private_get_total (priv, snapshot->roptions, "rank-length");
+    G_REMINDER_CLEANUP_RANK_FREE GReminderDbRank *rank = g_reminder_db_rank_new (snapshot, items, length);
+    GReminderDbPlan plan = { priv, snapshot, forward, NULL };
+
+    g_reminder_db_plan_rank (&plan, query, rank);
+
+    G_REMINDER_CLEANUP_ARRAY_UNREF GArray *top = g_reminder_db_rank_top (rank, match, priv->search_results, cancellable);
+    G_REMINDER_CLEANUP_ARRAY_UNREF GArray *ids = g_array_sized_new (FALSE, FALSE, sizeof (guint64), top->len);
+    GHashTable *positions = g_hash_table_new (g_int64_hash, g_int64_equal);
+
+    /* Loading sorts the ids, top keeps the ranking */
+    g_array_append_vals (ids, top->data, top->len);
+    for (guint i = 0; i < top->len; ++i)
+        g_hash_table_insert (positions, &g_array_index (top, guint64, i), GINT_TO_POINTER (i));
+
+    GSList *ranked = g_slist_sort_with_data (g_reminder_db_snapshot_get_items (snapshot, ids, cancellable), g_reminder_db_rank_position_cmp, positions);
+    g_hash_table_unref (positions);
+
+    return ranked;
+}
+
+/* Takes ownership of the ids, NULL if there are none */
+static GReminderDbPosting *
+g_reminder_db_private_ids_posting (GArray *ids)
+{
+    GReminderDbBitmap *bitmap = (ids->len) ? g_reminder_db_bitmap_new () : NULL;
+
+    for (guint i = 0; i < ids->len; ++i)
+        g_reminder_db_bitmap_add (bitmap, g_array_index (ids, guint64, i));
+    g_array_unref (ids);
+
+    return (bitmap) ? g_reminder_db_posting_new_bitmap (bitmap) : NULL;
+}
+
+static GSList *
+g_reminder_db_private_find_items (GReminderDbPrivate  *priv,
+                                  const gchar         *keywords,
+                                  GCancellable        *cancellable,
+                                  GError             **error)
+{
+    G_REMINDER_CLEANUP_QUERY_FREE GReminderDbQuery *query = g_reminder_db_query_parse (keywords, error);
+
+    if (!query)
+        return NULL;
+
+    /*
+     * The legacy part of the results is not indexed by id, and no write
+     * tells which prefixes it touches: neither is ever cached.
+     */
+    gboolean cached = priv->query_cache && !g_atomic_int_get (&priv->migrating) && !g_reminder_db_query_has_prefix (query);
+    G_REMINDER_CLEANUP_FREE gchar *key = (cached) ? g_reminder_db_query_to_string (query) : NULL;
+    guint64 stamp = (cached) ? g_reminder_db_query_cache_stamp (priv->query_cache) : 0;
+    GArray *ids = (cached) ? g_reminder_db_query_cache_lookup (priv->query_cache, key) : NULL;
+    gboolean forward = g_atomic_int_get (&priv->repacking);
+
+    /* The index and the records are read as of the same point in time */
+    G_REMINDER_CLEANUP_SNAPSHOT_UNREF GReminderDbSnapshot *snapshot = g_reminder_db_snapshot_new (priv->db, priv->item_cache, priv->bitmap_cache);
+    GReminderDbPosting *posting = NULL;
+    GSList *items = NULL;
+
+    if (!ids)
+    {
+        /* Corrected results, or ones a correction may soon change, also depend on keywords the query does not name */
+        if (g_reminder_db_private_correct (priv, snapshot, query, NULL))
+            cached = FALSE;
+        posting = g_reminder_db_private_find (priv, snapshot, query, forward, NULL);
+
+        /* Caching takes every match, uncached searches can skip the ones that cannot rank */
+        if (cached)
+        {
+            G_REMINDER_CLEANUP_STRFREEV gchar **terms = g_reminder_db_query_get_terms (query);
+
+            ids = (posting) ? g_reminder_db_posting_collect (posting) : g_array_new (FALSE, FALSE, sizeof (guint64));
+            g_reminder_db_query_cache_insert (priv->query_cache, key, terms, stamp, ids);
+            g_clear_pointer (&posting, g_reminder_db_posting_free);
+        }
+    }
+
+    if (ids)
+        posting = g_reminder_db_private_ids_posting (ids);
+    if (posting)
+        items = g_reminder_db_private_rank (priv, snapshot, query, forward, posting, cancellable);
+
+    /* The legacy layout only answers plain lists of keywords */
+    if (g_atomic_int_get (&priv->migrating) && !g_cancellable_is_cancelled (cancellable))
+    {
+        G_REMINDER_CLEANUP_STRFREEV gchar **legacy = g_reminder_db_query_get_conjunction (query);
+        if (legacy)
+            items = g_slist_concat (items, g_reminder_db_legacy_find (priv->db, snapshot->scan_roptions, legacy));
+    }
+
+    return items;
+}
+
+G_REMINDER_VISIBLE void
+g_reminder_db_get_query_cache_stats (const GReminderDb *self,
+                                     guint64           *hits,
+                                     guint64           *misses)
+{
+    g_return_if_fail (G_REMINDER_IS_DB (self));
+
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
+
+    if (hits)
+        *hits = 0;
+    if (misses)
+        *misses = 0;
+    if (priv->query_cache)
+        g_reminder_db_query_cache_get_stats (priv->query_cache, hits, misses);
+}
+
+G_REMINDER_VISIBLE GReminderDbCursor *
+g_reminder_db_find_cursor (const GReminderDb *self,
+                           const gchar       *keywords)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB (self), NULL);
+    g_return_val_if_fail (keywords, NULL);
+
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
+    G_REMINDER_CLEANUP_QUERY_FREE GReminderDbQuery *query = g_reminder_db_query_parse (keywords, NULL);
+    gboolean forward = g_atomic_int_get (&priv->repacking);
+    G_REMINDER_CLEANUP_SNAPSHOT_UNREF GReminderDbSnapshot *snapshot = g_reminder_db_snapshot_new (priv->db, priv->item_cache, priv->bitmap_cache);
+
+    if (query)
+        g_reminder_db_private_correct (priv, snapshot, query, NULL);
+
+    GReminderDbPosting *posting = (query) ? g_reminder_db_private_find (priv, snapshot, query, forward, NULL) : NULL;
+    G_REMINDER_CLEANUP_STRFREEV gchar **legacy = (query && g_atomic_int_get (&priv->migrating)) ? g_reminder_db_query_get_conjunction (query) : NULL;
+
+    return g_reminder_db_cursor_new (G_OBJECT (self), snapshot, posting, legacy);
+}
+
+static void
+g_reminder_db_explain_describe (GReminderDbExplain *explain,
+                                GReminderDbPosting *posting)
+{
+    GString *plan = g_string_new (NULL);
+
+    g_reminder_db_posting_describe (posting, plan, 1);
+    g_reminder_db_explain_set_plan (explain, g_string_free (plan, FALSE));
+}
+
+static void
+g_reminder_db_explain_lap (GReminderDbExplain      *explain,
+                           GReminderDbExplainStage  stage,
+                           gint64                  *start)
+{
+    gint64 now = g_get_monotonic_time ();
+
+    g_reminder_db_explain_add_time (explain, stage, now - *start);
+    *start = now;
+}
+
+/*
+ * Analyzed searches are run like g_reminder_db_find runs them, except that
+ * the query cache is only checked, so that what is measured is the plan.
+ * The legacy layout a schema migration reads from is left out.
+ */
+G_REMINDER_VISIBLE GReminderDbExplain *
+g_reminder_db_explain (const GReminderDb  *self,
+                       const gchar        *keywords,
+                       gboolean            analyze,
+                       GError            **error)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB (self), NULL);
+    g_return_val_if_fail (keywords, NULL);
+
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
+    gint64 start = g_get_monotonic_time ();
+    G_REMINDER_CLEANUP_QUERY_FREE GReminderDbQuery *query = g_reminder_db_query_parse (keywords, error);
+
+    if (!query)
+        return NULL;
+
+    G_REMINDER_CLEANUP_FREE gchar *key = g_reminder_db_query_to_string (query);
+    GReminderDbExplain *explain = g_reminder_db_explain_new (key, analyze);
+    g_reminder_db_explain_lap (explain, G_REMINDER_DB_EXPLAIN_PARSE, &start);
+
+    gboolean forward = g_atomic_int_get (&priv->repacking);
+    G_REMINDER_CLEANUP_SNAPSHOT_UNREF GReminderDbSnapshot *snapshot = g_reminder_db_snapshot_new (priv->db, priv->item_cache, priv->bitmap_cache);
+    snapshot->stats = g_new0 (GReminderDbSnapshotStats, 1);
+    gboolean corrected = g_reminder_db_private_correct (priv, snapshot, query, explain);
+    G_REMINDER_CLEANUP_POSTING_FREE GReminderDbPosting *posting = g_reminder_db_private_find (priv, snapshot, query, forward, explain);
+    g_reminder_db_explain_lap (explain, G_REMINDER_DB_EXPLAIN_PLAN, &start);
+
+    if (!analyze)
+    {
+        if (posting)
+            g_reminder_db_explain_describe (explain, posting);
+        return explain;
+    }
+
+    if (priv->query_cache && !corrected && !g_reminder_db_query_has_prefix (query))
+        g_reminder_db_explain_set_counter (explain, G_REMINDER_DB_EXPLAIN_QUERY_CACHE_HIT, g_reminder_db_query_cache_contains (priv->query_cache, key));
+
+    GArray *ids = (posting) ? g_reminder_db_posting_collect (posting) : g_array_new (FALSE, FALSE, sizeof (guint64));
+    g_reminder_db_explain_lap (explain, G_REMINDER_DB_EXPLAIN_JOIN, &start);
+
+    g_slist_free_full (g_reminder_db_snapshot_get_items (snapshot, ids, NULL), g_object_unref);
+    g_reminder_db_explain_lap (explain, G_REMINDER_DB_EXPLAIN_LOAD, &start);
+
+    if (posting)
+        g_reminder_db_explain_describe (explain, posting);
+
+    GReminderDbSnapshotStats *stats = snapshot->stats;
+    g_reminder_db_explain_set_counter (explain, G_REMINDER_DB_EXPLAIN_MATCHES, ids->len);
+    g_reminder_db_explain_set_counter (explain, G_REMINDER_DB_EXPLAIN_KEYS, g_atomic_int_get (&stats->keys));
+    g_reminder_db_explain_set_counter (explain, G_REMINDER_DB_EXPLAIN_BLOCKS, g_atomic_int_get (&stats->blocks));
+    g_reminder_db_explain_set_counter (explain, G_REMINDER_DB_EXPLAIN_SEEKS, g_atomic_int_get (&stats->seeks));
+    g_reminder_db_explain_set_counter (explain, G_REMINDER_DB_EXPLAIN_ITEMS, g_atomic_int_get (&stats->items));
+    g_reminder_db_explain_set_counter (explain, G_REMINDER_DB_EXPLAIN_ITEM_CACHE_HITS, g_atomic_int_get (&stats->item_cache_hits));
+    g_array_unref (ids);
+
+    return explain;
+}
+
+G_REMINDER_VISIBLE GSList *
+g_reminder_db_get_items (const GReminderDb *self,
+                         const guint64     *ids,
+                         gsize              n_ids)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB (self), NULL);
+    g_return_val_if_fail (ids || !n_ids, NULL);
+
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
+    G_REMINDER_CLEANUP_SNAPSHOT_UNREF GReminderDbSnapshot *snapshot = g_reminder_db_snapshot_new (priv->db, priv->item_cache, priv->bitmap_cache);
+    GArray *sorted = g_array_sized_new (FALSE, FALSE, sizeof (guint64), n_ids);
+
+    g_array_append_vals (sorted, ids, n_ids);
+    GSList *items = g_reminder_db_snapshot_get_items (snapshot, sorted, NULL);
+    g_array_unref (sorted);
+
+    return items;
+}
+
+G_REMINDER_VISIBLE GSList *
+g_reminder_db_find (const GReminderDb *self,
+                    const gchar       *keywords)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB (self), NULL);
+
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
+
+    return g_reminder_db_private_find_items (priv, keywords, NULL, NULL);
+}
+
+typedef struct
+{
+    /* Folded, what the dictionary is sorted by */
+    gchar   *key;
+    gchar   *keyword;
+    guint64  count;
+} GReminderDbKeyword;
+
+static GReminderDbKeyword *
+g_reminder_db_keyword_new (gchar   *key,
+                           gchar   *keyword,
+                           guint64  count)
+{
+    GReminderDbKeyword *k = g_new (GReminderDbKeyword, 1);
+    k->key = key;
+    k->keyword = (keyword) ? keyword : g_strdup (key);
+    k->count = count;
+    return k;
+}
+
+static void
+g_reminder_db_keyword_free (gpointer data)
+{
+    GReminderDbKeyword *k = data;
+    g_free (k->key);
+    g_free (k->keyword);
+    g_free (k);
+}
+
+static gint
+g_reminder_db_keyword_cmp (gconstpointer a,
+                           gconstpointer b)
+{
+    return strcmp (((const GReminderDbKeyword *) a)->key, ((const GReminderDbKeyword *) b)->key);
+}
+
+static GSList *
+g_reminder_db_private_get_keywords (GReminderDbPrivate *priv)
+{
+    GSList *keywords = NULL;
+    G_REMINDER_CLEANUP_SNAPSHOT_UNREF GReminderDbSnapshot *snapshot = g_reminder_db_snapshot_new (priv->db, priv->item_cache, priv->bitmap_cache);
+    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = leveldb_create_iterator (priv->db, snapshot->scan_roptions);
+    G_REMINDER_CLEANUP_STRING_FREE GString *prefix = g_reminder_db_key_new (G_REMINDER_DB_NS_KEYWORD);
+    gboolean folding = g_atomic_int_get (&priv->folding);
+
+    for (leveldb_iter_seek (it, prefix->str, prefix->len); g_reminder_db_iter_has_prefix (it, prefix); leveldb_iter_next (it))
+    {
+        size_t klen, vlen;
+        const gchar *key = leveldb_iter_key (it, &klen);
+        const gchar *value = leveldb_iter_value (it, &vlen);
+        guint64 count;
+
+        /* Words of the contents come after every keyword */
+        if (klen > prefix->len && key[prefix->len] == G_REMINDER_DB_TEXT_MARK)
+            break;
+
+        gchar *keyword = g_reminder_db_strndup (key + prefix->len, klen - prefix->len);
+        gchar *spelling = g_reminder_db_keyword_decode (value, vlen, &count);
+
+        /* Keywords indexed as typed show as typed, under their folded form */
+        if (folding && !spelling)
+        {
+            spelling = keyword;
+            keyword = g_reminder_db_text_fold (spelling);
+        }
+        keywords = g_slist_prepend (keywords, g_reminder_db_keyword_new (keyword, spelling, count));
+    }
+    keywords = g_slist_reverse (keywords);
+
+    if (!g_atomic_int_get (&priv->migrating) && !folding)
+        return keywords;
+
+    /* Legacy keywords have no count, they get one once their items move over */
+    GSList *legacy = NULL;
+    if (g_atomic_int_get (&priv->migrating))
+    {
+        for (GSList *l = g_reminder_db_legacy_get_keywords (priv->db, snapshot->scan_roptions); l; l = g_slist_delete_link (l, l))
+            legacy = g_slist_prepend (legacy, g_reminder_db_keyword_new (g_reminder_db_text_fold (l->data), l->data, 0));
+    }
+    legacy = g_slist_sort (legacy, g_reminder_db_keyword_cmp);
+
+    /* Spellings folding alike make a single entry, the counted one first */
+    GSList *merged = NULL;
+    keywords = g_slist_sort (keywords, g_reminder_db_keyword_cmp);
+    while (keywords || legacy)
+    {
+        GSList **from = (!legacy || (keywords && g_reminder_db_keyword_cmp (keywords->data, legacy->data) <= 0)) ? &keywords : &legacy;
+        GReminderDbKeyword *k = (*from)->data;
+
+        *from = g_slist_delete_link (*from, *from);
+        if (merged && !g_reminder_db_keyword_cmp (merged->data, k))
+        {
+            ((GReminderDbKeyword *) merged->data)->count += k->count;
+            g_reminder_db_keyword_free (k);
+        }
+        else
+            merged = g_slist_prepend (merged, k);
+    }
+
+    return g_slist_reverse (merged);
+}
+
+/* Takes ownership of the keywords */
+static GtkListStore *
+g_reminder_db_keywords_to_store (GSList *keywords)
+{
+    GtkListStore *store = gtk_list_store_new (G_REMINDER_DB_KEYWORDS_N_COLUMNS, G_TYPE_STRING, G_TYPE_UINT64);
+    GtkTreeIter iter;
+
+    for (GSList *k = keywords; k; k = g_slist_next (k))
+    {
+        GReminderDbKeyword *keyword = k->data;
+        gtk_list_store_append (store, &iter);
+        gtk_list_store_set (store, &iter,
+                            G_REMINDER_DB_KEYWORDS_COLUMN_KEYWORD, keyword->keyword,
+                            G_REMINDER_DB_KEYWORDS_COLUMN_COUNT,   keyword->count,
+                            -1);
+    }
+    g_slist_free_full (keywords, g_reminder_db_keyword_free);
+
+    return store;
+}
+
+G_REMINDER_VISIBLE GtkListStore *
+g_reminder_db_get_keywords (const GReminderDb *self)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB (self), NULL);
+
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
+
+    return g_reminder_db_keywords_to_store (g_reminder_db_private_get_keywords (priv));
+}
+
+/*
+ * Move up to G_REMINDER_DB_MIGRATION_ITEMS items from the legacy layout to
+ * the current one. Each item moves atomically and the position reached is
+ * stored with it, so a migration interrupted at any point resumes where it
+ * stopped on next startup. Once every item moved, leftover legacy keys can
+ * only be orphaned index entries and get swept away.
+ */
+static gboolean
+g_reminder_db_private_migrate_step (GReminderDbPrivate *priv,
+                                    gboolean           *finished)
+{
+    G_REMINDER_CLEANUP_BATCH_FREE GReminderDbBatch *batch = g_reminder_db_batch_new ();
+    G_REMINDER_CLEANUP_FREE gchar *last = NULL;
+    GSList *moved = NULL;
+    guint items = 0;
+    guint keys = 0;
+    guint64 seq;
+
+    g_mutex_lock (&priv->write_lock);
+
+    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = leveldb_create_iterator (priv->db, priv->scan_roptions);
+    G_REMINDER_CLEANUP_FREE gchar *cursor = g_reminder_db_private_get_meta (priv, "migration-cursor");
+
+    /* An empty cursor means that every item has already been moved */
+    gboolean sweeping = (cursor && !*cursor);
+
+    if (cursor && *cursor)
+        leveldb_iter_seek (it, cursor, strlen (cursor));
+    else
+        g_reminder_db_legacy_seek_first (it);
+
+    while (leveldb_iter_valid (it) && items < G_REMINDER_DB_MIGRATION_ITEMS && keys < G_REMINDER_DB_MIGRATION_KEYS)
+    {
+        size_t len;
+        const gchar *key = leveldb_iter_key (it, &len);
+        ++keys;
+
+        if (sweeping)
+        {
+            leveldb_writebatch_delete (batch->batch, key, len);
+            leveldb_iter_next (it);
+            continue;
+        }
+
+        if (!g_reminder_db_legacy_is_item_key (key, len))
+        {
+            leveldb_iter_next (it);
+            continue;
+        }
+
+        g_free (last);
+        last = g_reminder_db_strndup (key, len);
+
+        G_REMINDER_CLEANUP_UNREF GReminderItem *item = g_reminder_db_legacy_read_item (it);
+        if (!item)
+        {
+            /* Contents no keyword leads to, nothing to move but they must not stay behind */
+            leveldb_writebatch_delete (batch->batch, last, strlen (last));
+            continue;
+        }
+
+        g_reminder_db_legacy_delete_item (batch->batch, item);
+        if (!g_reminder_item_get_id (item))
+        {
+            g_reminder_db_private_assign_id (priv, batch, item);
+            moved = g_slist_prepend (moved, g_object_ref (item));
+        }
+        g_reminder_db_private_save_item (batch, item);
+        ++items;
+    }
+
+    gboolean done = !leveldb_iter_valid (it);
+
+    if (!done)
+    {
+        if (last)
+            g_reminder_db_private_put_meta (batch, "migration-cursor", last);
+    }
+    else if (!sweeping)
+        g_reminder_db_private_put_meta (batch, "migration-cursor", "");
+    else
+    {
+        /* Postings written meanwhile are in blocks already, the repack finds nothing to do */
+        G_REMINDER_CLEANUP_FREE gchar *version = g_strdup_printf ("%d", G_REMINDER_DB_SCHEMA_FORWARD);
+        G_REMINDER_CLEANUP_FREE gchar *next_id = g_strdup_printf ("%" G_GUINT64_FORMAT, priv->next_id);
+        g_reminder_db_private_delete_meta (batch, "migration-cursor");
+        g_reminder_db_private_put_meta (batch, "next-id", next_id);
+        g_reminder_db_private_put_meta (batch, "version", version);
+        /* The id counter lived outside of any namespace in schema 1 */
+        leveldb_writebatch_delete (batch->batch, "\0next-id", sizeof ("\0next-id") - 1);
+    }
+
+    gboolean ok = g_reminder_db_private_write (priv, batch, &seq);
+
+    for (GSList *m = moved; m; m = g_slist_next (m))
+    {
+        if (ok)
+        {
+            guint64 *id = g_new (guint64, 1);
+            *id = g_reminder_item_get_id (m->data);
+            g_hash_table_insert (priv->legacy_ids, g_strdup (g_reminder_item_get_checksum (m->data)), id);
+        }
+        g_object_unref (m->data);
+    }
+    g_slist_free (moved);
+
+    g_mutex_unlock (&priv->write_lock);
+
+    if (!ok || !g_reminder_db_private_wait_durable (priv, seq))
+        return FALSE;
+
+    *finished = (done && sweeping);
+    return TRUE;
+}
+
+/*
+ * Move up to G_REMINDER_DB_MIGRATION_KEYS schema 2 postings to blocks. The
+ * keys are deleted along with the move, so each step starts over from the
+ * first one left and an interrupted repack resumes on next startup.
+ */
+static gboolean
+g_reminder_db_private_repack_step (GReminderDbPrivate *priv,
+                                   gboolean           *finished)
 {
-    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = leveldb_create_iterator (priv->db, priv->roptions);
-    GSList *items = NULL;
-    size_t len;
-    size_t klen = strlen (keyword); 
+    G_REMINDER_CLEANUP_BATCH_FREE GReminderDbBatch *batch = g_reminder_db_batch_new ();
+    G_REMINDER_CLEANUP_STRING_FREE GString *prefix = g_reminder_db_key_new (G_REMINDER_DB_NS_FORWARD);
+    guint keys = 0;
+    guint64 seq;
+
+    batch->repack = TRUE;
+
+    g_mutex_lock (&priv->write_lock);
 
-    leveldb_iter_seek (it, keyword, strlen (keyword));
-    while (leveldb_iter_valid (it))
+    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = leveldb_create_iterator (priv->db, priv->scan_roptions);
+
+    for (leveldb_iter_seek (it, prefix->str, prefix->len); g_reminder_db_iter_has_prefix (it, prefix) && keys < G_REMINDER_DB_MIGRATION_KEYS; leveldb_iter_next (it))
     {
+        size_t len;
         const gchar *key = leveldb_iter_key (it, &len);
-        if (klen != len && key[klen])
-            break;
-        if (memcmp (keyword, key, klen))
-            break;
-        items = g_slist_prepend (items, sdup (leveldb_iter_value (it, &len), &len));
-        leveldb_iter_next (it);
-    }
+        ++keys;
 
-    return items;
-}
+        leveldb_writebatch_delete (batch->batch, key, len);
+        if (len <= prefix->len + G_REMINDER_DB_ID_LEN || key[len - G_REMINDER_DB_ID_LEN - 1])
+            continue;
 
-static GReminderItem *
-g_reminder_db_private_get_item (GReminderDbPrivate *priv,
-                                const gchar        *hash)
-{
-    G_REMINDER_CLEANUP_SLIST_FREE GSList *keywords = NULL;
-    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = NULL;
-    G_REMINDER_CLEANUP_FREE gchar *err = NULL;
-    size_t hlen = strlen (hash);
-    size_t len;
-    G_REMINDER_CLEANUP_FREE gchar *contents = sdup (leveldb_get (priv->db, priv->roptions, hash, hlen, &len, &err), &len);
-    if (err)
-        return NULL;
+        G_REMINDER_CLEANUP_FREE gchar *keyword = g_reminder_db_strndup (key + prefix->len, len - prefix->len - G_REMINDER_DB_ID_LEN - 1);
+        g_reminder_db_batch_posting (batch, keyword, g_reminder_db_key_get_id (key + len - G_REMINDER_DB_ID_LEN), TRUE);
+    }
 
-    it = leveldb_create_iterator (priv->db, priv->roptions);
+    gboolean done = !g_reminder_db_iter_has_prefix (it, prefix);
 
-    leveldb_iter_seek (it, hash, strlen (hash));
-    while (leveldb_iter_valid (it))
+    if (done)
     {
-        const gchar *key = leveldb_iter_key (it, &len);
-        if (len != hlen && !key[hlen])
-        {
-            if (memcmp (hash, key, hlen))
-                break;
-            keywords = g_slist_prepend (keywords, sdup (leveldb_iter_value (it, &len), &len));
-        }
-        leveldb_iter_next (it);
+        G_REMINDER_CLEANUP_FREE gchar *version = g_strdup_printf ("%d", G_REMINDER_DB_SCHEMA_BLOCKS);
+        g_reminder_db_private_put_meta (batch, "version", version);
     }
 
-    return g_reminder_item_new (keywords, contents);
-}
+    gboolean ok = g_reminder_db_private_write (priv, batch, &seq);
+    if (ok && done)
+        g_atomic_int_set (&priv->repacking, FALSE);
 
-static gboolean
-g_reminder_db_private_delete (GReminderDbPrivate *priv,
-                              const gchar        *key,
-                              size_t              klen)
-{
-    G_REMINDER_CLEANUP_FREE gchar *err = NULL;
-    leveldb_delete (priv->db, priv->woptions, key, klen, &err);
-    return !err;
+    g_mutex_unlock (&priv->write_lock);
+
+    if (!ok || !g_reminder_db_private_wait_durable (priv, seq))
+        return FALSE;
+
+    *finished = done;
+    return TRUE;
 }
 
+/*
+ * Index the contents and measure up to G_REMINDER_DB_MIGRATION_ITEMS items
+ * written before schema 5, in id order from where the last step stopped.
+ * Items saved meanwhile got indexed by the save itself, indexing them once
+ * more changes nothing. Text searches only see part of the items until
+ * done, and unmeasured items rank as if of average length.
+ */
 static gboolean
-g_reminder_db_private_delete_suffix (GReminderDbPrivate *priv,
-                                     const gchar        *key,
-                                     const gchar        *suffix)
+g_reminder_db_private_index_step (GReminderDbPrivate *priv,
+                                  gboolean           *finished)
 {
-    G_REMINDER_CLEANUP_FREE gchar *_key = g_strdup_printf ("%s%c%s", key, '\0', suffix);
-    return g_reminder_db_private_delete (priv, _key, strlen (key) + strlen (suffix) + 1);
-}
+    G_REMINDER_CLEANUP_BATCH_FREE GReminderDbBatch *batch = g_reminder_db_batch_new ();
+    G_REMINDER_CLEANUP_STRING_FREE GString *prefix = g_reminder_db_key_new (G_REMINDER_DB_NS_ITEM);
+    guint64 next = 0;
+    guint items = 0;
+    guint64 seq;
+
+    g_mutex_lock (&priv->write_lock);
+
+    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = leveldb_create_iterator (priv->db, priv->scan_roptions);
+    G_REMINDER_CLEANUP_FREE gchar *cursor = g_reminder_db_private_get_meta (priv, "text-cursor");
+    G_REMINDER_CLEANUP_FREE gchar *schema = g_reminder_db_private_get_meta (priv, "version");
+    /* From schema 4 on, the contents are indexed already and only the lengths are missing */
+    gboolean indexed = (schema && g_ascii_strtoull (schema, NULL, 10) >= G_REMINDER_DB_SCHEMA_TEXT);
+    G_REMINDER_CLEANUP_STRING_FREE GString *start = g_reminder_db_key_item ((cursor) ? g_ascii_strtoull (cursor, NULL, 10) : 0);
+
+    for (leveldb_iter_seek (it, start->str, start->len); g_reminder_db_iter_has_prefix (it, prefix) && items < G_REMINDER_DB_MIGRATION_ITEMS; leveldb_iter_next (it))
+    {
+        size_t klen, vlen;
+        const gchar *key = leveldb_iter_key (it, &klen);
+        const gchar *value = leveldb_iter_value (it, &vlen);
 
-G_REMINDER_VISIBLE gboolean
-g_reminder_db_delete (const GReminderDb   *self,
-                      const GReminderItem *item)
-{
-    g_return_val_if_fail (G_REMINDER_IS_DB (self), FALSE);
+        if (klen != prefix->len + G_REMINDER_DB_ID_LEN)
+            continue;
 
-    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
+        guint64 id = g_reminder_db_key_get_id (key + prefix->len);
+        G_REMINDER_CLEANUP_UNREF GReminderItem *item = g_reminder_db_record_decode (id, value, vlen);
 
-    const gchar *checksum = g_reminder_item_get_checksum (item);
+        next = id + 1;
+        ++items;
+        if (item)
+            g_reminder_db_private_index_contents (batch, id, (indexed) ? item : NULL, item);
+    }
 
-    if (!g_reminder_db_private_delete (priv, checksum, strlen (checksum)))
-        return FALSE;
+    gboolean done = !g_reminder_db_iter_has_prefix (it, prefix);
 
-    for (const GSList *k = g_reminder_item_get_keywords (item); k; k = g_slist_next (k))
+    if (done)
     {
-        if (!g_reminder_db_private_delete_suffix (priv, k->data, checksum) ||
-            !g_reminder_db_private_delete_suffix (priv, checksum, k->data))
-                return FALSE;
+        G_REMINDER_CLEANUP_FREE gchar *version = g_strdup_printf ("%d", G_REMINDER_DB_SCHEMA_LENGTHS);
+        g_reminder_db_private_delete_meta (batch, "text-cursor");
+        g_reminder_db_private_put_meta (batch, "version", version);
+    }
+    else
+    {
+        G_REMINDER_CLEANUP_FREE gchar *from = g_strdup_printf ("%" G_GUINT64_FORMAT, next);
+        g_reminder_db_private_put_meta (batch, "text-cursor", from);
     }
 
-    return TRUE;
-}
+    gboolean ok = g_reminder_db_private_write (priv, batch, &seq);
+    if (ok && done)
+        g_atomic_int_set (&priv->indexing, FALSE);
 
-G_REMINDER_VISIBLE gboolean
-g_reminder_db_delete_key (const GReminderDb *self,
-                          const gchar       *key)
-{
-    g_return_val_if_fail (G_REMINDER_IS_DB (self), FALSE);
-    g_return_val_if_fail (key, FALSE);
+    g_mutex_unlock (&priv->write_lock);
 
-    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
+    if (!ok || !g_reminder_db_private_wait_durable (priv, seq))
+        return FALSE;
 
-    return g_reminder_db_private_delete (priv, key, strlen (key));
+    *finished = done;
+    return TRUE;
 }
 
-G_REMINDER_VISIBLE gboolean
-g_reminder_db_delete_with_suffix (const GReminderDb *self,
-                                  const gchar       *key,
-                                  const gchar       *suffix)
+/* Whether it went past the keywords, words of the contents are folded already */
+static gboolean
+g_reminder_db_private_fold_is_over (const leveldb_iterator_t *it,
+                                    const GString            *prefix)
 {
-    g_return_val_if_fail (G_REMINDER_IS_DB (self), FALSE);
-    g_return_val_if_fail (key, FALSE);
-    g_return_val_if_fail (suffix, FALSE);
+    size_t klen;
 
-    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
+    if (!g_reminder_db_iter_has_prefix (it, prefix))
+        return TRUE;
 
-    return g_reminder_db_private_delete_suffix (priv, key, suffix);
+    const gchar *key = leveldb_iter_key (it, &klen);
+    return klen > prefix->len && key[prefix->len] == G_REMINDER_DB_TEXT_MARK;
 }
 
-G_REMINDER_VISIBLE GSList *
-g_reminder_db_find (const GReminderDb *self,
-                    const gchar       *keywords)
+/*
+ * Move the postings of keywords indexed as typed before schema 6 over to
+ * their folded form, going through the dictionary from where the last step
+ * stopped. Each keyword moves as a whole, up to G_REMINDER_DB_MIGRATION_KEYS
+ * entries or postings per step. Until done, searches miss the items tagged
+ * with a keyword spelled differently from its folded form.
+ */
+static gboolean
+g_reminder_db_private_fold_step (GReminderDbPrivate *priv,
+                                 gboolean           *finished)
 {
-    g_return_val_if_fail (G_REMINDER_IS_DB (self), NULL);
+    G_REMINDER_CLEANUP_BATCH_FREE GReminderDbBatch *batch = g_reminder_db_batch_new ();
+    G_REMINDER_CLEANUP_STRING_FREE GString *prefix = g_reminder_db_key_new (G_REMINDER_DB_NS_KEYWORD);
+    G_REMINDER_CLEANUP_ARRAY_UNREF GArray *ids = g_array_new (FALSE, FALSE, sizeof (guint64));
+    G_REMINDER_CLEANUP_ARRAY_UNREF GArray *block = g_array_new (FALSE, FALSE, sizeof (guint64));
+    guint keys = 0;
+    guint64 seq;
 
-    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
+    g_mutex_lock (&priv->write_lock);
 
-    G_REMINDER_CLEANUP_STRFREEV gchar **ks = g_strsplit (keywords, " ", -1);
-    G_REMINDER_CLEANUP_SLIST_FREE GSList *hashs = NULL;
-    GSList *items = NULL;
+    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = leveldb_create_iterator (priv->db, priv->scan_roptions);
+    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *blocks = leveldb_create_iterator (priv->db, priv->scan_roptions);
+    G_REMINDER_CLEANUP_FREE gchar *cursor = g_reminder_db_private_get_meta (priv, "fold-cursor");
+    G_REMINDER_CLEANUP_STRING_FREE GString *start = g_reminder_db_key_keyword ((cursor) ? cursor : "");
 
-    for (gchar **k = ks; *k; ++k)
+    for (leveldb_iter_seek (it, start->str, start->len); !g_reminder_db_private_fold_is_over (it, prefix) && keys < G_REMINDER_DB_MIGRATION_KEYS; leveldb_iter_next (it))
     {
-        GSList *hs = g_reminder_db_private_find (priv, *k);
-        if (!hashs)
-        {
-            hashs = hs;
+        size_t klen;
+        const gchar *key = leveldb_iter_key (it, &klen);
+        G_REMINDER_CLEANUP_FREE gchar *keyword = g_reminder_db_strndup (key + prefix->len, klen - prefix->len);
+        G_REMINDER_CLEANUP_FREE gchar *folded = g_reminder_db_text_fold (keyword);
+        G_REMINDER_CLEANUP_STRING_FREE GString *postings = g_reminder_db_key_postings_prefix (keyword);
+
+        ++keys;
+        if (!strcmp (keyword, folded))
             continue;
+
+        g_array_set_size (ids, 0);
+        for (leveldb_iter_seek (blocks, postings->str, postings->len); g_reminder_db_iter_has_prefix (blocks, postings); leveldb_iter_next (blocks))
+        {
+            size_t vlen;
+            const gchar *value = leveldb_iter_value (blocks, &vlen);
+
+            g_array_set_size (block, 0);
+            if (g_reminder_db_block_decode (value, vlen, block))
+                g_array_append_vals (ids, block->data, block->len);
+            else
+                g_warning ("Dropping a corrupted posting block of %s", keyword);
         }
 
-        GSList *_hashs = NULL;
-        for (; hs; hs = g_slist_next (hs))
+        for (guint i = 0; i < ids->len; ++i)
         {
-            for (GSList *__hashs = hashs; __hashs; __hashs = g_slist_next (__hashs))
-            {
-                if (!g_strcmp0 (__hashs->data, hs->data))
-                    _hashs = g_slist_prepend (_hashs, hs->data);
-            }
+            g_reminder_db_batch_posting (batch, folded, g_array_index (ids, guint64, i), TRUE);
+            g_reminder_db_batch_posting (batch, keyword, g_array_index (ids, guint64, i), FALSE);
         }
-        g_slist_free_full (hashs, g_free);
-        hashs = _hashs;
+        g_reminder_db_batch_spelling (batch, folded, keyword);
+        keys += ids->len;
     }
 
-    for (GSList *_hashs = hashs; _hashs; _hashs = g_slist_next (_hashs))
+    gboolean done = g_reminder_db_private_fold_is_over (it, prefix);
+
+    if (done)
     {
-        GReminderItem *item = g_reminder_db_private_get_item (priv, _hashs->data);
-        if (!item)
-            continue;
-        items = g_slist_prepend (items, item);
+        G_REMINDER_CLEANUP_FREE gchar *version = g_strdup_printf ("%d", G_REMINDER_DB_SCHEMA_VERSION);
+        g_reminder_db_private_delete_meta (batch, "fold-cursor");
+        g_reminder_db_private_put_meta (batch, "version", version);
+    }
+    else
+    {
+        size_t klen;
+        const gchar *key = leveldb_iter_key (it, &klen);
+        G_REMINDER_CLEANUP_FREE gchar *from = g_reminder_db_strndup (key + prefix->len, klen - prefix->len);
+        g_reminder_db_private_put_meta (batch, "fold-cursor", from);
     }
 
-    return items;
+    gboolean ok = g_reminder_db_private_write (priv, batch, &seq);
+    if (ok && done)
+        g_atomic_int_set (&priv->folding, FALSE);
+
+    g_mutex_unlock (&priv->write_lock);
+
+    if (!ok || !g_reminder_db_private_wait_durable (priv, seq))
+        return FALSE;
+
+    *finished = done;
+    return TRUE;
 }
 
-static GSList *
-g_reminder_db_private_get_keywords (GReminderDbPrivate *priv)
+/* Each stage runs once the one before is over, they all resume on next startup */
+/* Runs one step of the migration, returns whether there is more to do */
+static gboolean
+g_reminder_db_private_migrate (GReminderDbPrivate *priv)
 {
-    GSList *keywords = NULL;
-    G_REMINDER_CLEANUP_DB_ITER_DESTROY leveldb_iterator_t *it = leveldb_create_iterator (priv->db, priv->roptions);
-    G_REMINDER_CLEANUP_FREE gchar *last_hash = NULL;
+    gboolean finished = FALSE;
+    gboolean legacy = g_atomic_int_get (&priv->migrating);
+    gboolean ok;
+
+    if (legacy)
+        ok = g_reminder_db_private_migrate_step (priv, &finished);
+    else if (g_atomic_int_get (&priv->repacking))
+        ok = g_reminder_db_private_repack_step (priv, &finished);
+    else if (g_atomic_int_get (&priv->indexing))
+        ok = g_reminder_db_private_index_step (priv, &finished);
+    else
+        ok = g_reminder_db_private_fold_step (priv, &finished);
+
+    if (!ok)
+    {
+        /* Keep reading the older layouts, the migration will resume on next startup */
+        g_warning ("Could not migrate the database to schema %d", G_REMINDER_DB_SCHEMA_VERSION);
+        return FALSE;
+    }
 
-    leveldb_iter_seek_to_first (it);
+    if (!finished)
+        return TRUE;
 
-    while (leveldb_iter_valid (it))
+    if (legacy)
     {
-        size_t len;
-        const gchar *key = leveldb_iter_key (it, &len);
-        gboolean has_nul = FALSE;
-        for (guint i = 0; i < len; ++i)
-        {
-            if (!key[i])
-            {
-                has_nul = TRUE;
-                break;
-            }
-        }
-        if (has_nul && !(last_hash && !g_strcmp0 (key, last_hash)))
-        {
-            gboolean found = FALSE;
-            for (const GSList *k = keywords; k; k = g_slist_next (k))
-            {
-                if (!g_strcmp0 (k->data, key))
-                {
-                    found = TRUE;
-                    break;
-                }
-            }
-            if (!found)
-                keywords = g_slist_insert_sorted (keywords, sdup (key, &len), (GCompareFunc) g_strcmp0);
-        }
-        else
-        {
-            g_free (last_hash);
-            last_hash = sdup (key, &len);
-        }
-        leveldb_iter_next (it);
+        g_mutex_lock (&priv->write_lock);
+        g_atomic_int_set (&priv->migrating, FALSE);
+        g_mutex_unlock (&priv->write_lock);
     }
 
-    return keywords;
+    /* Postings moved by earlier versions of the migration may still need repacking, contents indexing and folding */
+    return (g_atomic_int_get (&priv->repacking) || g_atomic_int_get (&priv->indexing) || g_atomic_int_get (&priv->folding));
 }
 
-G_REMINDER_VISIBLE GtkListStore *
-g_reminder_db_get_keywords (const GReminderDb *self)
+/*
+ * Each step syncs a batch to disk, so the migration runs on GTask's worker
+ * pool rather than in the main loop. The task holds no reference on the db:
+ * finalize cancels it and waits for the step in progress instead.
+ */
+static void
+g_reminder_db_migrate_thread (GTask        *task,
+                              gpointer      source_object G_GNUC_UNUSED,
+                              gpointer      task_data,
+                              GCancellable *cancellable)
 {
-    g_return_val_if_fail (G_REMINDER_IS_DB (self), NULL);
+    GReminderDbPrivate *priv = task_data;
 
-    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
-    GtkListStore *store = gtk_list_store_new (1, G_TYPE_STRING);
-    GtkTreeIter iter;
+    while (!g_cancellable_is_cancelled (cancellable) && g_reminder_db_private_migrate (priv));
 
-    for (G_REMINDER_CLEANUP_SLIST_FREE GSList *k = g_reminder_db_private_get_keywords (priv); k; k = g_slist_next (k))
-    {
-        gtk_list_store_append (store, &iter);
-        gtk_list_store_set (store, &iter, 0, k->data, -1);
-    }
+    g_mutex_lock (&priv->sync_lock);
+    priv->migration_running = FALSE;
+    g_cond_broadcast (&priv->migrated);
+    g_mutex_unlock (&priv->sync_lock);
 
-    return store;
+    g_task_return_boolean (task, TRUE);
 }
 
 static void
@@ -340,13 +2260,58 @@ g_reminder_db_finalize (GObject *object)
 {
     GReminderDbPrivate *priv = g_reminder_db_get_instance_private (G_REMINDER_DB (object));
 
+    if (priv->migration_cancellable)
+    {
+        g_cancellable_cancel (priv->migration_cancellable);
+        g_mutex_lock (&priv->sync_lock);
+        while (priv->migration_running)
+            g_cond_wait (&priv->migrated, &priv->sync_lock);
+        g_mutex_unlock (&priv->sync_lock);
+        g_object_unref (priv->migration_cancellable);
+    }
+
+    g_mutex_lock (&priv->sync_lock);
+    priv->closing = TRUE;
+    g_cond_broadcast (&priv->flush_wake);
+    while (priv->flushing)
+        g_cond_wait (&priv->flush_wake, &priv->sync_lock);
+    g_mutex_unlock (&priv->sync_lock);
+
+    if (priv->db && !g_reminder_db_private_flush (priv))
+        g_warning ("Could not flush the database to disk");
+
+    /* Scans still queued belong to finished queries and stop right away */
+    if (priv->scan_pool)
+        g_thread_pool_free (priv->scan_pool, FALSE, TRUE);
+
+    g_hash_table_unref (priv->legacy_ids);
+    if (priv->query_cache)
+        g_reminder_db_query_cache_free (priv->query_cache);
+    if (priv->item_cache)
+        g_reminder_db_item_cache_free (priv->item_cache);
+    if (priv->bitmap_cache)
+        g_reminder_db_bitmap_cache_free (priv->bitmap_cache);
+
     leveldb_options_destroy (priv->options);
     leveldb_readoptions_destroy (priv->roptions);
+    leveldb_readoptions_destroy (priv->scan_roptions);
     leveldb_writeoptions_destroy (priv->woptions);
+    leveldb_writeoptions_destroy (priv->sync_woptions);
+
+    g_mutex_clear (&priv->write_lock);
+    g_mutex_clear (&priv->sync_lock);
+    g_cond_clear (&priv->synced);
+    g_cond_clear (&priv->migrated);
+    g_cond_clear (&priv->flush_wake);
 
     if (priv->db)
         leveldb_close (priv->db);
 
+    if (priv->cache)
+        leveldb_cache_destroy (priv->cache);
+    if (priv->filter)
+        leveldb_filterpolicy_destroy (priv->filter);
+
     G_OBJECT_CLASS (g_reminder_db_parent_class)->finalize (object);
 }
 
@@ -376,11 +2341,54 @@ g_reminder_db_get_full_path (void)
     return g_build_filename (db_dir_path, "greminder.db", NULL);
 }
 
+static guint64
+g_reminder_db_private_load_next_id (GReminderDbPrivate *priv)
+{
+    G_REMINDER_CLEANUP_FREE gchar *next_id = g_reminder_db_private_get_meta (priv, "next-id");
+
+    if (!next_id)
+    {
+        G_REMINDER_CLEANUP_FREE gchar *err = NULL;
+        size_t len;
+        gchar *value = leveldb_get (priv->db, priv->roptions, "\0next-id", sizeof ("\0next-id") - 1, &len, &err);
+        if (!value)
+            return 1;
+        next_id = g_reminder_db_strndup (value, len);
+        leveldb_free (value);
+    }
+
+    return g_ascii_strtoull (next_id, NULL, 10);
+}
+
 static void
 g_reminder_db_init (GReminderDb *self)
 {
     GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
 
+    priv->cache = NULL;
+    priv->filter = NULL;
+    priv->migrating = FALSE;
+    priv->repacking = FALSE;
+    priv->indexing = FALSE;
+    priv->folding = FALSE;
+    priv->migration_cancellable = NULL;
+    priv->migration_running = FALSE;
+    priv->legacy_ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    priv->written = 0;
+    priv->durable = 0;
+    priv->syncing = FALSE;
+    priv->flushing = FALSE;
+    priv->closing = FALSE;
+    priv->scan_pool = NULL;
+    priv->query_cache = NULL;
+    priv->item_cache = NULL;
+    priv->bitmap_cache = NULL;
+    g_mutex_init (&priv->write_lock);
+    g_mutex_init (&priv->sync_lock);
+    g_cond_init (&priv->synced);
+    g_cond_init (&priv->migrated);
+    g_cond_init (&priv->flush_wake);
+
     G_REMINDER_CLEANUP_UNREF GFile *db_dir = g_reminder_db_get_dir ();
 
     if (!g_file_query_exists (db_dir, NULL))
@@ -395,18 +2403,363 @@ g_reminder_db_init (GReminderDb *self)
         }
     }
 
+    GReminderDbConfig config;
+    g_reminder_db_config_load (&config);
+
     priv->options = leveldb_options_create ();
     leveldb_options_set_create_if_missing (priv->options, TRUE);
+    leveldb_options_set_write_buffer_size (priv->options, config.write_buffer_size);
+    leveldb_options_set_block_size (priv->options, config.block_size);
+    leveldb_options_set_max_open_files (priv->options, config.max_open_files);
+    leveldb_options_set_compression (priv->options, (config.compression) ? leveldb_snappy_compression : leveldb_no_compression);
+    if (config.cache_size)
+    {
+        priv->cache = leveldb_cache_create_lru (config.cache_size);
+        leveldb_options_set_cache (priv->options, priv->cache);
+    }
+    if (config.bloom_bits_per_key > 0)
+    {
+        /* Most reads are point lookups of records and dictionary entries */
+        priv->filter = leveldb_filterpolicy_create_bloom (config.bloom_bits_per_key);
+        leveldb_options_set_filter_policy (priv->options, priv->filter);
+    }
 
     priv->roptions = leveldb_readoptions_create ();
+    priv->scan_roptions = leveldb_readoptions_create ();
+    leveldb_readoptions_set_fill_cache (priv->scan_roptions, FALSE);
     priv->woptions = leveldb_writeoptions_create ();
-    leveldb_writeoptions_set_sync (priv->woptions, TRUE);
+    priv->sync_woptions = leveldb_writeoptions_create ();
+    leveldb_writeoptions_set_sync (priv->sync_woptions, TRUE);
+    priv->durability = config.durability;
+    priv->scan_pool = (config.scan_threads > 1) ? g_reminder_db_posting_pool_new (config.scan_threads) : NULL;
+    priv->query_cache = (config.query_cache_size) ? g_reminder_db_query_cache_new (config.query_cache_size) : NULL;
+    priv->item_cache = (config.item_cache_items > 0) ? g_reminder_db_item_cache_new (config.item_cache_items) : NULL;
+    priv->bitmap_cache = (config.bitmap_cache_size) ? g_reminder_db_bitmap_cache_new (config.bitmap_cache_size) : NULL;
+    priv->group_commit_window = MAX (config.group_commit_window, 0) * 1000;
+    priv->search_results = MAX (config.search_results, 0);
 
     G_REMINDER_CLEANUP_FREE gchar *db_full_path = g_reminder_db_get_full_path ();
     G_REMINDER_CLEANUP_FREE gchar *err = NULL;
     priv->db = leveldb_open (priv->options, db_full_path, &err);
     if (err)
+    {
         priv->db = NULL;
+        return;
+    }
+
+    priv->next_id = g_reminder_db_private_load_next_id (priv);
+    priv->rank_items = g_reminder_db_private_get_total (priv, priv->roptions, "rank-items");
+    priv->rank_length = g_reminder_db_private_get_total (priv, priv->roptions, "rank-length");
+
+    G_REMINDER_CLEANUP_FREE gchar *version = g_reminder_db_private_get_meta (priv, "version");
+    guint64 schema = (version) ? g_ascii_strtoull (version, NULL, 10) : 1;
+    if (schema < G_REMINDER_DB_SCHEMA_VERSION)
+    {
+        priv->migrating = (schema < G_REMINDER_DB_SCHEMA_FORWARD);
+        priv->repacking = (schema < G_REMINDER_DB_SCHEMA_BLOCKS);
+        priv->indexing = (schema < G_REMINDER_DB_SCHEMA_LENGTHS);
+        priv->folding = TRUE;
+        priv->migration_cancellable = g_cancellable_new ();
+        priv->migration_running = TRUE;
+
+        G_REMINDER_CLEANUP_UNREF GTask *task = g_task_new (NULL, priv->migration_cancellable, NULL, NULL);
+        g_task_set_task_data (task, priv, NULL);
+        g_task_run_in_thread (task, g_reminder_db_migrate_thread);
+    }
+}
+
+/*
+ * Asynchronous variants run on GTask's worker pool and complete in the
+ * caller's thread default main context. Writes are only cancelled if they
+ * did not start yet, a write that reached the db is always reported.
+ */
+typedef struct
+{
+    GReminderItem *old;
+    GReminderItem *item;
+} GReminderDbChange;
+
+static GReminderDbChange *
+g_reminder_db_change_new (const GReminderItem *old,
+                          GReminderItem       *item)
+{
+    GReminderDbChange *change = g_new (GReminderDbChange, 1);
+    change->old = (old) ? g_object_ref ((GReminderItem *) old) : NULL;
+    change->item = (item) ? g_object_ref (item) : NULL;
+    return change;
+}
+
+static void
+g_reminder_db_change_free (gpointer data)
+{
+    GReminderDbChange *change = data;
+    g_clear_object (&change->old);
+    g_clear_object (&change->item);
+    g_free (change);
+}
+
+static void
+g_reminder_db_items_free (gpointer items)
+{
+    g_slist_free_full (items, g_object_unref);
+}
+
+static void
+g_reminder_db_keywords_free (gpointer keywords)
+{
+    g_slist_free_full (keywords, g_reminder_db_keyword_free);
+}
+
+static void
+g_reminder_db_task_run_write (const GReminderDb   *self,
+                              GReminderDbChange   *change,
+                              GTaskThreadFunc      func,
+                              gpointer             tag,
+                              GCancellable        *cancellable,
+                              GAsyncReadyCallback  callback,
+                              gpointer             user_data)
+{
+    G_REMINDER_CLEANUP_UNREF GTask *task = g_task_new ((gpointer) self, cancellable, callback, user_data);
+
+    g_task_set_source_tag (task, tag);
+    g_task_set_check_cancellable (task, FALSE);
+    g_task_set_task_data (task, change, g_reminder_db_change_free);
+    g_task_run_in_thread (task, func);
+}
+
+static void
+g_reminder_db_task_return_write (GTask    *task,
+                                 gboolean  ok)
+{
+    if (ok)
+        g_task_return_boolean (task, TRUE);
+    else
+        g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED, "Could not write to the database");
+}
+
+static gboolean
+g_reminder_db_task_finish_write (const GReminderDb  *self,
+                                 GAsyncResult       *result,
+                                 gpointer            tag,
+                                 GError            **error)
+{
+    g_return_val_if_fail (g_task_is_valid (result, (gpointer) self), FALSE);
+    g_return_val_if_fail (g_async_result_is_tagged (result, tag), FALSE);
+
+    return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+static void
+g_reminder_db_save_thread (GTask        *task,
+                           gpointer      source_object,
+                           gpointer      task_data,
+                           GCancellable *cancellable G_GNUC_UNUSED)
+{
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private (source_object);
+    GReminderDbChange *change = task_data;
+
+    if (!g_task_return_error_if_cancelled (task))
+        g_reminder_db_task_return_write (task, g_reminder_db_private_save (priv, change->item));
+}
+
+G_REMINDER_VISIBLE void
+g_reminder_db_save_async (const GReminderDb   *self,
+                          GReminderItem       *item,
+                          GCancellable        *cancellable,
+                          GAsyncReadyCallback  callback,
+                          gpointer             user_data)
+{
+    g_return_if_fail (G_REMINDER_IS_DB (self));
+    g_return_if_fail (G_REMINDER_IS_ITEM (item));
+
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
+
+    g_reminder_db_private_prepare (priv, NULL, item);
+    g_reminder_db_task_run_write (self, g_reminder_db_change_new (NULL, item), g_reminder_db_save_thread,
+                                  g_reminder_db_save_async, cancellable, callback, user_data);
+}
+
+G_REMINDER_VISIBLE gboolean
+g_reminder_db_save_finish (const GReminderDb  *self,
+                           GAsyncResult       *result,
+                           GError            **error)
+{
+    return g_reminder_db_task_finish_write (self, result, g_reminder_db_save_async, error);
+}
+
+static void
+g_reminder_db_update_thread (GTask        *task,
+                             gpointer      source_object,
+                             gpointer      task_data,
+                             GCancellable *cancellable G_GNUC_UNUSED)
+{
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private (source_object);
+    GReminderDbChange *change = task_data;
+
+    if (!g_task_return_error_if_cancelled (task))
+        g_reminder_db_task_return_write (task, g_reminder_db_private_update (priv, change->old, change->item));
+}
+
+G_REMINDER_VISIBLE void
+g_reminder_db_update_async (const GReminderDb   *self,
+                            const GReminderItem *old,
+                            GReminderItem       *item,
+                            GCancellable        *cancellable,
+                            GAsyncReadyCallback  callback,
+                            gpointer             user_data)
+{
+    g_return_if_fail (G_REMINDER_IS_DB (self));
+    g_return_if_fail (G_REMINDER_IS_ITEM (old));
+    g_return_if_fail (G_REMINDER_IS_ITEM (item));
+    g_return_if_fail (g_reminder_item_get_id (old) == g_reminder_item_get_id (item));
+
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
+
+    g_reminder_db_private_prepare (priv, old, item);
+    g_reminder_db_task_run_write (self, g_reminder_db_change_new (old, item), g_reminder_db_update_thread,
+                                  g_reminder_db_update_async, cancellable, callback, user_data);
+}
+
+G_REMINDER_VISIBLE gboolean
+g_reminder_db_update_finish (const GReminderDb  *self,
+                             GAsyncResult       *result,
+                             GError            **error)
+{
+    return g_reminder_db_task_finish_write (self, result, g_reminder_db_update_async, error);
+}
+
+static void
+g_reminder_db_delete_thread (GTask        *task,
+                             gpointer      source_object,
+                             gpointer      task_data,
+                             GCancellable *cancellable G_GNUC_UNUSED)
+{
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private (source_object);
+    GReminderDbChange *change = task_data;
+
+    if (!g_task_return_error_if_cancelled (task))
+        g_reminder_db_task_return_write (task, g_reminder_db_private_delete (priv, change->old));
+}
+
+G_REMINDER_VISIBLE void
+g_reminder_db_delete_async (const GReminderDb   *self,
+                            const GReminderItem *item,
+                            GCancellable        *cancellable,
+                            GAsyncReadyCallback  callback,
+                            gpointer             user_data)
+{
+    g_return_if_fail (G_REMINDER_IS_DB (self));
+    g_return_if_fail (G_REMINDER_IS_ITEM (item));
+
+    g_reminder_db_task_run_write (self, g_reminder_db_change_new (item, NULL), g_reminder_db_delete_thread,
+                                  g_reminder_db_delete_async, cancellable, callback, user_data);
+}
+
+G_REMINDER_VISIBLE gboolean
+g_reminder_db_delete_finish (const GReminderDb  *self,
+                             GAsyncResult       *result,
+                             GError            **error)
+{
+    return g_reminder_db_task_finish_write (self, result, g_reminder_db_delete_async, error);
+}
+
+static void
+g_reminder_db_find_thread (GTask        *task,
+                           gpointer      source_object,
+                           gpointer      task_data,
+                           GCancellable *cancellable)
+{
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private (source_object);
+    GError *error = NULL;
+    GSList *items = g_reminder_db_private_find_items (priv, task_data, cancellable, &error);
+
+    if (error)
+        g_task_return_error (task, error);
+    else
+        g_task_return_pointer (task, items, g_reminder_db_items_free);
+}
+
+G_REMINDER_VISIBLE void
+g_reminder_db_find_async (const GReminderDb   *self,
+                          const gchar         *keywords,
+                          GCancellable        *cancellable,
+                          GAsyncReadyCallback  callback,
+                          gpointer             user_data)
+{
+    g_return_if_fail (G_REMINDER_IS_DB (self));
+    g_return_if_fail (keywords);
+
+    G_REMINDER_CLEANUP_UNREF GTask *task = g_task_new ((gpointer) self, cancellable, callback, user_data);
+
+    g_task_set_source_tag (task, g_reminder_db_find_async);
+    g_task_set_task_data (task, g_strdup (keywords), g_free);
+    g_task_run_in_thread (task, g_reminder_db_find_thread);
+}
+
+G_REMINDER_VISIBLE GSList *
+g_reminder_db_find_finish (const GReminderDb  *self,
+                           GAsyncResult       *result,
+                           GError            **error)
+{
+    g_return_val_if_fail (g_task_is_valid (result, (gpointer) self), NULL);
+    g_return_val_if_fail (g_async_result_is_tagged (result, g_reminder_db_find_async), NULL);
+
+    return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+static void
+g_reminder_db_get_keywords_thread (GTask        *task,
+                                   gpointer      source_object,
+                                   gpointer      task_data    G_GNUC_UNUSED,
+                                   GCancellable *cancellable  G_GNUC_UNUSED)
+{
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private (source_object);
+
+    g_task_return_pointer (task, g_reminder_db_private_get_keywords (priv), g_reminder_db_keywords_free);
+}
+
+G_REMINDER_VISIBLE void
+g_reminder_db_get_keywords_async (const GReminderDb   *self,
+                                  GCancellable        *cancellable,
+                                  GAsyncReadyCallback  callback,
+                                  gpointer             user_data)
+{
+    g_return_if_fail (G_REMINDER_IS_DB (self));
+
+    G_REMINDER_CLEANUP_UNREF GTask *task = g_task_new ((gpointer) self, cancellable, callback, user_data);
+
+    g_task_set_source_tag (task, g_reminder_db_get_keywords_async);
+    g_task_run_in_thread (task, g_reminder_db_get_keywords_thread);
+}
+
+/* The store is built here, GTK objects are better kept out of the workers */
+G_REMINDER_VISIBLE GtkListStore *
+g_reminder_db_get_keywords_finish (const GReminderDb  *self,
+                                   GAsyncResult       *result,
+                                   GError            **error)
+{
+    g_return_val_if_fail (g_task_is_valid (result, (gpointer) self), NULL);
+    g_return_val_if_fail (g_async_result_is_tagged (result, g_reminder_db_get_keywords_async), NULL);
+
+    GError *err = NULL;
+    GSList *keywords = g_task_propagate_pointer (G_TASK (result), &err);
+    if (err)
+    {
+        g_propagate_error (error, err);
+        return NULL;
+    }
+
+    return g_reminder_db_keywords_to_store (keywords);
+}
+
+G_REMINDER_VISIBLE gboolean
+g_reminder_db_flush (const GReminderDb *self)
+{
+    g_return_val_if_fail (G_REMINDER_IS_DB (self), FALSE);
+
+    GReminderDbPrivate *priv = g_reminder_db_get_instance_private ((GReminderDb *) self);
+
+    return g_reminder_db_private_flush (priv);
 }
 
 G_REMINDER_VISIBLE GReminderDb *
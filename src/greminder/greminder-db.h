@@ -20,7 +20,8 @@
 #ifndef __G_REMINDER_DB_H__
 #define __G_REMINDER_DB_H__
 
-#include "greminder-item.h"
+#include "greminder-db-cursor.h"
+#include "greminder-db-explain.h"
 
 G_BEGIN_DECLS
 
@@ -34,27 +35,98 @@ G_BEGIN_DECLS
 typedef struct _GReminderDb GReminderDb;
 typedef struct _GReminderDbClass GReminderDbClass;
 
+typedef enum
+{
+    G_REMINDER_DB_KEYWORDS_COLUMN_KEYWORD,
+    G_REMINDER_DB_KEYWORDS_COLUMN_COUNT,
+    G_REMINDER_DB_KEYWORDS_N_COLUMNS
+} GReminderDbKeywordsColumn;
+
 G_REMINDER_VISIBLE
 GType g_reminder_db_get_type (void);
 
-gboolean g_reminder_db_save (const GReminderDb   *self,
-                             const GReminderItem *item);
+gboolean g_reminder_db_save (const GReminderDb *self,
+                             GReminderItem     *item);
+void     g_reminder_db_save_async  (const GReminderDb   *self,
+                                    GReminderItem       *item,
+                                    GCancellable        *cancellable,
+                                    GAsyncReadyCallback  callback,
+                                    gpointer             user_data);
+gboolean g_reminder_db_save_finish (const GReminderDb  *self,
+                                    GAsyncResult       *result,
+                                    GError            **error);
+
+gboolean g_reminder_db_update (const GReminderDb   *self,
+                               const GReminderItem *old,
+                               GReminderItem       *item);
+void     g_reminder_db_update_async  (const GReminderDb   *self,
+                                      const GReminderItem *old,
+                                      GReminderItem       *item,
+                                      GCancellable        *cancellable,
+                                      GAsyncReadyCallback  callback,
+                                      gpointer             user_data);
+gboolean g_reminder_db_update_finish (const GReminderDb  *self,
+                                      GAsyncResult       *result,
+                                      GError            **error);
 
 gboolean g_reminder_db_delete (const GReminderDb   *self,
                                const GReminderItem *item);
-
-gboolean g_reminder_db_delete_key (const GReminderDb *self,
-                                   const gchar       *key);
-
-gboolean g_reminder_db_delete_with_suffix (const GReminderDb *self,
-                                           const gchar       *key,
-                                           const gchar       *suffix);
+void     g_reminder_db_delete_async  (const GReminderDb   *self,
+                                      const GReminderItem *item,
+                                      GCancellable        *cancellable,
+                                      GAsyncReadyCallback  callback,
+                                      gpointer             user_data);
+gboolean g_reminder_db_delete_finish (const GReminderDb  *self,
+                                      GAsyncResult       *result,
+                                      GError            **error);
 
 GtkListStore *g_reminder_db_get_keywords (const GReminderDb *self);
+void          g_reminder_db_get_keywords_async  (const GReminderDb   *self,
+                                                 GCancellable        *cancellable,
+                                                 GAsyncReadyCallback  callback,
+                                                 gpointer             user_data);
+GtkListStore *g_reminder_db_get_keywords_finish (const GReminderDb  *self,
+                                                 GAsyncResult       *result,
+                                                 GError            **error);
+
+/* The items come sorted by descending id, newest first */
+GSList *g_reminder_db_get_items (const GReminderDb *self,
+                                 const guint64     *ids,
+                                 gsize              n_ids);
 
+/*
+ * Keywords are a query, see greminder-db-query.h. Invalid queries match
+ * nothing, g_reminder_db_find_finish reports why. The items come best
+ * match first, see greminder-db-rank.h, and only the SearchResults best
+ * ones do. Cursors walk every match instead, in id order.
+ */
 GSList *g_reminder_db_find (const GReminderDb *self,
                             const gchar       *keywords);
 
+/* Counters of the cache of search results, see QueryCacheSize */
+void g_reminder_db_get_query_cache_stats (const GReminderDb *self,
+                                          guint64           *hits,
+                                          guint64           *misses);
+
+/* Why a search costs what it does, see greminder-db-explain.h */
+GReminderDbExplain *g_reminder_db_explain (const GReminderDb  *self,
+                                           const gchar        *keywords,
+                                           gboolean            analyze,
+                                           GError            **error);
+
+GReminderDbCursor *g_reminder_db_find_cursor (const GReminderDb *self,
+                                              const gchar       *keywords);
+void    g_reminder_db_find_async  (const GReminderDb   *self,
+                                   const gchar         *keywords,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             user_data);
+GSList *g_reminder_db_find_finish (const GReminderDb  *self,
+                                   GAsyncResult       *result,
+                                   GError            **error);
+
+gboolean g_reminder_db_flush (const GReminderDb *self);
+
 GReminderDb *g_reminder_db_new (void);
 
 G_END_DECLS
@@ -36,6 +36,14 @@ struct _GReminderItemClass
     GObjectClass parent_class;
 };
 
+/*
+ * For items read back from the db: takes ownership of keywords, which have
+ * to be distinct already, and of contents.
+ */
+GReminderItem *g_reminder_item_new_take (guint64  id,
+                                         GSList  *keywords,
+                                         gchar   *contents);
+
 G_END_DECLS
 
 #endif /*__G_REMINDER_ITEM_PRIVATE_H__*/
@@ -21,6 +21,7 @@
 
 struct _GReminderItemPrivate
 {
+    guint64 id;
     GSList *keywords;
     gchar  *contents;
     gchar  *checksum;
@@ -28,6 +29,16 @@ struct _GReminderItemPrivate
 
 G_DEFINE_TYPE_WITH_PRIVATE (GReminderItem, g_reminder_item, G_TYPE_OBJECT)
 
+G_REMINDER_VISIBLE guint64
+g_reminder_item_get_id (const GReminderItem *self)
+{
+    g_return_val_if_fail (G_REMINDER_IS_ITEM (self), 0);
+
+    GReminderItemPrivate *priv = g_reminder_item_get_instance_private ((GReminderItem *) self);
+
+    return priv->id;
+}
+
 G_REMINDER_VISIBLE const GSList *
 g_reminder_item_get_keywords (const GReminderItem *self)
 {
@@ -48,6 +59,7 @@ g_reminder_item_get_contents (const GReminderItem *self)
     return priv->contents;
 }
 
+/* Only items that never reached the db need a checksum, it is computed on demand */
 G_REMINDER_VISIBLE const gchar *
 g_reminder_item_get_checksum (const GReminderItem *self)
 {
@@ -55,9 +67,26 @@ g_reminder_item_get_checksum (const GReminderItem *self)
 
     GReminderItemPrivate *priv = g_reminder_item_get_instance_private ((GReminderItem *) self);
 
+    if (g_once_init_enter (&priv->checksum))
+        g_once_init_leave (&priv->checksum, g_compute_checksum_for_string (G_CHECKSUM_SHA1, priv->contents, -1));
+
     return priv->checksum;
 }
 
+G_REMINDER_VISIBLE void
+g_reminder_item_set_id (GReminderItem *self,
+                        guint64        id)
+{
+    g_return_if_fail (G_REMINDER_IS_ITEM (self));
+
+    GReminderItemPrivate *priv = g_reminder_item_get_instance_private (self);
+
+    /* An item only gets its id once, when it first reaches the db */
+    g_return_if_fail (!priv->id);
+
+    priv->id = id;
+}
+
 static void
 g_reminder_item_finalize (GObject *object)
 {
@@ -81,11 +110,14 @@ g_reminder_item_init (GReminderItem *self)
 {
     GReminderItemPrivate *priv = g_reminder_item_get_instance_private ((GReminderItem *) self);
     
+    priv->id = 0;
     priv->keywords = NULL;
+    priv->checksum = NULL;
 }
 
 G_REMINDER_VISIBLE GReminderItem *
-g_reminder_item_new (const GSList *keywords,
+g_reminder_item_new (guint64       id,
+                     const GSList *keywords,
                      const gchar  *contents)
 {
     g_return_val_if_fail (keywords, NULL);
@@ -94,11 +126,29 @@ g_reminder_item_new (const GSList *keywords,
     GReminderItem *self = G_REMINDER_ITEM (g_object_new (G_REMINDER_TYPE_ITEM, NULL));
     GReminderItemPrivate *priv = g_reminder_item_get_instance_private ((GReminderItem *) self);
 
+    priv->id = id;
     priv->contents = g_strdup (contents);
-    priv->checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, priv->contents, -1);
 
     for (const GSList *k = keywords; k; k = g_slist_next (k))
-        priv->keywords = g_slist_append (priv->keywords, g_strdup (k->data));
+    {
+        if (!g_slist_find_custom (priv->keywords, k->data, (GCompareFunc) g_strcmp0))
+            priv->keywords = g_slist_append (priv->keywords, g_strdup (k->data));
+    }
+
+    return self;
+}
+
+GReminderItem *
+g_reminder_item_new_take (guint64  id,
+                          GSList  *keywords,
+                          gchar   *contents)
+{
+    GReminderItem *self = G_REMINDER_ITEM (g_object_new (G_REMINDER_TYPE_ITEM, NULL));
+    GReminderItemPrivate *priv = g_reminder_item_get_instance_private ((GReminderItem *) self);
+
+    priv->id = id;
+    priv->keywords = keywords;
+    priv->contents = contents;
 
     return self;
 }
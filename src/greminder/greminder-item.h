@@ -37,11 +37,16 @@ typedef struct _GReminderItemClass GReminderItemClass;
 G_REMINDER_VISIBLE
 GType g_reminder_item_get_type (void);
 
+guint64       g_reminder_item_get_id       (const GReminderItem *self);
 const GSList *g_reminder_item_get_keywords (const GReminderItem *self);
 const gchar  *g_reminder_item_get_contents (const GReminderItem *self);
 const gchar  *g_reminder_item_get_checksum (const GReminderItem *self);
 
-GReminderItem *g_reminder_item_new (const GSList *keywords,
+void g_reminder_item_set_id (GReminderItem *self,
+                             guint64        id);
+
+GReminderItem *g_reminder_item_new (guint64       id,
+                                    const GSList *keywords,
                                     const gchar  *contents);
 
 G_END_DECLS
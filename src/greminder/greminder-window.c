@@ -47,6 +47,7 @@ struct _GReminderWindowPrivate
     GReminderDb             *db;
 
     GReminderItem           *item;
+    GCancellable            *cancellable;
 
     GRegex                  *no_blank_regex;
 
@@ -65,87 +66,151 @@ G_DEFINE_TYPE_WITH_PRIVATE (GReminderWindow, g_reminder_window, GTK_TYPE_APPLICA
                gpointer          user_data)
 
 static void
-g_reminder_window_private_set_item (GReminderWindowPrivate *priv)
+g_reminder_window_private_set_item (GReminderWindowPrivate *priv,
+                                    guint64                 id)
 {
     const gchar *text;
     g_object_get (G_OBJECT (priv->text), "text", &text, NULL);
 
     g_clear_object (&priv->item);
-    priv->item =  g_reminder_item_new (g_reminder_keywords_widget_get_keywords (priv->keywords), text);
+    priv->item =  g_reminder_item_new (id, g_reminder_keywords_widget_get_keywords (priv->keywords), text);
+}
+
+/* Whether the window got destroyed while the db was working for it */
+static gboolean
+g_reminder_window_private_is_gone (GReminderWindowPrivate *priv,
+                                   const GError           *error)
+{
+    return !priv->db || g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
 }
 
 static void
-g_reminder_window_private_reset_completion (GReminderWindowPrivate *priv)
+on_keywords_loaded (GObject      *source,
+                    GAsyncResult *result,
+                    gpointer      user_data)
 {
+    G_REMINDER_CLEANUP_UNREF GReminderWindow *self = user_data;
+    GReminderWindowPrivate *priv = g_reminder_window_get_instance_private (self);
+    G_REMINDER_CLEANUP_ERROR_FREE GError *error = NULL;
+    GtkListStore *store = g_reminder_db_get_keywords_finish (G_REMINDER_DB (source), result, &error);
+
+    if (g_reminder_window_private_is_gone (priv, error))
+    {
+        g_clear_object (&store);
+        return;
+    }
+
+    if (!store)
+    {
+        g_warning ("Could not load keywords: %s", error->message);
+        return;
+    }
+
     GtkTreeModel *model = gtk_entry_completion_get_model (priv->completion);
     g_clear_object (&model);
-    gtk_entry_completion_set_model (priv->completion, GTK_TREE_MODEL (g_reminder_db_get_keywords (priv->db)));
+    gtk_entry_completion_set_model (priv->completion, GTK_TREE_MODEL (store));
+}
+
+static void
+g_reminder_window_private_reset_completion (GReminderWindow *self)
+{
+    GReminderWindowPrivate *priv = g_reminder_window_get_instance_private (self);
+
+    g_reminder_db_get_keywords_async (priv->db, priv->cancellable, on_keywords_loaded, g_object_ref (self));
+}
+
+static void
+g_reminder_window_private_written (GReminderWindow *self,
+                                   gboolean         ok,
+                                   const GError    *error)
+{
+    GReminderWindowPrivate *priv = g_reminder_window_get_instance_private (self);
+
+    if (!ok)
+        g_warning ("Could not write to the database: %s", error->message);
+
+    if (!g_reminder_window_private_is_gone (priv, NULL))
+        g_reminder_window_private_reset_completion (self);
 }
 
+#define ON_WRITTEN(name, op)                                                                \
+    static void                                                                             \
+    on_##name (GObject      *source,                                                        \
+               GAsyncResult *result,                                                        \
+               gpointer      user_data)                                                     \
+    {                                                                                       \
+        G_REMINDER_CLEANUP_UNREF GReminderWindow *self = user_data;                         \
+        G_REMINDER_CLEANUP_ERROR_FREE GError *error = NULL;                                 \
+        gboolean ok = g_reminder_db_##op##_finish (G_REMINDER_DB (source), result, &error); \
+        g_reminder_window_private_written (self, ok, error);                                \
+    }
+
+ON_WRITTEN (saved,   save)
+ON_WRITTEN (updated, update)
+
 ON_ACTION_PROTO (new)
 {
-    GReminderWindowPrivate *priv = user_data;
+    GReminderWindowPrivate *priv = g_reminder_window_get_instance_private (user_data);
 
     g_clear_object (&priv->item);
     g_reminder_keywords_widget_reset (priv->keywords);
     gtk_text_buffer_set_text (priv->text, "", -1);
 }
 
-ON_ACTION_PROTO (delete)
+/* The note stays in the editor until it is actually gone from the db */
+static void
+on_deleted (GObject      *source,
+            GAsyncResult *result,
+            gpointer      user_data)
 {
-    GReminderWindowPrivate *priv = user_data;
+    G_REMINDER_CLEANUP_UNREF GReminderWindow *self = user_data;
+    GReminderWindowPrivate *priv = g_reminder_window_get_instance_private (self);
+    G_REMINDER_CLEANUP_ERROR_FREE GError *error = NULL;
+    gboolean ok = g_reminder_db_delete_finish (G_REMINDER_DB (source), result, &error);
 
-    if (g_reminder_db_delete (priv->db, priv->item))
-        on_new (actions, user_data);
-    g_reminder_window_private_reset_completion (priv);
+    g_reminder_window_private_written (self, ok, error);
+    if (ok && !g_reminder_window_private_is_gone (priv, NULL))
+        on_new (priv->actions, self);
 }
 
-ON_ACTION_PROTO (save)
+ON_ACTION_PROTO (delete)
 {
-    GReminderWindowPrivate *priv = user_data;
+    GReminderWindowPrivate *priv = g_reminder_window_get_instance_private (user_data);
 
-    g_reminder_window_private_set_item (priv);
-    g_reminder_db_save (priv->db, priv->item);
-    g_reminder_window_private_reset_completion (priv);
-
-    gtk_widget_grab_focus (GTK_WIDGET (priv->textview));
+    g_reminder_db_delete_async (priv->db, priv->item, priv->cancellable, on_deleted, g_object_ref (user_data));
 }
 
 ON_ACTION_PROTO (edit)
 {
-    GReminderWindowPrivate *priv = user_data;
+    GReminderWindowPrivate *priv = g_reminder_window_get_instance_private (user_data);
     
     G_REMINDER_CLEANUP_UNREF GReminderItem *old = g_object_ref (priv->item);
-    g_reminder_window_private_set_item (priv);
-    g_reminder_db_save (priv->db, priv->item);
+    g_reminder_window_private_set_item (priv, g_reminder_item_get_id (old));
+    g_reminder_db_update_async (priv->db, old, priv->item, priv->cancellable, on_updated, g_object_ref (user_data));
+
+    gtk_widget_grab_focus (GTK_WIDGET (priv->textview));
+}
 
-    if (g_strcmp0 (g_reminder_item_get_contents (old), g_reminder_item_get_contents (priv->item)))
-        g_reminder_db_delete_key (priv->db, g_reminder_item_get_checksum (old));
+ON_ACTION_PROTO (save)
+{
+    GReminderWindowPrivate *priv = g_reminder_window_get_instance_private (user_data);
 
-    const gchar *checksum = g_reminder_item_get_checksum (old);
-    const GSList *_kk = g_reminder_item_get_keywords (priv->item);
-    for (const GSList *k = g_reminder_item_get_keywords (old); k; k = g_slist_next (k))
+    /* The note got saved already, saving it again must not store a copy */
+    if (priv->item)
     {
-        gboolean found = FALSE;
-        for (const GSList *kk = _kk; kk; kk = g_slist_next (kk))
-        {
-            if (!g_strcmp0 (k->data, kk->data))
-                found = TRUE;
-        }
-        if (!found)
-        {
-            g_reminder_db_delete_with_suffix (priv->db, k->data, checksum);
-            g_reminder_db_delete_with_suffix (priv->db, checksum, k->data);
-        }
+        on_edit (actions, user_data);
+        return;
     }
-    g_reminder_window_private_reset_completion (priv);
+
+    g_reminder_window_private_set_item (priv, 0);
+    g_reminder_db_save_async (priv->db, priv->item, priv->cancellable, on_saved, g_object_ref (user_data));
 
     gtk_widget_grab_focus (GTK_WIDGET (priv->textview));
 }
 
 ON_ACTION_PROTO (cancel)
 {
-    GReminderWindowPrivate *priv = user_data;
+    GReminderWindowPrivate *priv = g_reminder_window_get_instance_private (user_data);
 
     gtk_widget_grab_focus (GTK_WIDGET (priv->textview));
 }
@@ -166,18 +231,44 @@ g_reminder_window_edit (GReminderWindow *self,
     gtk_widget_grab_focus (GTK_WIDGET (priv->textview));
 }
 
+typedef struct
+{
+    GReminderWindow *self;
+    gchar           *text;
+} GReminderWindowSearch;
+
+static void
+on_found (GObject      *source,
+          GAsyncResult *result,
+          gpointer      user_data)
+{
+    GReminderWindowSearch *search = user_data;
+    GReminderWindowPrivate *priv = g_reminder_window_get_instance_private (search->self);
+    G_REMINDER_CLEANUP_ERROR_FREE GError *error = NULL;
+    GSList *items = g_reminder_db_find_finish (G_REMINDER_DB (source), result, &error);
+
+    if (error && !g_reminder_window_private_is_gone (priv, error))
+        g_warning ("Could not search for '%s': %s", search->text, error->message);
+
+    if (items && !g_reminder_window_private_is_gone (priv, error))
+        gtk_widget_show_all (g_reminder_list_window_new (search->self, search->text, items));
+
+    g_slist_free_full (items, g_object_unref);
+    g_object_unref (search->self);
+    g_free (search->text);
+    g_free (search);
+}
+
 static void
 g_reminder_window_search (GReminderWindow *self,
                           const gchar     *text)
 {
     GReminderWindowPrivate *priv = g_reminder_window_get_instance_private (self);
-    GSList *items = g_reminder_db_find (priv->db, text);
+    GReminderWindowSearch *search = g_new (GReminderWindowSearch, 1);
 
-    if (!items)
-        return;
-
-    gtk_widget_show_all (g_reminder_list_window_new (self, text, items));
-    g_slist_free_full (items, g_object_unref);
+    search->self = g_object_ref (self);
+    search->text = g_strdup (text);
+    g_reminder_db_find_async (priv->db, text, priv->cancellable, on_found, search);
 }
 
 static void
@@ -205,7 +296,7 @@ on_match_selected (GtkEntryCompletion *completion G_GNUC_UNUSED,
 {
     GReminderWindow *self = user_data;
     gchar *text = NULL;
-    gtk_tree_model_get (model, iter, 0, &text, -1);
+    gtk_tree_model_get (model, iter, G_REMINDER_DB_KEYWORDS_COLUMN_KEYWORD, &text, -1);
     g_reminder_window_search (self, text);
     g_free (text);
     return TRUE;
@@ -283,6 +374,10 @@ g_reminder_window_dispose (GObject *object)
         g_signal_handler_disconnect (priv->text,       priv->c_signals[C_CHANGED]);
     }
 
+    if (priv->cancellable)
+        g_cancellable_cancel (priv->cancellable);
+
+    g_clear_object (&priv->cancellable);
     g_clear_object (&priv->db);
     g_clear_object (&priv->item);
 
@@ -307,6 +402,7 @@ g_reminder_window_init (GReminderWindow *self)
     GReminderWindowPrivate *priv = g_reminder_window_get_instance_private ((GReminderWindow *) self);
 
     priv->item = NULL;
+    priv->cancellable = g_cancellable_new ();
     priv->valid = FALSE;
     priv->kvalid = FALSE;
     priv->cvalid = FALSE;
@@ -337,7 +433,7 @@ g_reminder_window_init (GReminderWindow *self)
     gtk_header_bar_pack_start (header_bar, sentry);
 
     priv->completion = gtk_entry_completion_new ();
-    gtk_entry_completion_set_text_column (priv->completion, 0);
+    gtk_entry_completion_set_text_column (priv->completion, G_REMINDER_DB_KEYWORDS_COLUMN_KEYWORD);
     gtk_entry_completion_set_minimum_key_length (priv->completion, 0);
     gtk_entry_set_completion (GTK_ENTRY (priv->search), priv->completion);
     priv->c_signals[C_MATCH] = g_signal_connect (G_OBJECT (priv->completion),
@@ -352,7 +448,7 @@ g_reminder_window_init (GReminderWindow *self)
         priv->c_signals[a] = g_signal_connect (G_OBJECT (as),
                                                actions[a].name,
                                                actions[a].callback,
-                                               priv);
+                                               self);
     }
     gtk_header_bar_pack_end (header_bar, as);
 
@@ -414,7 +510,7 @@ g_reminder_window_new (GtkApplication *app,
 
     priv->db = g_object_ref (db);
 
-    g_reminder_window_private_reset_completion (priv);
+    g_reminder_window_private_reset_completion (G_REMINDER_WINDOW (self));
 
     return self;
 }
@@ -17,6 +17,7 @@
  *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "greminder-db.h"
 #include "greminder-window.h"
 
 #include <glib/gi18n-lib.h>
@@ -29,9 +30,13 @@ show_help (const gchar *caller)
 {
     printf (_("Usage:\n"));
     /* Translators: help for gremidner version */
-    printf ("  %s version: %s\n", caller, _("display the version"));
+    printf ("  %s version:         %s\n", caller, _("display the version"));
     /* Translators: help for greminder help */
-    printf ("  %s help:    %s\n", caller, _("display this help"));
+    printf ("  %s help:            %s\n", caller, _("display this help"));
+    /* Translators: help for greminder explain */
+    printf ("  %s explain <query>: %s\n", caller, _("show how a search would be run"));
+    /* Translators: help for greminder analyze */
+    printf ("  %s analyze <query>: %s\n", caller, _("run a search and show what it cost"));
 }
 
 static void
@@ -57,6 +62,46 @@ is_version (const gchar *option)
             !g_strcmp0 (option, "--version"));
 }
 
+static gboolean
+is_explain (const gchar *option)
+{
+    return (!g_strcmp0 (option, "explain") ||
+            !g_strcmp0 (option, "analyze"));
+}
+
+static gint
+explain (gchar    **query,
+         gboolean   analyze)
+{
+    if (!*query)
+    {
+        fprintf (stderr, "%s\n", _("Missing search query"));
+        return EXIT_FAILURE;
+    }
+
+    G_REMINDER_CLEANUP_UNREF GReminderDb *db = g_reminder_db_new ();
+    if (!db)
+    {
+        fprintf (stderr, "Failed to initialize database");
+        return EXIT_FAILURE;
+    }
+
+    G_REMINDER_CLEANUP_FREE gchar *keywords = g_strjoinv (" ", query);
+    G_REMINDER_CLEANUP_ERROR_FREE GError *error = NULL;
+    G_REMINDER_CLEANUP_UNREF GReminderDbExplain *explain = g_reminder_db_explain (db, keywords, analyze, &error);
+
+    if (!explain)
+    {
+        fprintf (stderr, "%s: %s\n", _("Invalid search query"), error->message);
+        return EXIT_FAILURE;
+    }
+
+    G_REMINDER_CLEANUP_FREE gchar *report = g_reminder_db_explain_to_string (explain);
+    printf ("%s", report);
+
+    return EXIT_SUCCESS;
+}
+
 gint
 main (gint argc, gchar *argv[])
 {
@@ -74,6 +119,8 @@ main (gint argc, gchar *argv[])
             show_version ();
             return EXIT_SUCCESS;
         }
+        else if (is_explain (argv[1]))
+            return explain (argv + 2, !g_strcmp0 (argv[1], "analyze"));
     }
 
     gtk_init (&argc, &argv);
@@ -0,0 +1,181 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-intersect.h"
+
+#include <stdlib.h>
+
+/*
+ * Times the intersection kernels against the scalar merge on pairs of
+ * sparse containers. Their sizes follow the frequencies of tags, falling
+ * off as 1/rank, so most pairs are skewed and a few are large and dense.
+ * Runs are reproducible from the seed given as argument.
+ */
+
+/* Largest sparse container, see greminder-db-bitmap.c, and the keywords whose sizes are drawn */
+#define BENCH_CONTAINER_MAX 4096
+#define BENCH_KEYWORDS      1024
+
+/* Each timing is the fastest of the repeats, the others mostly measure noise */
+#define BENCH_PAIRS   2000
+#define BENCH_ROUNDS  40
+#define BENCH_REPEATS 7
+
+/* Past this size ratio the dispatcher gallops, as G_REMINDER_DB_INTERSECT_SKEW says */
+#define BENCH_SKEW 32
+
+typedef struct
+{
+    guint16 *a;
+    guint16 *b;
+    guint    na;
+    guint    nb;
+} BenchPair;
+
+static const gchar *kernels[G_REMINDER_DB_INTERSECT_N_KERNELS] =
+{
+    [G_REMINDER_DB_INTERSECT_GALLOP] = "gallop",
+    [G_REMINDER_DB_INTERSECT_SSE42]  = "sse4.2",
+    [G_REMINDER_DB_INTERSECT_AVX2]   = "avx2",
+};
+
+static guint16 *
+bench_container (GRand *rand,
+                 guint *len)
+{
+    guint rank = g_rand_int_range (rand, 1, BENCH_KEYWORDS + 1);
+    guint n = MAX (1, BENCH_CONTAINER_MAX / rank);
+    G_REMINDER_CLEANUP_FREE gboolean *picked = g_new0 (gboolean, 65536);
+    guint16 *values = g_new (guint16, n);
+
+    for (guint i = 0; i < n; ++i)
+        picked[g_rand_int_range (rand, 0, 65536)] = TRUE;
+
+    *len = 0;
+    for (guint v = 0; v < 65536; ++v)
+    {
+        if (picked[v])
+            values[(*len)++] = v;
+    }
+
+    return values;
+}
+
+/* Nanoseconds per intersection, over the pairs of the given kind */
+static gdouble
+bench_run (GReminderDbIntersectFunc  func,
+           const BenchPair          *pairs,
+           gboolean                  skewed,
+           guint16                  *out)
+{
+    gdouble best = 0;
+    guint64 found = 0;
+
+    for (guint repeat = 0; repeat < BENCH_REPEATS; ++repeat)
+    {
+        guint64 calls = 0;
+        gint64 start = g_get_monotonic_time ();
+
+        for (guint round = 0; round < BENCH_ROUNDS; ++round)
+        {
+            for (guint i = 0; i < BENCH_PAIRS; ++i)
+            {
+                const BenchPair *pair = &pairs[i];
+                gboolean skew = ((guint64) MIN (pair->na, pair->nb) * BENCH_SKEW < MAX (pair->na, pair->nb));
+
+                if (skew != skewed)
+                    continue;
+                found += func (pair->a, pair->na, pair->b, pair->nb, out);
+                ++calls;
+            }
+        }
+
+        gdouble ns = (calls) ? (g_get_monotonic_time () - start) * 1000.0 / calls : 0;
+        if (!repeat || ns < best)
+            best = ns;
+    }
+
+    /* Keeps the calls from being optimized away */
+    if (found == G_MAXUINT64)
+        g_print ("%" G_GUINT64_FORMAT "\n", found);
+
+    return best;
+}
+
+static void
+bench_report (const gchar              *name,
+              GReminderDbIntersectFunc  func,
+              const BenchPair          *pairs,
+              const gdouble            *scalar,
+              guint16                  *out)
+{
+    if (!func)
+    {
+        g_print ("%-10s not supported by this CPU\n", name);
+        return;
+    }
+
+    gdouble balanced = bench_run (func, pairs, FALSE, out);
+    gdouble skewed = bench_run (func, pairs, TRUE, out);
+
+    g_print ("%-10s %10.1f %7.2fx %10.1f %7.2fx\n", name, balanced, scalar[0] / balanced, skewed, scalar[1] / skewed);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+    guint32 seed = (argc > 1) ? (guint32) strtoul (argv[1], NULL, 10) : 42;
+    GRand *rand = g_rand_new_with_seed (seed);
+    BenchPair *pairs = g_new (BenchPair, BENCH_PAIRS);
+    G_REMINDER_CLEANUP_FREE guint16 *out = g_new (guint16, BENCH_CONTAINER_MAX);
+    guint skewed = 0;
+
+    for (guint i = 0; i < BENCH_PAIRS; ++i)
+    {
+        pairs[i].a = bench_container (rand, &pairs[i].na);
+        pairs[i].b = bench_container (rand, &pairs[i].nb);
+        skewed += ((guint64) MIN (pairs[i].na, pairs[i].nb) * BENCH_SKEW < MAX (pairs[i].na, pairs[i].nb));
+    }
+
+    g_print ("seed %u, %u pairs, %u of them skewed past %d:1, ns per intersection\n\n", seed, BENCH_PAIRS, skewed, BENCH_SKEW);
+    g_print ("%-10s %10s %8s %10s %8s\n", "kernel", "balanced", "", "skewed", "");
+
+    /* Warm up the caches and the branch predictors before the reference gets timed */
+    bench_run (g_reminder_db_intersect_u16_scalar, pairs, FALSE, out);
+
+    gdouble scalar[] = {
+        bench_run (g_reminder_db_intersect_u16_scalar, pairs, FALSE, out),
+        bench_run (g_reminder_db_intersect_u16_scalar, pairs, TRUE, out),
+    };
+
+    bench_report ("scalar", g_reminder_db_intersect_u16_scalar, pairs, scalar, out);
+    for (guint k = 0; k < G_REMINDER_DB_INTERSECT_N_KERNELS; ++k)
+        bench_report (kernels[k], g_reminder_db_intersect_get_kernel (k), pairs, scalar, out);
+    bench_report ("dispatch", g_reminder_db_intersect_u16, pairs, scalar, out);
+
+    for (guint i = 0; i < BENCH_PAIRS; ++i)
+    {
+        g_free (pairs[i].a);
+        g_free (pairs[i].b);
+    }
+    g_free (pairs);
+    g_rand_free (rand);
+
+    return EXIT_SUCCESS;
+}
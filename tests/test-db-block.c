@@ -0,0 +1,94 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-block.h"
+
+/* Random increasing ids, with gaps of every varint length */
+static guint64 *
+test_db_block_random_ids (guint n)
+{
+    guint64 *ids = g_new (guint64, n);
+    guint64 id = 0;
+
+    for (guint i = 0; i < n; ++i)
+    {
+        guint bits = g_test_rand_int_range (0, 50);
+        guint64 gap = ((guint64) g_test_rand_int () << 32 | g_test_rand_int ()) >> (63 - bits);
+        id += gap + 1;
+        ids[i] = id;
+    }
+
+    return ids;
+}
+
+static void
+test_db_block_roundtrip (void)
+{
+    for (guint round = 0; round < 1000; ++round)
+    {
+        guint n = g_test_rand_int_range (0, G_REMINDER_DB_BLOCK_MAX + 1);
+        G_REMINDER_CLEANUP_FREE guint64 *ids = test_db_block_random_ids (n);
+        G_REMINDER_CLEANUP_STRING_FREE GString *value = g_reminder_db_block_encode (ids, n);
+        G_REMINDER_CLEANUP_ARRAY_UNREF GArray *decoded = g_array_new (FALSE, FALSE, sizeof (guint64));
+
+        g_assert (g_reminder_db_block_decode (value->str, value->len, decoded));
+        g_assert_cmpuint (decoded->len, ==, n);
+        for (guint i = 0; i < n; ++i)
+            g_assert_cmpuint (g_array_index (decoded, guint64, i), ==, ids[i]);
+    }
+}
+
+static void
+test_db_block_appends (void)
+{
+    guint64 first[] = { 1, 2, 300 };
+    guint64 second[] = { 70000, 70001 };
+    G_REMINDER_CLEANUP_STRING_FREE GString *a = g_reminder_db_block_encode (first, G_N_ELEMENTS (first));
+    G_REMINDER_CLEANUP_STRING_FREE GString *b = g_reminder_db_block_encode (second, G_N_ELEMENTS (second));
+    G_REMINDER_CLEANUP_ARRAY_UNREF GArray *decoded = g_array_new (FALSE, FALSE, sizeof (guint64));
+
+    g_assert (g_reminder_db_block_decode (a->str, a->len, decoded));
+    g_assert (g_reminder_db_block_decode (b->str, b->len, decoded));
+    g_assert_cmpuint (decoded->len, ==, 5);
+    g_assert_cmpuint (g_array_index (decoded, guint64, 2), ==, 300);
+    g_assert_cmpuint (g_array_index (decoded, guint64, 3), ==, 70000);
+}
+
+static void
+test_db_block_truncated (void)
+{
+    guint64 ids[] = { 1, G_GUINT64_CONSTANT (1) << 40 };
+    G_REMINDER_CLEANUP_STRING_FREE GString *value = g_reminder_db_block_encode (ids, G_N_ELEMENTS (ids));
+    G_REMINDER_CLEANUP_ARRAY_UNREF GArray *decoded = g_array_new (FALSE, FALSE, sizeof (guint64));
+
+    /* The second varint loses its last byte */
+    g_assert (!g_reminder_db_block_decode (value->str, value->len - 1, decoded));
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/db/block/roundtrip", test_db_block_roundtrip);
+    g_test_add_func ("/db/block/appends", test_db_block_appends);
+    g_test_add_func ("/db/block/truncated", test_db_block_truncated);
+
+    return g_test_run ();
+}
@@ -0,0 +1,125 @@
+/*
+ *      This file is part of GReminder.
+ *
+ *      Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+ *
+ *      GReminder is free software: you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation, either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      GReminder is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "greminder-db-intersect.h"
+
+static const gchar *kernels[G_REMINDER_DB_INTERSECT_N_KERNELS] =
+{
+    [G_REMINDER_DB_INTERSECT_GALLOP] = "gallop",
+    [G_REMINDER_DB_INTERSECT_SSE42]  = "sse4.2",
+    [G_REMINDER_DB_INTERSECT_AVX2]   = "avx2",
+};
+
+/* Sorted distinct values, drawn from [0, range) so that lists overlap more or less, all of them past range draws */
+static guint16 *
+test_db_intersect_random_values (guint  n,
+                                 guint  range,
+                                 guint *len)
+{
+    G_REMINDER_CLEANUP_FREE gboolean *picked = g_new0 (gboolean, range);
+    guint16 *values = g_new (guint16, MIN (n, range) + 1);
+
+    for (guint i = 0; i < n; ++i)
+        picked[(n < range) ? (guint) g_test_rand_int_range (0, range) : i % range] = TRUE;
+
+    *len = 0;
+    for (guint v = 0; v < range; ++v)
+    {
+        if (picked[v])
+            values[(*len)++] = v;
+    }
+
+    return values;
+}
+
+static void
+test_db_intersect_check (GReminderDbIntersectFunc  func,
+                         guint                     na,
+                         guint                     nb,
+                         guint                     range)
+{
+    guint la, lb;
+    G_REMINDER_CLEANUP_FREE guint16 *a = test_db_intersect_random_values (na, range, &la);
+    G_REMINDER_CLEANUP_FREE guint16 *b = test_db_intersect_random_values (nb, range, &lb);
+    G_REMINDER_CLEANUP_FREE guint16 *expected = g_new (guint16, MIN (la, lb) + 1);
+    G_REMINDER_CLEANUP_FREE guint16 *got = g_new (guint16, MIN (la, lb) + 1);
+
+    guint n = g_reminder_db_intersect_u16_scalar (a, la, b, lb, expected);
+    guint m = func (a, la, b, lb, got);
+
+    g_assert_cmpuint (m, ==, n);
+    for (guint i = 0; i < n; ++i)
+        g_assert_cmpuint (got[i], ==, expected[i]);
+}
+
+static void
+test_db_intersect_kernel (gconstpointer data)
+{
+    GReminderDbIntersectKernel kernel = GPOINTER_TO_INT (data);
+    GReminderDbIntersectFunc func = g_reminder_db_intersect_get_kernel (kernel);
+
+    if (!func)
+    {
+        g_test_skip ("Not supported by this CPU");
+        return;
+    }
+
+    for (guint round = 0; round < 2000; ++round)
+    {
+        /* Around the vector widths, then long lists, sparse or dense */
+        guint na = g_test_rand_int_range (0, (round % 2) ? 40 : 600);
+        guint nb = g_test_rand_int_range (0, (round % 3) ? 40 : 600);
+        guint range = (round % 5) ? g_test_rand_int_range (1, 2 * MAX (na, nb) + 2) : 65536;
+
+        test_db_intersect_check (func, na, nb, range);
+    }
+
+    /* Lists holding 0 and 65535 */
+    test_db_intersect_check (func, 64, 64, 64);
+    test_db_intersect_check (func, 65536, 65536, 65536);
+    test_db_intersect_check (func, 65536, 20000, 65536);
+}
+
+static void
+test_db_intersect_dispatch (void)
+{
+    for (guint round = 0; round < 2000; ++round)
+    {
+        /* Skewed sizes go through the gallop */
+        guint na = g_test_rand_int_range (0, (round % 2) ? 8 : 4096);
+        guint nb = g_test_rand_int_range (0, 4096);
+
+        test_db_intersect_check (g_reminder_db_intersect_u16, na, nb, 65536);
+    }
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    for (guint i = 0; i < G_REMINDER_DB_INTERSECT_N_KERNELS; ++i)
+    {
+        G_REMINDER_CLEANUP_FREE gchar *path = g_strdup_printf ("/db/intersect/%s", kernels[i]);
+        g_test_add_data_func (path, GINT_TO_POINTER (i), test_db_intersect_kernel);
+    }
+    g_test_add_func ("/db/intersect/dispatch", test_db_intersect_dispatch);
+
+    return g_test_run ();
+}
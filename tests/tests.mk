@@ -0,0 +1,66 @@
+# This file is part of GReminder.
+#
+# Copyright 2014 Marc-Antoine Perennou <Marc-Antoine@Perennou.com>
+#
+# GReminder is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# GReminder is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with GReminder.  If not, see <http://www.gnu.org/licenses/>.
+
+TESTS +=                        \
+	tests/test-db-block     \
+	tests/test-db-intersect \
+	$(NULL)
+
+tests_test_db_block_SOURCES =                  \
+	src/greminder/greminder-macros.h       \
+	src/greminder/greminder-item.h         \
+	src/greminder/greminder-db-block.h     \
+	src/greminder/greminder-db-keys.h      \
+	src/greminder/greminder-db-record.h    \
+	src/greminder/greminder-item-private.h \
+	src/greminder/greminder-db-block.c     \
+	src/greminder/greminder-db-keys.c      \
+	src/greminder/greminder-db-record.c    \
+	src/greminder/greminder-item.c         \
+	tests/test-db-block.c                  \
+	$(NULL)
+
+tests_test_db_block_LDADD = \
+	$(AM_LIBS)          \
+	$(NULL)
+
+tests_test_db_intersect_SOURCES =              \
+	src/greminder/greminder-macros.h       \
+	src/greminder/greminder-db-intersect.h \
+	src/greminder/greminder-db-intersect.c \
+	tests/test-db-intersect.c              \
+	$(NULL)
+
+tests_test_db_intersect_LDADD = \
+	$(AM_LIBS)              \
+	$(NULL)
+
+# Not run by make check, prints timings: tests/bench-db-intersect [seed]
+noinst_PROGRAMS +=               \
+	tests/bench-db-intersect \
+	$(NULL)
+
+tests_bench_db_intersect_SOURCES =             \
+	src/greminder/greminder-macros.h       \
+	src/greminder/greminder-db-intersect.h \
+	src/greminder/greminder-db-intersect.c \
+	tests/bench-db-intersect.c             \
+	$(NULL)
+
+tests_bench_db_intersect_LDADD = \
+	$(AM_LIBS)               \
+	$(NULL)